@@ -8,6 +8,9 @@
 #include <math.h> // sqrt
 
 #include "global.h"
+#include "parallel.h"
+#include "sparse.h"
+#include "bitmap.h"
 
 
 
@@ -22,6 +25,16 @@ const char *arrtype_str(arrtype_t t) {
             return "REALS_ARR";
         case STRINGS_ARR:
             return "STRINGS_ARR";
+        case CSR_ARR:
+            return "CSR_ARR";
+        case CSC_ARR:
+            return "CSC_ARR";
+        case FLOATS_ARR:
+            return "FLOATS_ARR";
+        case LONGS_ARR:
+            return "LONGS_ARR";
+        case BOOLS_ARR:
+            return "BOOLS_ARR";
         case NULL_ARR:
             return "NULL_ARR";
         default:
@@ -31,13 +44,105 @@ const char *arrtype_str(arrtype_t t) {
 
 
 
+/*dense types with one fixed-size element per cell*/
+int is_numeric_type(arrtype_t t) {
+    return t == INTS_ARR || t == REALS_ARR || t == FLOATS_ARR ||
+           t == LONGS_ARR || t == BOOLS_ARR;
+}
+
+/*bytes per element of a dense type*/
+size_t arrtype_size(arrtype_t t) {
+    switch (t) {
+        case INTS_ARR:
+            return sizeof(int);
+        case REALS_ARR:
+            return sizeof(double);
+        case STRINGS_ARR:
+            return sizeof(char*);
+        case FLOATS_ARR:
+            return sizeof(float);
+        case LONGS_ARR:
+            return sizeof(int64_t);
+        case BOOLS_ARR:
+            return sizeof(uint8_t);
+        default:
+            fprintf(stderr, "arrtype_size: no element size for %s\n", arrtype_str(t));
+            exit(1);
+    }
+}
+
+/*point the typed data pointer of ar at ar->data (the others are NULL)*/
+static void _set_data_ptrs(ArrayStruct *ar) {
+    ar->ints = NULL;
+    ar->reals = NULL;
+    ar->strings = NULL;
+    ar->floats = NULL;
+    ar->longs = NULL;
+    ar->bools = NULL;
+    switch (ar->type) {
+        case INTS_ARR:    ar->ints = (int*)ar->data; break;
+        case REALS_ARR:   ar->reals = (double*)ar->data; break;
+        case STRINGS_ARR: ar->strings = (char**)ar->data; break;
+        case FLOATS_ARR:  ar->floats = (float*)ar->data; break;
+        case LONGS_ARR:   ar->longs = (int64_t*)ar->data; break;
+        case BOOLS_ARR:   ar->bools = (uint8_t*)ar->data; break;
+        default: break;
+    }
+}
+
+/*element ix of a numeric array, as a double*/
+static inline double _load_real(const ArrayStruct *ar, size_t ix) {
+    switch (ar->type) {
+        case INTS_ARR:   return (double)ar->ints[ix];
+        case REALS_ARR:  return ar->reals[ix];
+        case FLOATS_ARR: return (double)ar->floats[ix];
+        case LONGS_ARR:  return (double)ar->longs[ix];
+        case BOOLS_ARR:  return (double)ar->bools[ix];
+        default:
+            fprintf(stderr, "unsupported type: %s\n", arrtype_str(ar->type));
+            exit(1);
+    }
+}
+
+/*store x as element ix of a numeric array (logicals store x != 0)*/
+static inline void _store_real(ArrayStruct *ar, size_t ix, double x) {
+    switch (ar->type) {
+        case INTS_ARR:   ar->ints[ix] = (int)x; break;
+        case REALS_ARR:  ar->reals[ix] = x; break;
+        case FLOATS_ARR: ar->floats[ix] = (float)x; break;
+        case LONGS_ARR:  ar->longs[ix] = (int64_t)x; break;
+        case BOOLS_ARR:  ar->bools[ix] = (x != 0); break;
+        default:
+            fprintf(stderr, "unsupported type: %s\n", arrtype_str(ar->type));
+            exit(1);
+    }
+}
+
+
+const char *layout_str(layout_t l) {
+    switch (l) {
+        case ROW_MAJOR:
+            return "ROW_MAJOR";
+        case COL_MAJOR:
+            return "COL_MAJOR";
+        default:
+            return "UNKOWN";
+    }
+}
+
+
+
 /*
     Misc Helpers
 */
-size_t _as_ix(size_t dims[2], size_t ixs[2]) {
+size_t _as_ix(const ArrayStruct *ar, size_t ixs[2]) {
+    if (ar->layout == COL_MAJOR) {
+        // col-ix * nrow + row-ix
+        return ixs[1] * ar->dims[0] + ixs[0];
+    }
     // row major order:
     // row-ix * ncol + col-ix
-    return ixs[0] * dims[1] + ixs[1];
+    return ixs[0] * ar->dims[1] + ixs[1];
 }
 
 void check_valid_dims(size_t *dims, size_t ndim) {
@@ -71,26 +176,32 @@ void alloc_array_struct(ArrayStruct *ar, arrtype_t type, size_t dim0, size_t dim
     check_valid_dims(dims, 2);
     size_t nelem = dims[0] * dims[1];
     ar->type = type;
+    ar->layout = ROW_MAJOR;
     ar->capacity = nelem;
     ar->nalloc = (type == STRINGS_ARR) ? 0 : nelem; // inidiv strings need allocation
     ar->dims[0] = dims[0];
     ar->dims[1] = dims[1];
     ar->data = NULL;
-    ar->ints = NULL;
-    ar->reals = NULL;
-    ar->strings = NULL;
+    ar->ptr = NULL;
+    ar->idx = NULL;
+    ar->valid = NULL;
     switch (type) {
         case INTS_ARR:
-            ar->data = chk_calloc(nelem, sizeof(int));
-            ar->ints = (int*)ar->data;
-            break;
         case REALS_ARR:
-            ar->data = chk_calloc(nelem, sizeof(double));
-            ar->reals = (double*)ar->data;
+        case FLOATS_ARR:
+        case LONGS_ARR:
+        case BOOLS_ARR:
+            ar->data = chk_calloc(nelem, arrtype_size(type));
             break;
         case STRINGS_ARR:
-            ar->data = chk_malloc(nelem * sizeof(char*));
-            ar->strings = (char**)ar->data;
+            ar->data = chk_calloc(nelem, sizeof(char*)); // NULL until set
+            break;
+        case CSR_ARR:
+        case CSC_ARR:
+            // no stored values yet (see alloc_sparse): every row / col empty
+            ar->capacity = 0;
+            ar->nalloc = 0;
+            ar->ptr = chk_calloc(dims[type == CSR_ARR ? 0 : 1] + 1, sizeof(size_t));
             break;
         case NULL_ARR:
             break;
@@ -98,20 +209,26 @@ void alloc_array_struct(ArrayStruct *ar, arrtype_t type, size_t dim0, size_t dim
             fprintf(stderr, "alloc_array_struct: unknown type: %d\n", type);
             exit(1);
     }
+    _set_data_ptrs(ar);
 }
 
 
 void free_arraystruct_data(ArrayStruct *ar) {
-    if (ar->type == STRINGS_ARR) {
-        for (size_t i = 0; i < ar->nalloc; ++i) {
+    if (ar->type == STRINGS_ARR && ar->strings) {
+        // set strings need not be contiguous; unset slots are NULL
+        for (size_t i = 0; i < ar->capacity; ++i) {
             chk_free(ar->strings[i]);
         }
     }
     chk_free(ar->data);
+    chk_free(ar->ptr);
+    chk_free(ar->idx);
+    chk_free(ar->valid);
     ar->data = NULL;
-    ar->ints = NULL;
-    ar->reals = NULL;
-    ar->strings = NULL;
+    _set_data_ptrs(ar);
+    ar->ptr = NULL;
+    ar->idx = NULL;
+    ar->valid = NULL;
     ar->capacity = 0;
     ar->nalloc = 0;
     ar->dims[0] = 0;
@@ -132,6 +249,13 @@ ARRP alloc_array(arrtype_t type, size_t dim0, size_t dim1) {
     return v;
 }
 
+/*allocate an array whose elements are stored in the given order*/
+ARRP alloc_array_layout(arrtype_t type, size_t dim0, size_t dim1, layout_t layout) {
+    ARRP v = alloc_array(type, dim0, dim1);
+    v.node->arr->layout = layout;
+    return v;
+}
+
 ARRP alloc_row_array(arrtype_t type, size_t length) {
     ARRP v = alloc_array(type, 1, length);
     return v;
@@ -159,33 +283,36 @@ ARRP resize_array(ARRP v, size_t newsize) {
     if (newsize == v.node->arr->capacity) {
         return v;
     }
+    if (v.node->arr->valid)
+        bitmap_resize(&v.node->arr->valid, v.node->arr->capacity, newsize, 1);
     switch (arrtype(v)) {
         case INTS_ARR:
-            chk_realloc((void**)&v.node->arr->ints, newsize * sizeof(int));
-            v.node->arr->data = v.node->arr->ints;
-            v.node->arr->nalloc = newsize;
-            v.node->arr->capacity = newsize;
-            break;
         case REALS_ARR:
-            chk_realloc((void**)&v.node->arr->reals, newsize * sizeof(double));
-            v.node->arr->data = v.node->arr->reals;
+        case FLOATS_ARR:
+        case LONGS_ARR:
+        case BOOLS_ARR:
+            chk_realloc(&v.node->arr->data, newsize * arrtype_size(arrtype(v)));
+            _set_data_ptrs(v.node->arr);
             v.node->arr->nalloc = newsize;
             v.node->arr->capacity = newsize;
             break;
         case STRINGS_ARR: ;
             /*
-                If new size is less than current number of allocated strings,
-                don't leave allocated strings hanging at the end of array
+                If the array shrinks, don't leave allocated strings hanging
+                at the end of it; if it grows, the new slots are unset
             */
-            size_t nalloc = v.node->arr->nalloc;
-            for (size_t i = nalloc; i > newsize; --i) {
-                chk_free(v.node->arr->strings[i]);
-                v.node->arr->nalloc--;
+            size_t cap = v.node->arr->capacity;
+            for (size_t i = newsize; i < cap; ++i) {
+                if (v.node->arr->strings[i]) {
+                    chk_free(v.node->arr->strings[i]);
+                    v.node->arr->nalloc--;
+                }
             }
             chk_realloc((void**)&v.node->arr->strings, newsize * sizeof(char*));
+            for (size_t i = cap; i < newsize; ++i)
+                v.node->arr->strings[i] = NULL;
             v.node->arr->data = v.node->arr->strings;
             v.node->arr->capacity = newsize;
-            // nalloc doesn't increase
             break;
         default:
             fprintf(stderr, "resize_array: unknown type: %d\n", arrtype(v));
@@ -211,6 +338,18 @@ arrtype_t arrtype(ARRP v) {
     return v.node->arr->type;
 }
 
+layout_t arrlayout(ARRP v) {
+    return v.node->arr->layout;
+}
+
+
+
+/*an element written through a setter is no longer NA*/
+static inline void _mark_present(ArrayStruct *ar, size_t ix) {
+    if (ar->valid)
+        bitmap_set(ar->valid, ix);
+}
+
 
 
 /*INTEGER ARRAY*/
@@ -233,21 +372,19 @@ int ints_elt(ARRP v, size_t dim0, size_t dim1) {
                 arrtype_str(arrtype(v)));
         exit(1);
     }
-    return v.node->arr->ints[_as_ix(dims(v), ixs)];
+    return v.node->arr->ints[_as_ix(v.node->arr, ixs)];
 }
 
 int as_int(ARRP v, size_t dim0, size_t dim1) {
     size_t ixs[2] = {dim0, dim1};
     check_valid_ix(dims(v), ixs);
-    if (arrtype(v) == STRINGS_ARR) {
-        fprintf(stderr, "as_int: not implemented for STRINGS_ARR\n");
+    if (!is_numeric_type(arrtype(v))) {
+        fprintf(stderr, "as_int: not implemented for %s\n", arrtype_str(arrtype(v)));
         exit(1);
     }
-    if (arrtype(v) == REALS_ARR) {
-        return (int)v.node->arr->reals[_as_ix(dims(v), ixs)];
-    } else {
-        return v.node->arr->ints[_as_ix(dims(v), ixs)];
-    }
+    if (arrtype(v) == INTS_ARR)
+        return v.node->arr->ints[_as_ix(v.node->arr, ixs)];
+    return (int)_load_real(v.node->arr, _as_ix(v.node->arr, ixs));
 }
 
 void set_ints_elt(ARRP v, size_t dim0, size_t dim1, int val) {
@@ -258,25 +395,42 @@ void set_ints_elt(ARRP v, size_t dim0, size_t dim1, int val) {
                 arrtype_str(arrtype(v)));
         exit(1);
     }
-    v.node->arr->ints[_as_ix(dims(v), ixs)] = val;
+    size_t ix = _as_ix(v.node->arr, ixs);
+    v.node->arr->ints[ix] = val;
+    _mark_present(v.node->arr, ix);
 }
 
-/*convert a real array to an integer array*/
-void cast_ints(ARRP v) {
-    if (arrtype(v) == INTS_ARR) {
+/*
+    Convert the elements of a numeric array to another numeric type, in
+    place (through a new buffer). Logicals become 0 / 1, and anything
+    nonzero becomes TRUE.
+*/
+static void _cast_numeric(ARRP v, arrtype_t type, const char *caller) {
+    ArrayStruct *ar = v.node->arr;
+    if (ar->type == type) {
         return;
-    } else if (arrtype(v) == STRINGS_ARR) {
-        fprintf(stderr, "cast_ints: not implemented for STRINGS_ARR");
+    } else if (!is_numeric_type(ar->type)) {
+        fprintf(stderr, "%s: not implemented for %s\n", caller, arrtype_str(ar->type));
         exit(1);
     }
-    v.node->arr->type = INTS_ARR;
-    v.node->arr->ints = chk_malloc(v.node->arr->capacity * sizeof(int));
-    for (size_t i = 0; i < v.node->arr->nalloc; i++) {
-        v.node->arr->ints[i] = (int)v.node->arr->reals[i];
+    ArrayStruct old = *ar;
+    ar->type = type;
+    ar->data = chk_malloc(ar->capacity * arrtype_size(type));
+    _set_data_ptrs(ar);
+    if (type == LONGS_ARR && old.type == INTS_ARR) {
+        // exact, without the trip through double
+        for (size_t i = 0; i < ar->nalloc; i++)
+            ar->longs[i] = old.ints[i];
+    } else {
+        for (size_t i = 0; i < ar->nalloc; i++)
+            _store_real(ar, i, _load_real(&old, i));
     }
-    chk_free(v.node->arr->reals);
-    v.node->arr->reals = NULL;
-    v.node->arr->data = v.node->arr->ints;
+    chk_free(old.data);
+}
+
+/*convert a numeric array to an integer array*/
+void cast_ints(ARRP v) {
+    _cast_numeric(v, INTS_ARR, "cast_ints");
 }
 
 
@@ -299,22 +453,18 @@ double reals_elt(ARRP v, size_t dim0, size_t dim1) {
                 arrtype_str(arrtype(v)));
         exit(1);
     }
-    return v.node->arr->reals[_as_ix(dims(v), ixs)];
+    return v.node->arr->reals[_as_ix(v.node->arr, ixs)];
 }
 
 
 double as_real(ARRP v, size_t dim0, size_t dim1) {
     size_t ixs[2] = {dim0, dim1};
     check_valid_ix(dims(v), ixs);
-    if (arrtype(v) == STRINGS_ARR) {
-        fprintf(stderr, "as_int: not implemented for STRINGS_ARR\n");
+    if (!is_numeric_type(arrtype(v))) {
+        fprintf(stderr, "as_real: not implemented for %s\n", arrtype_str(arrtype(v)));
         exit(1);
     }
-    if (arrtype(v) == INTS_ARR) {
-        return (double)v.node->arr->ints[_as_ix(dims(v), ixs)];
-    } else {
-        return v.node->arr->reals[_as_ix(dims(v), ixs)];
-    }
+    return _load_real(v.node->arr, _as_ix(v.node->arr, ixs));
 }
 
 void set_reals_elt(ARRP v, size_t dim0, size_t dim1, double val) {
@@ -325,25 +475,104 @@ void set_reals_elt(ARRP v, size_t dim0, size_t dim1, double val) {
                 arrtype_str(arrtype(v)));
         exit(1);
     }
-    v.node->arr->reals[_as_ix(dims(v), ixs)] = val;
+    size_t ix = _as_ix(v.node->arr, ixs);
+    v.node->arr->reals[ix] = val;
+    _mark_present(v.node->arr, ix);
 }
 
-/*convert an integer array to a real array*/
+/*convert a numeric array to a real array*/
 void cast_reals(ARRP v) {
-    if (arrtype(v) == REALS_ARR) {
-        return;
-    } else if (arrtype(v) == STRINGS_ARR) {
-        fprintf(stderr, "cast_reals: not implemented for STRINGS_ARR");
+    _cast_numeric(v, REALS_ARR, "cast_reals");
+}
+
+
+
+/*FLOAT ARRAY*/
+float *single(ARRP v) {
+    if (arrtype(v) != FLOATS_ARR) {
+        fprintf(stderr, "single: array is of type %s, expected FLOATS_ARR\n",
+                arrtype_str(arrtype(v)));
+        exit(1);
+    }
+    return v.node->arr->floats;
+}
+
+float floats_elt(ARRP v, size_t dim0, size_t dim1) {
+    size_t ixs[2] = {dim0, dim1};
+    check_valid_ix(dims(v), ixs);
+    return single(v)[_as_ix(v.node->arr, ixs)];
+}
+
+void set_floats_elt(ARRP v, size_t dim0, size_t dim1, float val) {
+    size_t ixs[2] = {dim0, dim1};
+    check_valid_ix(dims(v), ixs);
+    size_t ix = _as_ix(v.node->arr, ixs);
+    single(v)[ix] = val;
+    _mark_present(v.node->arr, ix);
+}
+
+void cast_floats(ARRP v) {
+    _cast_numeric(v, FLOATS_ARR, "cast_floats");
+}
+
+
+
+/*64-BIT INTEGER ARRAY*/
+int64_t *int64(ARRP v) {
+    if (arrtype(v) != LONGS_ARR) {
+        fprintf(stderr, "int64: array is of type %s, expected LONGS_ARR\n",
+                arrtype_str(arrtype(v)));
         exit(1);
     }
-    v.node->arr->type = REALS_ARR;
-    v.node->arr->reals = chk_malloc(v.node->arr->capacity * sizeof(double));
-    for (size_t i = 0; i < v.node->arr->nalloc; i++) {
-        v.node->arr->reals[i] = (double)v.node->arr->ints[i];
+    return v.node->arr->longs;
+}
+
+int64_t longs_elt(ARRP v, size_t dim0, size_t dim1) {
+    size_t ixs[2] = {dim0, dim1};
+    check_valid_ix(dims(v), ixs);
+    return int64(v)[_as_ix(v.node->arr, ixs)];
+}
+
+void set_longs_elt(ARRP v, size_t dim0, size_t dim1, int64_t val) {
+    size_t ixs[2] = {dim0, dim1};
+    check_valid_ix(dims(v), ixs);
+    size_t ix = _as_ix(v.node->arr, ixs);
+    int64(v)[ix] = val;
+    _mark_present(v.node->arr, ix);
+}
+
+void cast_longs(ARRP v) {
+    _cast_numeric(v, LONGS_ARR, "cast_longs");
+}
+
+
+
+/*LOGICAL ARRAY*/
+uint8_t *logical(ARRP v) {
+    if (arrtype(v) != BOOLS_ARR) {
+        fprintf(stderr, "logical: array is of type %s, expected BOOLS_ARR\n",
+                arrtype_str(arrtype(v)));
+        exit(1);
     }
-    chk_free(v.node->arr->ints);
-    v.node->arr->ints = NULL;
-    v.node->arr->data = v.node->arr->reals;
+    return v.node->arr->bools;
+}
+
+int bools_elt(ARRP v, size_t dim0, size_t dim1) {
+    size_t ixs[2] = {dim0, dim1};
+    check_valid_ix(dims(v), ixs);
+    return logical(v)[_as_ix(v.node->arr, ixs)];
+}
+
+void set_bools_elt(ARRP v, size_t dim0, size_t dim1, int val) {
+    size_t ixs[2] = {dim0, dim1};
+    check_valid_ix(dims(v), ixs);
+    size_t ix = _as_ix(v.node->arr, ixs);
+    logical(v)[ix] = (val != 0);
+    _mark_present(v.node->arr, ix);
+}
+
+void cast_bools(ARRP v) {
+    _cast_numeric(v, BOOLS_ARR, "cast_bools");
 }
 
 
@@ -356,7 +585,7 @@ const char *strings_elt(ARRP v, size_t dim0, size_t dim1) {
                 arrtype_str(arrtype(v)));
         exit(1);
     }
-    return v.node->arr->strings[_as_ix(dims(v), ixs)];
+    return v.node->arr->strings[_as_ix(v.node->arr, ixs)];
 }
 
 void set_strings_elt(ARRP v, size_t dim0, size_t dim1, const char *val) {
@@ -367,8 +596,16 @@ void set_strings_elt(ARRP v, size_t dim0, size_t dim1, const char *val) {
                 arrtype_str(arrtype(v)));
         exit(1);
     }
-    chk_strcpy(&v.node->arr->strings[_as_ix(dims(v), ixs)], val);
-    v.node->arr->nalloc++;
+    size_t ix = _as_ix(v.node->arr, ixs);
+    char **dst = &v.node->arr->strings[ix];
+    if (*dst) { // overwriting
+        chk_free(*dst);
+        *dst = NULL;
+        v.node->arr->nalloc--;
+    }
+    chk_strcpy(dst, val);
+    v.node->arr->nalloc += (*dst != NULL);
+    _mark_present(v.node->arr, ix);
 }
 
 
@@ -383,24 +620,25 @@ void* arrp_data(ARRP v) {
 /*allocate new array with same dimensions as the input,
   so maintains matrix attributes*/
 ARRP alloc_same(const ARRP v, arrtype_t type) {
-    ARRP v2 = alloc_array(type, dims(v)[0], dims(v)[1]);
+    ARRP v2 = alloc_array_layout(type, dims(v)[0], dims(v)[1], arrlayout(v));
     return v2;
 }
 
 
 /*create a copy of the given array*/
 ARRP copyarr(const ARRP v) {
+    if (is_sparse(v))
+        return copy_sparse(v);
     ARRP v2 = alloc_same(v, arrtype(v));
     switch (arrtype(v)) {
     case INTS_ARR:
-        for (size_t i = 0; i < length(v); ++i) {
-            integer(v2)[i] = integer(v)[i];
-        }
-        break;
     case REALS_ARR:
-        for (size_t i = 0; i < length(v); ++i) {
-            real(v2)[i] = real(v)[i];
-        }
+    case FLOATS_ARR:
+    case LONGS_ARR:
+    case BOOLS_ARR:
+        memcpy(arrp_data(v2), arrp_data(v), length(v) * arrtype_size(arrtype(v)));
+        if (v.node->arr->valid)
+            v2.node->arr->valid = bitmap_copy(v.node->arr->valid, capacity(v));
         break;
     case STRINGS_ARR: ;
         size_t nrow = dims(v)[0];
@@ -419,6 +657,22 @@ ARRP copyarr(const ARRP v) {
 }
 
 
+/*element-by-element comparison, for arrays stored in different layouts*/
+static int _views_eq_tol(ARRV w1, ARRV w2, double tol) {
+    if (w1.dims[0] != w2.dims[0] || w1.dims[1] != w2.dims[1]) {
+        return 0;
+    }
+    for (size_t i = 0; i < w1.dims[0]; ++i) {
+        for (size_t j = 0; j < w1.dims[1]; ++j) {
+            if (fabs(view_elt(w1, i, j) - view_elt(w2, i, j)) > tol) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+
 int dims_eq(ARRP v1, ARRP v2) {
     size_t *dims1 = dims(v1);
     size_t *dims2 = dims(v2);
@@ -436,6 +690,9 @@ int ints_eq(ARRP v1, ARRP v2) {
     if (n1 != n2) {
         return 0;
     }
+    if (arrlayout(v1) != arrlayout(v2)) {
+        return _views_eq_tol(view(v1), view(v2), 0);
+    }
     for (size_t i = 0; i < n1; ++i) {
         if (integer(v1)[i] != integer(v2)[i]) {
             return 0;
@@ -456,6 +713,9 @@ int reals_eq_tol(ARRP v1, ARRP v2, double tol) {
     if (n1 != n2) {
         return 0;
     }
+    if (arrlayout(v1) != arrlayout(v2)) {
+        return _views_eq_tol(view(v1), view(v2), tol);
+    }
     for (size_t i = 0; i < n1; ++i) {
         if (fabs(real(v1)[i] - real(v2)[i]) > tol) {
             return 0;
@@ -468,253 +728,1053 @@ int reals_eq_tol(ARRP v1, ARRP v2, double tol) {
 
 
 /*
-    ARRAY OPERATIONS
+    MISSING VALUES
 */
 
+static size_t _nelem(ARRP v) {
+    return dims(v)[0] * dims(v)[1];
+}
+
+size_t na_count(ARRP v) {
+    ArrayStruct *ar = v.node->arr;
+    if (!ar->valid)
+        return 0;
+    return _nelem(v) - bitmap_count(ar->valid, 0, _nelem(v));
+}
+
+int has_na(ARRP v) {
+    return na_count(v) > 0;
+}
+
+int is_na(ARRP v, size_t dim0, size_t dim1) {
+    size_t ixs[2] = {dim0, dim1};
+    check_valid_ix(dims(v), ixs);
+    ArrayStruct *ar = v.node->arr;
+    return ar->valid && !bitmap_get(ar->valid, _as_ix(ar, ixs));
+}
 
 /*
-                SCALAR OPS
+    the bitmap is created on the first NA; the element itself is set to
+    NaN (reals) or 0, so code that ignores the bitmap sees no garbage
 */
-
-void __add_num(ARRP *vin, ARRP *vout, double scalar) {
-    switch (arrtype(*vin))
-    {
-    case INTS_ARR:
-        for (size_t i=0; i < length(*vin); ++i)
-            integer(*vout)[i] = integer(*vin)[i] + scalar;
-        break;
-    case REALS_ARR:
-        for (size_t i=0; i < length(*vin); ++i)
-            real(*vout)[i] = real(*vin)[i] + scalar;
-        break;
-    default:
-        fprintf(stderr, "__add_num: unsupported type: %s",
-                arrtype_str(arrtype(*vin)));
+void set_na(ARRP v, size_t dim0, size_t dim1) {
+    size_t ixs[2] = {dim0, dim1};
+    check_valid_ix(dims(v), ixs);
+    ArrayStruct *ar = v.node->arr;
+    if (!is_numeric_type(ar->type) && ar->type != STRINGS_ARR) {
+        fprintf(stderr, "set_na: unsupported type: %s\n", arrtype_str(ar->type));
         exit(1);
-        break;
     }
+    size_t ix = _as_ix(ar, ixs);
+    if (ar->type == STRINGS_ARR)
+        set_strings_elt(v, dim0, dim1, "NA");
+    else
+        _store_real(ar, ix, (ar->type == REALS_ARR || ar->type == FLOATS_ARR) ? NAN : 0.);
+    if (!ar->valid)
+        ar->valid = bitmap_alloc(_nelem(v), 1);
+    bitmap_clear(ar->valid, ix);
 }
 
-ARRP add_num(ARRP v, double scalar) {
-    ARRP v2 = alloc_same(v, arrtype(v));
-    __add_num(&v, &v2, scalar);
-    return v2;
+/*BOOLS_ARR of the same shape, TRUE where v is NA*/
+ARRP na_mask(ARRP v) {
+    ARRP m = alloc_same(v, BOOLS_ARR);
+    ArrayStruct *ar = v.node->arr;
+    if (ar->valid) {
+        for (size_t i = 0; i < _nelem(v); ++i)
+            m.node->arr->bools[i] = !bitmap_get(ar->valid, i);
+    }
+    return m;
 }
 
-ARRP set_add_num(ARRP v, double scalar) {
-    __add_num(&v, &v, scalar);
-    return v;
-}
 
 
-void __mul_num(ARRP *vin, ARRP *vout, double scalar) {
-    switch (arrtype(*vin))
-    {
-    case INTS_ARR:
-        for (size_t i=0; i < length(*vin); ++i)
-            integer(*vout)[i] = integer(*vin)[i] * scalar;
-        break;
-    case REALS_ARR:
-        for (size_t i=0; i < length(*vin); ++i)
-            real(*vout)[i] = real(*vin)[i] * scalar;
-        break;
-    default:
-        fprintf(stderr, "__mul_num: unsupported type: %s",
-                arrtype_str(arrtype(*vin)));
+/*
+    ARRAY VIEWS
+*/
+
+/*keep strides of degenerate dims consistent, so a single row or column
+  is recognized as one strided run*/
+static ARRV _view_norm(ARRV w) {
+    if (w.dims[1] == 1)
+        w.strides[1] = w.strides[0];
+    if (w.dims[0] == 1)
+        w.strides[0] = w.dims[1] * w.strides[1];
+    return w;
+}
+
+static void _check_view_bounds(ARRV w, const char *caller) {
+    size_t last = w.offset + (w.dims[0] - 1) * w.strides[0]
+                           + (w.dims[1] - 1) * w.strides[1];
+    if (w.dims[0] == 0 || w.dims[1] == 0 || last >= w.arr->capacity) {
+        fprintf(stderr, "%s: view out of bounds\n", caller);
         exit(1);
-        break;
     }
 }
 
+/*view of the whole array*/
+ARRV view(ARRP v) {
+    if (arrtype(v) == CSR_ARR || arrtype(v) == CSC_ARR) {
+        fprintf(stderr, "view: not supported for sparse arrays (%s)\n",
+                arrtype_str(arrtype(v)));
+        exit(1);
+    }
+    ARRV w;
+    w.arr = v.node->arr;
+    w.offset = 0;
+    w.dims[0] = dims(v)[0];
+    w.dims[1] = dims(v)[1];
+    if (arrlayout(v) == COL_MAJOR) {
+        w.strides[0] = 1;
+        w.strides[1] = dims(v)[0];
+    } else {
+        w.strides[0] = dims(v)[1];
+        w.strides[1] = 1;
+    }
+    return _view_norm(w);
+}
 
-ARRP mul_num(ARRP v, double scalar) {
-    ARRP v2 = alloc_same(v, arrtype(v));
-    __mul_num(&v, &v2, scalar);
-    return v2;
+ARRV row_view(ARRP v, size_t dim0) {
+    if (dim0 >= dims(v)[0]) {
+        fprintf(stderr, "row_view: dim0 out of bounds\n");
+        exit(1);
+    }
+    ARRV w = view(v);
+    w.offset = dim0 * w.strides[0];
+    w.dims[0] = 1;
+    return _view_norm(w);
 }
 
-ARRP set_mul_num(ARRP v, double scalar) {
-    __mul_num(&v, &v, scalar);
-    return v;
+ARRV col_view(ARRP v, size_t dim1) {
+    if (dim1 >= dims(v)[1]) {
+        fprintf(stderr, "col_view: dim1 out of bounds\n");
+        exit(1);
+    }
+    ARRV w = view(v);
+    w.offset = dim1 * w.strides[1];
+    w.dims[1] = 1;
+    return _view_norm(w);
+}
+
+/*1 x len view starting at flat index offset, taking every stride-th element*/
+ARRV slice(ARRP v, size_t offset, size_t len, size_t stride) {
+    ARRV w;
+    w.arr = v.node->arr;
+    w.offset = offset;
+    w.dims[0] = 1;
+    w.dims[1] = len;
+    w.strides[0] = len * stride;
+    w.strides[1] = stride;
+    _check_view_bounds(w, "slice");
+    return _view_norm(w);
+}
+
+/*nrow x ncol block of a view, with top-left element (dim0, dim1)*/
+ARRV subview(ARRV w, size_t dim0, size_t dim1, size_t nrow, size_t ncol) {
+    if (nrow == 0 || ncol == 0 ||
+        dim0 + nrow > w.dims[0] || dim1 + ncol > w.dims[1]) {
+        fprintf(stderr, "subview: block out of bounds\n");
+        exit(1);
+    }
+    w.offset += dim0 * w.strides[0] + dim1 * w.strides[1];
+    w.dims[0] = nrow;
+    w.dims[1] = ncol;
+    return _view_norm(w);
 }
 
+/*the transpose of a view is the same data with dims and strides swapped*/
+ARRV transpose_view(ARRV w) {
+    ARRV t = w;
+    t.dims[0] = w.dims[1];
+    t.dims[1] = w.dims[0];
+    t.strides[0] = w.strides[1];
+    t.strides[1] = w.strides[0];
+    return _view_norm(t);
+}
 
-ARRP div_num(ARRP v, double scalar) {
-    ARRP v2 = alloc_same(v, arrtype(v));
-    __mul_num(&v, &v2, 1/scalar);
-    return v2;
+size_t view_length(ARRV w) {
+    return w.dims[0] * w.dims[1];
 }
 
-ARRP set_div_num(ARRP v, double scalar) {
-    __mul_num(&v, &v, 1/scalar);
-    return v;
+arrtype_t view_type(ARRV w) {
+    return w.arr->type;
 }
 
+double view_elt(ARRV w, size_t dim0, size_t dim1) {
+    size_t ixs[2] = {dim0, dim1};
+    check_valid_ix(w.dims, ixs);
+    size_t ix = w.offset + dim0 * w.strides[0] + dim1 * w.strides[1];
+    if (!is_numeric_type(w.arr->type)) {
+        fprintf(stderr, "view_elt: unsupported type: %s\n",
+                arrtype_str(w.arr->type));
+        exit(1);
+    }
+    return _load_real(w.arr, ix);
+}
 
 
-/*
-                FILL VALUES
-*/
+int view_is_na(ARRV w, size_t dim0, size_t dim1) {
+    size_t ixs[2] = {dim0, dim1};
+    check_valid_ix(w.dims, ixs);
+    size_t ix = w.offset + dim0 * w.strides[0] + dim1 * w.strides[1];
+    return w.arr->valid && !bitmap_get(w.arr->valid, ix);
+}
+
 
 /*
-    array type unaffected
+    Copy n elements of a view, starting at row-major position start, into
+    buf as doubles. Lets other modules stream any view (any type, strides or
+    layout) through a small cache-resident buffer.
 */
-ARRP set_fill_num(ARRP v, double start, double step) {
-    switch (arrtype(v))
-    {
+#define GATHER_LOOP(FIELD) \
+    for (size_t k = 0; k < n; ++k) { \
+        buf[k] = w.arr->FIELD[ix]; \
+        if (++j == ncol) { \
+            j = 0; \
+            ++i; \
+            ix = w.offset + i * w.strides[0]; \
+        } else { \
+            ix += w.strides[1]; \
+        } \
+    }
+void view_gather_reals(ARRV w, size_t start, size_t n, double *buf) {
+    size_t ncol = w.dims[1];
+    if (start + n > view_length(w)) {
+        fprintf(stderr, "view_gather_reals: out of bounds\n");
+        exit(1);
+    }
+    size_t i = start / ncol, j = start % ncol;
+    size_t ix = w.offset + i * w.strides[0] + j * w.strides[1];
+    switch (w.arr->type) {
     case INTS_ARR:
-        for (size_t i=0; i < length(v); ++i) {
-            integer(v)[i] = (int)(start + step * i);
-        }
+        GATHER_LOOP(ints)
         break;
     case REALS_ARR:
-        for (size_t i=0; i < length(v); ++i) {
-            real(v)[i] = start + step * i;
-        }
+        GATHER_LOOP(reals)
+        break;
+    case FLOATS_ARR:
+        GATHER_LOOP(floats)
+        break;
+    case LONGS_ARR:
+        GATHER_LOOP(longs)
+        break;
+    case BOOLS_ARR:
+        GATHER_LOOP(bools)
         break;
     default:
-        fprintf(stderr, "set_fill_num: unsupported type: %s",
-                arrtype_str(arrtype(v)));
+        fprintf(stderr, "view_gather_reals: unsupported type: %s\n",
+                arrtype_str(w.arr->type));
         exit(1);
-        break;
     }
-    return v;
-}
-
-
-
-#include <rand/rng.h>
-ARRP set_rand_unif(ARRP v, uint32_t seed) {
-    if (arrtype(v) != REALS_ARR) {
-        fprintf(stderr, "set_rand_unif: must be REALS_ARR\n");
-        exit(1);
+    if (w.arr->valid) {
+        // missing elements read as NaN
+        for (size_t k = 0; k < n; ++k) {
+            size_t kk = start + k;
+            if (!bitmap_get(w.arr->valid, w.offset + (kk / ncol) * w.strides[0]
+                                          + (kk % ncol) * w.strides[1]))
+                buf[k] = NAN;
+        }
     }
-    MTRand r = seedRand(seed);
-    for (size_t i=0; i < length(v); ++i)
-        real(v)[i] = genRand(&r);
-    return v;
 }
 
 
-ARRP set_fill_str(ARRP v, const char *val) {
-    if (arrtype(v) != STRINGS_ARR) {
-        fprintf(stderr, "set_fill_str: unsupported type: %s",
-                arrtype_str(arrtype(v)));
+/*
+    Element-wise kernels walk views as `nrun` runs of `runlen` elements.
+    Run r of operand k starts at start[k] + r * outer[k] and steps by
+    inner[k]. When every operand is flat in the same order (no gap between
+    its rows, or between its columns) the whole view is walked as a single
+    run; otherwise runs follow the contiguous direction of the output
+    (the last operand).
+*/
+typedef struct _runs {
+    size_t nrun;
+    size_t runlen;
+    size_t start[3];
+    size_t outer[3];
+    size_t inner[3];
+} _runs;
+
+/*rows follow each other in memory*/
+static int _view_flat(ARRV w) {
+    return w.strides[0] == w.dims[1] * w.strides[1];
+}
+
+/*columns follow each other in memory*/
+static int _view_cflat(ARRV w) {
+    return w.strides[1] == w.dims[0] * w.strides[0];
+}
+
+/*views must have the same shape, or the same length if they are all flat*/
+static _runs _view_runs(const ARRV *ws, int nw, const char *caller) {
+    _runs rs;
+    int flat = 1, cflat = 1, same = 1;
+    for (int k = 0; k < nw; ++k) {
+        flat = flat && _view_flat(ws[k]);
+        cflat = cflat && _view_cflat(ws[k]);
+        same = same && ws[k].dims[0] == ws[0].dims[0]
+                    && ws[k].dims[1] == ws[0].dims[1];
+        if (view_length(ws[k]) != view_length(ws[0])) {
+            fprintf(stderr, "%s: lengths are not compatible\n", caller);
+            exit(1);
+        }
+    }
+    if (!same && !flat) {
+        fprintf(stderr, "%s: dimensions are not compatible\n", caller);
         exit(1);
     }
-    for (size_t i=0; i < dims(v)[0]; ++i) {
-        for (size_t j=0; j < dims(v)[1]; ++j)
-            set_strings_elt(v, i, j, val);
+    // walk by columns when that is the flat (or output-contiguous) order
+    const ARRV *out = &ws[nw - 1];
+    int colwise = !flat && (cflat || out->strides[0] < out->strides[1]);
+    int axis = colwise ? 1 : 0;
+    if (flat || cflat) {
+        rs.nrun = 1;
+        rs.runlen = view_length(ws[0]);
+    } else {
+        rs.nrun = ws[0].dims[axis];
+        rs.runlen = ws[0].dims[1 - axis];
     }
-    return v;
+    for (int k = 0; k < nw; ++k) {
+        rs.start[k] = ws[k].offset;
+        rs.outer[k] = ws[k].strides[axis];
+        rs.inner[k] = ws[k].strides[1 - axis];
+    }
+    return rs;
 }
 
-
 /*
-                ELEMENT-WISE FUNCTIONS
+    Loop `stmt` over the runs of 1, 2 or 3 views. The named index variables
+    hold the flat element index of the current element of each operand.
 */
+#define RUNS_LOOP1(rs, a, stmt) \
+    for (size_t _r = 0; _r < (rs).nrun; ++_r) { \
+        size_t a = (rs).start[0] + _r * (rs).outer[0]; \
+        for (size_t _k = 0; _k < (rs).runlen; ++_k, a += (rs).inner[0]) { \
+            stmt; \
+        } \
+    }
+#define RUNS_LOOP2(rs, a, o, stmt) \
+    for (size_t _r = 0; _r < (rs).nrun; ++_r) { \
+        size_t a = (rs).start[0] + _r * (rs).outer[0]; \
+        size_t o = (rs).start[1] + _r * (rs).outer[1]; \
+        for (size_t _k = 0; _k < (rs).runlen; ++_k, a += (rs).inner[0], \
+                                                    o += (rs).inner[1]) { \
+            stmt; \
+        } \
+    }
+#define RUNS_LOOP3(rs, a, b, o, stmt) \
+    for (size_t _r = 0; _r < (rs).nrun; ++_r) { \
+        size_t a = (rs).start[0] + _r * (rs).outer[0]; \
+        size_t b = (rs).start[1] + _r * (rs).outer[1]; \
+        size_t o = (rs).start[2] + _r * (rs).outer[2]; \
+        for (size_t _k = 0; _k < (rs).runlen; ++_k, a += (rs).inner[0], \
+                                                    b += (rs).inner[1], \
+                                                    o += (rs).inner[2]) { \
+            stmt; \
+        } \
+    }
 
 
 /*
-    array type unaffected 
+    Validity of the output (last view) of an element-wise kernel: present
+    where every input is. Nothing is done when no view has a bitmap; runs
+    with unit strides are combined a word (64 elements) at a time.
 */
-void __arrp_pow2(ARRP *vin, ARRP *vout) {
-    switch (arrtype(*vin))
-    {
-    case INTS_ARR:
-        for (size_t i=0; i < length(*vin); ++i) {
-            int num = integer(*vin)[i];
-            integer(*vout)[i] = num*num;
-        }
-        break;
-    case REALS_ARR:
-        for (size_t i=0; i < length(*vin); ++i) {
-            double num = real(*vin)[i];
-            real(*vout)[i] = num*num;
+static void _valid_runs(const ARRV *ws, int nw, _runs rs) {
+    ArrayStruct *out = ws[nw - 1].arr;
+    int any = (out->valid != NULL);
+    for (int k = 0; k < nw - 1; ++k)
+        any = any || ws[k].arr->valid;
+    if (!any)
+        return;
+    if (!out->valid)
+        out->valid = bitmap_alloc(out->capacity, 1);
+    int unit = 1;
+    for (int k = 0; k < nw; ++k)
+        unit = unit && rs.inner[k] == 1;
+    for (size_t r = 0; r < rs.nrun; ++r) {
+        size_t st[3];
+        for (int k = 0; k < nw; ++k)
+            st[k] = rs.start[k] + r * rs.outer[k];
+        if (unit) {
+            for (size_t i = 0; i < rs.runlen; i += 64) {
+                size_t m = (rs.runlen - i < 64) ? rs.runlen - i : 64;
+                uint64_t word = bitmap_mask(m);
+                for (int k = 0; k < nw - 1; ++k) {
+                    if (ws[k].arr->valid)
+                        word &= bitmap_word(ws[k].arr->valid, st[k] + i, m);
+                }
+                bitmap_put(out->valid, st[nw - 1] + i, m, word);
+            }
+        } else {
+            for (size_t i = 0; i < rs.runlen; ++i) {
+                int present = 1;
+                for (int k = 0; k < nw - 1; ++k) {
+                    if (ws[k].arr->valid)
+                        present = present && bitmap_get(ws[k].arr->valid, st[k] + i * rs.inner[k]);
+                }
+                size_t o = st[nw - 1] + i * rs.inner[nw - 1];
+                if (present) bitmap_set(out->valid, o); else bitmap_clear(out->valid, o);
+            }
         }
-        break;
+    }
+}
+
+/*number of NA elements in a view*/
+static size_t _view_na_count(ARRV w) {
+    if (!w.arr->valid)
+        return 0;
+    ARRV ws[1] = {w};
+    _runs rs = _view_runs(ws, 1, "na_count");
+    size_t present = 0;
+    for (size_t r = 0; r < rs.nrun; ++r) {
+        size_t st = rs.start[0] + r * rs.outer[0];
+        if (rs.inner[0] == 1) {
+            present += bitmap_count(w.arr->valid, st, rs.runlen);
+        } else {
+            for (size_t i = 0; i < rs.runlen; ++i)
+                present += bitmap_get(w.arr->valid, st + i * rs.inner[0]);
+        }
+    }
+    return view_length(w) - present;
+}
+
+static void __copy_runs(ARRV vin, ARRV vout) {
+    ARRV ws[2] = {vin, vout};
+    _runs rs = _view_runs(ws, 2, "copy_view");
+    _valid_runs(ws, 2, rs);
+    if (vin.arr->type != vout.arr->type) {
+        // numeric conversion
+        RUNS_LOOP2(rs, i, o, _store_real(vout.arr, o, _load_real(vin.arr, i)));
+        return;
+    }
+    switch (vout.arr->type) {
+    case INTS_ARR:
+        RUNS_LOOP2(rs, i, o, vout.arr->ints[o] = vin.arr->ints[i]);
+        break;
+    case REALS_ARR:
+        RUNS_LOOP2(rs, i, o, vout.arr->reals[o] = vin.arr->reals[i]);
+        break;
+    case FLOATS_ARR:
+        RUNS_LOOP2(rs, i, o, vout.arr->floats[o] = vin.arr->floats[i]);
+        break;
+    case LONGS_ARR:
+        RUNS_LOOP2(rs, i, o, vout.arr->longs[o] = vin.arr->longs[i]);
+        break;
+    case BOOLS_ARR:
+        RUNS_LOOP2(rs, i, o, vout.arr->bools[o] = vin.arr->bools[i]);
+        break;
+    case STRINGS_ARR:
+        // same bookkeeping as set_strings_elt
+        RUNS_LOOP2(rs, i, o,
+            if (vout.arr->strings[o]) {
+                chk_free(vout.arr->strings[o]);
+                vout.arr->strings[o] = NULL;
+                vout.arr->nalloc--;
+            }
+            chk_strcpy(&vout.arr->strings[o], vin.arr->strings[i]);
+            vout.arr->nalloc += (vout.arr->strings[o] != NULL)
+        );
+        break;
+    default:
+        fprintf(stderr, "copy_view: unsupported type: %s\n",
+                arrtype_str(vout.arr->type));
+        exit(1);
+    }
+}
+
+/*
+    When input and output are contiguous in different directions (a
+    transpose or a layout change), copy tile by tile so both sides stay in
+    cache.
+*/
+#define COPY_TILE 32
+static void __copy_view(ARRV vin, ARRV vout) {
+    int in_rows = vin.strides[1] <= vin.strides[0];
+    int out_rows = vout.strides[1] <= vout.strides[0];
+    if (in_rows == out_rows || vin.dims[0] != vout.dims[0] ||
+        vin.dims[1] != vout.dims[1] || view_length(vin) <= COPY_TILE) {
+        __copy_runs(vin, vout);
+        return;
+    }
+    for (size_t i = 0; i < vin.dims[0]; i += COPY_TILE) {
+        size_t ni = vin.dims[0] - i < COPY_TILE ? vin.dims[0] - i : COPY_TILE;
+        for (size_t j = 0; j < vin.dims[1]; j += COPY_TILE) {
+            size_t nj = vin.dims[1] - j < COPY_TILE ? vin.dims[1] - j : COPY_TILE;
+            __copy_runs(subview(vin, i, j, ni, nj), subview(vout, i, j, ni, nj));
+        }
+    }
+}
+
+/*materialize a view into a new contiguous array of the view's shape*/
+ARRP copy_view(ARRV w) {
+    ARRP v = alloc_array(w.arr->type, w.dims[0], w.dims[1]);
+    __copy_view(w, view(v));
+    return v;
+}
+
+static int _is_integral(arrtype_t t) {
+    return t == INTS_ARR || t == LONGS_ARR || t == BOOLS_ARR;
+}
+
+/*
+    copy the elements of src into the elements of dst; numeric types are
+    converted, but reals are not truncated into an integer type
+*/
+void set_view(ARRV dst, ARRV src) {
+    arrtype_t td = dst.arr->type, ts = src.arr->type;
+    if ((td == STRINGS_ARR) != (ts == STRINGS_ARR) ||
+        (_is_integral(td) && !_is_integral(ts))) {
+        fprintf(stderr, "set_view: cannot copy %s into %s\n",
+                arrtype_str(ts), arrtype_str(td));
+        exit(1);
+    }
+    __copy_view(src, dst);
+}
+
+
+
+
+/*
+    ARRAY OPERATIONS
+*/
+
+
+/*
+                SCALAR OPS
+*/
+
+static ARRP _alloc_like_view(ARRV w, arrtype_t type) {
+    return alloc_array(type, w.dims[0], w.dims[1]);
+}
+
+/*logicals count as ints, as in the binary ops; other types are kept*/
+static arrtype_t _scalar_out_type(arrtype_t t) {
+    return (t == BOOLS_ARR) ? INTS_ARR : t;
+}
+
+static void _scalar_check_out(ARRV vin, ARRV vout, const char *fn) {
+    if (vout.arr->type != _scalar_out_type(vin.arr->type)) {
+        fprintf(stderr, "%s: cannot write %s into %s\n", fn,
+                arrtype_str(vin.arr->type), arrtype_str(vout.arr->type));
+        exit(1);
+    }
+}
+
+/*scalar is an exact int64 operand: finite, integral and in range*/
+static int _long_scalar(double scalar) {
+    return isfinite(scalar) && fabs(scalar) < 0x1p63 && scalar == trunc(scalar);
+}
+
+/*store a double result into LONGS_ARR, rejecting NaN and overflow*/
+static int64_t _long_result(double r, const char *fn) {
+    if (!(fabs(r) < 0x1p63)) {
+        fprintf(stderr, "%s: result %g does not fit LONGS_ARR\n", fn, r);
+        exit(1);
+    }
+    return (int64_t)r;
+}
+
+void __add_num(ARRV vin, ARRV vout, double scalar) {
+    ARRV ws[2] = {vin, vout};
+    _scalar_check_out(vin, vout, "__add_num");
+    _runs rs = _view_runs(ws, 2, "__add_num");
+    _valid_runs(ws, 2, rs);
+    switch (vin.arr->type)
+    {
+    case INTS_ARR:
+        RUNS_LOOP2(rs, i, o, vout.arr->ints[o] = vin.arr->ints[i] + scalar);
+        break;
+    case BOOLS_ARR:
+        RUNS_LOOP2(rs, i, o, vout.arr->ints[o] = vin.arr->bools[i] + scalar);
+        break;
+    case REALS_ARR:
+        RUNS_LOOP2(rs, i, o, vout.arr->reals[o] = vin.arr->reals[i] + scalar);
+        break;
+    case FLOATS_ARR:
+        RUNS_LOOP2(rs, i, o, vout.arr->floats[o] = vin.arr->floats[i] + (float)scalar);
+        break;
+    case LONGS_ARR:
+        if (_long_scalar(scalar)) {
+            // exact beyond 2^53, e.g. offsetting row ids
+            int64_t k = (int64_t)scalar;
+            RUNS_LOOP2(rs, i, o, vout.arr->longs[o] = vin.arr->longs[i] + k);
+        } else {
+            RUNS_LOOP2(rs, i, o, vout.arr->longs[o] =
+                       _long_result(vin.arr->longs[i] + scalar, "__add_num"));
+        }
+        break;
+    default:
+        fprintf(stderr, "__add_num: unsupported type: %s",
+                arrtype_str(vin.arr->type));
+        exit(1);
+        break;
+    }
+}
+
+ARRP add_num(ARRP v, double scalar) {
+    ARRP v2 = alloc_same(v, _scalar_out_type(arrtype(v)));
+    __add_num(view(v), view(v2), scalar);
+    return v2;
+}
+
+ARRP set_add_num(ARRP v, double scalar) {
+    __add_num(view(v), view(v), scalar);
+    return v;
+}
+
+ARRP add_num_view(ARRV w, double scalar) {
+    ARRP v2 = _alloc_like_view(w, _scalar_out_type(w.arr->type));
+    __add_num(w, view(v2), scalar);
+    return v2;
+}
+
+ARRV set_add_num_view(ARRV w, double scalar) {
+    __add_num(w, w, scalar);
+    return w;
+}
+
+
+void __mul_num(ARRV vin, ARRV vout, double scalar) {
+    ARRV ws[2] = {vin, vout};
+    _scalar_check_out(vin, vout, "__mul_num");
+    _runs rs = _view_runs(ws, 2, "__mul_num");
+    _valid_runs(ws, 2, rs);
+    switch (vin.arr->type)
+    {
+    case INTS_ARR:
+        RUNS_LOOP2(rs, i, o, vout.arr->ints[o] = vin.arr->ints[i] * scalar);
+        break;
+    case BOOLS_ARR:
+        RUNS_LOOP2(rs, i, o, vout.arr->ints[o] = vin.arr->bools[i] * scalar);
+        break;
+    case REALS_ARR:
+        RUNS_LOOP2(rs, i, o, vout.arr->reals[o] = vin.arr->reals[i] * scalar);
+        break;
+    case FLOATS_ARR:
+        RUNS_LOOP2(rs, i, o, vout.arr->floats[o] = vin.arr->floats[i] * (float)scalar);
+        break;
+    case LONGS_ARR:
+        if (_long_scalar(scalar)) {
+            // exact beyond 2^53, as in __add_num
+            int64_t k = (int64_t)scalar;
+            RUNS_LOOP2(rs, i, o, vout.arr->longs[o] = vin.arr->longs[i] * k);
+        } else {
+            RUNS_LOOP2(rs, i, o, vout.arr->longs[o] =
+                       _long_result(vin.arr->longs[i] * scalar, "__mul_num"));
+        }
+        break;
+    default:
+        fprintf(stderr, "__mul_num: unsupported type: %s",
+                arrtype_str(vin.arr->type));
+        exit(1);
+        break;
+    }
+}
+
+
+ARRP mul_num(ARRP v, double scalar) {
+    ARRP v2 = alloc_same(v, _scalar_out_type(arrtype(v)));
+    __mul_num(view(v), view(v2), scalar);
+    return v2;
+}
+
+ARRP set_mul_num(ARRP v, double scalar) {
+    __mul_num(view(v), view(v), scalar);
+    return v;
+}
+
+ARRP mul_num_view(ARRV w, double scalar) {
+    ARRP v2 = _alloc_like_view(w, _scalar_out_type(w.arr->type));
+    __mul_num(w, view(v2), scalar);
+    return v2;
+}
+
+ARRV set_mul_num_view(ARRV w, double scalar) {
+    __mul_num(w, w, scalar);
+    return w;
+}
+
+
+ARRP div_num(ARRP v, double scalar) {
+    ARRP v2 = alloc_same(v, _scalar_out_type(arrtype(v)));
+    __mul_num(view(v), view(v2), 1/scalar);
+    return v2;
+}
+
+ARRP set_div_num(ARRP v, double scalar) {
+    __mul_num(view(v), view(v), 1/scalar);
+    return v;
+}
+
+ARRP div_num_view(ARRV w, double scalar) {
+    ARRP v2 = _alloc_like_view(w, _scalar_out_type(w.arr->type));
+    __mul_num(w, view(v2), 1/scalar);
+    return v2;
+}
+
+ARRV set_div_num_view(ARRV w, double scalar) {
+    __mul_num(w, w, 1/scalar);
+    return w;
+}
+
+
+
+/*
+                FILL VALUES
+*/
+
+/*
+    array type unaffected
+*/
+/*
+    values follow row-major position within the view, whatever the layout
+*/
+void __fill_num(ARRV w, double start, double step) {
+    size_t ncol = w.dims[1];
+    for (size_t i = 0; i < w.dims[0]; ++i) {
+        size_t ix = w.offset + i * w.strides[0];
+        switch (w.arr->type)
+        {
+        case INTS_ARR:
+            for (size_t j = 0; j < ncol; ++j, ix += w.strides[1])
+                w.arr->ints[ix] = (int)(start + step * (i * ncol + j));
+            break;
+        case REALS_ARR:
+            for (size_t j = 0; j < ncol; ++j, ix += w.strides[1])
+                w.arr->reals[ix] = start + step * (i * ncol + j);
+            break;
+        case FLOATS_ARR:
+        case LONGS_ARR:
+        case BOOLS_ARR:
+            for (size_t j = 0; j < ncol; ++j, ix += w.strides[1])
+                _store_real(w.arr, ix, start + step * (i * ncol + j));
+            break;
+        default:
+            fprintf(stderr, "set_fill_num: unsupported type: %s",
+                    arrtype_str(w.arr->type));
+            exit(1);
+            break;
+        }
+    }
+    if (w.arr->valid) {
+        // filled elements are present
+        for (size_t i = 0; i < w.dims[0]; ++i) {
+            size_t ix = w.offset + i * w.strides[0];
+            for (size_t j = 0; j < ncol; ++j, ix += w.strides[1])
+                bitmap_set(w.arr->valid, ix);
+        }
+    }
+}
+
+ARRP set_fill_num(ARRP v, double start, double step) {
+    __fill_num(view(v), start, step);
+    return v;
+}
+
+ARRV set_fill_num_view(ARRV w, double start, double step) {
+    __fill_num(w, start, step);
+    return w;
+}
+
+
+
+/*
+    Large fills are split over threads: each jumps its copy of the seeded
+    generator to the start of its chunk, so the result is the serial
+    Mersenne Twister sequence whatever the thread count. Chunks are at
+    least JUMP_MIN long, since shorter jumps twist through every batch
+    before the chunk and cost as much as generating it.
+*/
+#include <rand/rng.h>
+#define RAND_UNIF_CHUNK JUMP_MIN
+typedef struct _unif_job {
+    double *x;
+    uint32_t seed;
+} _unif_job;
+
+static void _unif_worker(void *arg, size_t start, size_t end, int tid) {
+    _unif_job *job = (_unif_job*)arg;
+    MTRand r = seedRand(job->seed);
+    jumpRand(&r, start);
+    genRands(&r, job->x + start, end - start);
+}
+
+ARRP set_rand_unif(ARRP v, uint32_t seed) {
+    if (arrtype(v) != REALS_ARR) {
+        fprintf(stderr, "set_rand_unif: must be REALS_ARR\n");
+        exit(1);
+    }
+    size_t n = length(v);
+    int nthreads = parallel_nthreads(n / RAND_UNIF_CHUNK);
+    _unif_job job = {real(v), seed};
+    if (nthreads > 1)
+        initJumpRand();
+    parallel_for(n, nthreads, _unif_worker, &job);
+    chk_free(v.node->arr->valid);
+    v.node->arr->valid = NULL;
+    return v;
+}
+
+
+/*
+    Non-uniform fills. Each draws from one Mersenne Twister stream
+    seeded with seed; continuous deviates fill REALS_ARR, counts INTS_ARR.
+*/
+#include <rand/dist.h>
+static void _check_rand_fill(ARRP v, arrtype_t type, int ok, const char *caller) {
+    if (arrtype(v) != type) {
+        fprintf(stderr, "%s: must be %s\n", caller, arrtype_str(type));
+        exit(1);
+    }
+    if (!ok) {
+        fprintf(stderr, "%s: invalid parameters\n", caller);
+        exit(1);
+    }
+    chk_free(v.node->arr->valid);
+    v.node->arr->valid = NULL;
+}
+
+ARRP set_rand_norm(ARRP v, double mu, double sd, uint32_t seed) {
+    _check_rand_fill(v, REALS_ARR, sd >= 0, "set_rand_norm");
+    MTRand r = seedRand(seed);
+    double *x = real(v);
+    for (size_t i = 0; i < length(v); ++i)
+        x[i] = mu + sd * genNorm(&r);
+    return v;
+}
+
+ARRP set_rand_exp(ARRP v, double rate, uint32_t seed) {
+    _check_rand_fill(v, REALS_ARR, rate > 0, "set_rand_exp");
+    MTRand r = seedRand(seed);
+    double *x = real(v);
+    for (size_t i = 0; i < length(v); ++i)
+        x[i] = genExp(&r) / rate;
+    return v;
+}
+
+ARRP set_rand_gamma(ARRP v, double shape, double scale, uint32_t seed) {
+    _check_rand_fill(v, REALS_ARR, shape > 0 && scale > 0, "set_rand_gamma");
+    MTRand r = seedRand(seed);
+    double *x = real(v);
+    for (size_t i = 0; i < length(v); ++i)
+        x[i] = scale * genGamma(&r, shape);
+    return v;
+}
+
+ARRP set_rand_binom(ARRP v, int n, double p, uint32_t seed) {
+    _check_rand_fill(v, INTS_ARR, n >= 0 && p >= 0 && p <= 1, "set_rand_binom");
+    MTRand r = seedRand(seed);
+    int *x = integer(v);
+    for (size_t i = 0; i < length(v); ++i)
+        x[i] = genBinom(&r, n, p);
+    return v;
+}
+
+ARRP set_rand_pois(ARRP v, double lambda, uint32_t seed) {
+    _check_rand_fill(v, INTS_ARR, lambda >= 0 && lambda < 1e9, "set_rand_pois");
+    MTRand r = seedRand(seed);
+    int *x = integer(v);
+    for (size_t i = 0; i < length(v); ++i)
+        x[i] = genPois(&r, lambda);
+    return v;
+}
+
+/*
+    Uniform [0, 1) fill from Philox stream (seed, stream): element i is
+    always the i-th value of the stream, so the chunks filled by each
+    thread match a single-threaded fill bit for bit.
+*/
+#include <rand/philox.h>
+typedef struct _philox_job {
+    double *x;
+    uint32_t seed, stream;
+} _philox_job;
+
+static void _philox_worker(void *arg, size_t start, size_t end, int tid) {
+    _philox_job *job = (_philox_job*)arg;
+    PhiloxRand r = seedPhilox(job->seed, job->stream);
+    philoxSeek(&r, start);
+    philoxRands(&r, job->x + start, end - start);
+}
+
+ARRP set_rand_philox(ARRP v, uint32_t seed, uint32_t stream) {
+    if (arrtype(v) != REALS_ARR) {
+        fprintf(stderr, "set_rand_philox: must be REALS_ARR\n");
+        exit(1);
+    }
+    _philox_job job = {real(v), seed, stream};
+    size_t n = length(v);
+    // chunks well past a cache line per thread
+    parallel_for(n, parallel_nthreads(n / 4096 + 1), _philox_worker, &job);
+    chk_free(v.node->arr->valid);
+    v.node->arr->valid = NULL;
+    return v;
+}
+
+/*nrow x ncol uniforms from the next stream of global_seed*/
+ARRP rand_unif(size_t nrow, size_t ncol) {
+    ARRP v = alloc_array(REALS_ARR, nrow, ncol);
+    return set_rand_philox(v, global_seed, global_stream++);
+}
+
+ARRP set_fill_str(ARRP v, const char *val) {
+    if (arrtype(v) != STRINGS_ARR) {
+        fprintf(stderr, "set_fill_str: unsupported type: %s",
+                arrtype_str(arrtype(v)));
+        exit(1);
+    }
+    for (size_t i=0; i < dims(v)[0]; ++i) {
+        for (size_t j=0; j < dims(v)[1]; ++j)
+            set_strings_elt(v, i, j, val);
+    }
+    return v;
+}
+
+
+/*
+                ELEMENT-WISE FUNCTIONS
+*/
+
+
+/*
+    array type unaffected, except logicals give ints
+*/
+void __arrp_pow2(ARRV vin, ARRV vout) {
+    ARRV ws[2] = {vin, vout};
+    _scalar_check_out(vin, vout, "__arrp_pow2");
+    _runs rs = _view_runs(ws, 2, "__arrp_pow2");
+    _valid_runs(ws, 2, rs);
+    switch (vin.arr->type)
+    {
+    case INTS_ARR:
+        RUNS_LOOP2(rs, i, o, vout.arr->ints[o] = vin.arr->ints[i] * vin.arr->ints[i]);
+        break;
+    case BOOLS_ARR:
+        RUNS_LOOP2(rs, i, o, vout.arr->ints[o] = vin.arr->bools[i]);
+        break;
+    case REALS_ARR:
+        RUNS_LOOP2(rs, i, o, vout.arr->reals[o] = vin.arr->reals[i] * vin.arr->reals[i]);
+        break;
+    case FLOATS_ARR:
+        RUNS_LOOP2(rs, i, o, vout.arr->floats[o] = vin.arr->floats[i] * vin.arr->floats[i]);
+        break;
+    case LONGS_ARR:
+        RUNS_LOOP2(rs, i, o, vout.arr->longs[o] = vin.arr->longs[i] * vin.arr->longs[i]);
+        break;
     default:
         fprintf(stderr, "__arrp_pow2: unsupported type: %s",
-                arrtype_str(arrtype(*vin)));
+                arrtype_str(vin.arr->type));
         exit(1);
         break;
     }
 }
 ARRP arrp_pow2(ARRP v) {
-    ARRP v2 = alloc_same(v, arrtype(v));
-    __arrp_pow2(&v, &v2);
+    ARRP v2 = alloc_same(v, _scalar_out_type(arrtype(v)));
+    __arrp_pow2(view(v), view(v2));
     return v2;
 }
 ARRP set_arrp_pow2(ARRP v) {
-    __arrp_pow2(&v, &v);
+    __arrp_pow2(view(v), view(v));
     return v;
 }
+ARRP arrv_pow2(ARRV w) {
+    ARRP v2 = _alloc_like_view(w, _scalar_out_type(w.arr->type));
+    __arrp_pow2(w, view(v2));
+    return v2;
+}
+ARRV set_arrv_pow2(ARRV w) {
+    __arrp_pow2(w, w);
+    return w;
+}
 
 /*
     array type always converted to real
 */
-void __arrp_sqrt(ARRP *vin, ARRP *vout) {
-    switch (arrtype(*vin))
+void __arrp_sqrt(ARRV vin, ARRV vout) {
+    ARRV ws[2] = {vin, vout};
+    _runs rs = _view_runs(ws, 2, "__arrp_sqrt");
+    _valid_runs(ws, 2, rs);
+    switch (vin.arr->type)
     {
     case INTS_ARR:
-        for (size_t i=0; i < length(*vin); ++i) {
-            real(*vout)[i] = sqrt((double)integer(*vin)[i]);
-        }
+        RUNS_LOOP2(rs, i, o, vout.arr->reals[o] = sqrt((double)vin.arr->ints[i]));
+        break;
     case REALS_ARR:
-        for (size_t i=0; i < length(*vin); ++i) {
-            real(*vout)[i] = sqrt(real(*vin)[i]);
-        }
+        RUNS_LOOP2(rs, i, o, vout.arr->reals[o] = sqrt(vin.arr->reals[i]));
+        break;
+    case FLOATS_ARR:
+    case LONGS_ARR:
+    case BOOLS_ARR:
+        RUNS_LOOP2(rs, i, o, vout.arr->reals[o] = sqrt(_load_real(vin.arr, i)));
         break;
     default:
         fprintf(stderr, "__arrp_sqrt: unsupported type: %s",
-                arrtype_str(arrtype(*vin)));
+                arrtype_str(vin.arr->type));
         exit(1);
         break;
     }
 }
 ARRP arrp_sqrt(ARRP v) {
     ARRP v2 = alloc_same(v, REALS_ARR);
-    __arrp_sqrt(&v, &v2);
+    __arrp_sqrt(view(v), view(v2));
     return v2;
 }
 ARRP set_arrp_sqrt(ARRP v) {
     cast_reals(v);
-    __arrp_sqrt(&v, &v);
+    __arrp_sqrt(view(v), view(v));
     return v;
 }
+ARRP arrv_sqrt(ARRV w) {
+    ARRP v2 = _alloc_like_view(w, REALS_ARR);
+    __arrp_sqrt(w, view(v2));
+    return v2;
+}
+/*a view can't be cast, so only REALS_ARR views are modified in place*/
+ARRV set_arrv_sqrt(ARRV w) {
+    if (w.arr->type != REALS_ARR) {
+        fprintf(stderr, "set_arrv_sqrt: view must be of type REALS_ARR\n");
+        exit(1);
+    }
+    __arrp_sqrt(w, w);
+    return w;
+}
 
 
 /*
     Reciprocal
     array type always converted to real
 */
-void __arrp_recip(ARRP *vin, ARRP *vout) {
-    switch (arrtype(*vin))
+void __arrp_recip(ARRV vin, ARRV vout) {
+    ARRV ws[2] = {vin, vout};
+    _runs rs = _view_runs(ws, 2, "__arrp_recip");
+    _valid_runs(ws, 2, rs);
+    switch (vin.arr->type)
     {
     case INTS_ARR:
-        for (size_t i=0; i < length(*vin); ++i) {
-            real(*vout)[i] = 1. / (double)integer(*vin)[i];
-        }
+        RUNS_LOOP2(rs, i, o, vout.arr->reals[o] = 1. / (double)vin.arr->ints[i]);
+        break;
     case REALS_ARR:
-        for (size_t i=0; i < length(*vin); ++i) {
-            real(*vout)[i] = 1. / real(*vin)[i];
-        }
+        RUNS_LOOP2(rs, i, o, vout.arr->reals[o] = 1. / vin.arr->reals[i]);
+        break;
+    case FLOATS_ARR:
+    case LONGS_ARR:
+    case BOOLS_ARR:
+        RUNS_LOOP2(rs, i, o, vout.arr->reals[o] = 1. / _load_real(vin.arr, i));
         break;
     default:
-        fprintf(stderr, "__arrp_sqrt: unsupported type: %s",
-                arrtype_str(arrtype(*vin)));
+        fprintf(stderr, "__arrp_recip: unsupported type: %s",
+                arrtype_str(vin.arr->type));
         exit(1);
         break;
     }
 }
 ARRP arrp_recip(ARRP v) {
     ARRP v2 = alloc_same(v, REALS_ARR);
-    __arrp_recip(&v, &v2);
+    __arrp_recip(view(v), view(v2));
     return v2;
 }
 ARRP set_arrp_recip(ARRP v) {
     cast_reals(v);
-    __arrp_recip(&v, &v);
+    __arrp_recip(view(v), view(v));
     return v;
 }
 
@@ -724,199 +1784,771 @@ ARRP set_arrp_recip(ARRP v) {
 */
 
 /*
-    Add 2 arrays together.
-    Arrays must be of the same length.
-    If inplace is on, first array is modified in place.
+    Broadcasting follows NumPy: along each axis the operands' dims must be
+    equal, or one of them 1. A dim of 1 is stretched by giving it stride 0,
+    so a row or column vector is never copied out to the full shape.
 */
-ARRP __add(ARRP v1, ARRP v2, int inplace, int sign) {
-    size_t n1 = length(v1);
-    size_t n2 = length(v2);
-    if (arrtype(v1) == STRINGS_ARR || arrtype(v2) == STRINGS_ARR) {
-        fprintf(stderr, "__add: not implemented for STRINGS_ARR\n");
+static int _broadcastable(ARRV w, size_t dim0, size_t dim1) {
+    return (w.dims[0] == dim0 || w.dims[0] == 1) &&
+           (w.dims[1] == dim1 || w.dims[1] == 1);
+}
+
+/*views that can't be stretched are returned unchanged (see _view_runs)*/
+static ARRV _broadcast_to(ARRV w, size_t dim0, size_t dim1) {
+    if ((w.dims[0] == dim0 && w.dims[1] == dim1) ||
+        !_broadcastable(w, dim0, dim1))
+        return w;
+    if (w.dims[0] != dim0)
+        w.strides[0] = 0;
+    if (w.dims[1] != dim1)
+        w.strides[1] = 0;
+    w.dims[0] = dim0;
+    w.dims[1] = dim1;
+    return w;
+}
+
+/*w as a dim0 x dim1 view; only dims of 1 can be stretched*/
+ARRV broadcast_view(ARRV w, size_t dim0, size_t dim1) {
+    if (dim0 == 0 || dim1 == 0 || !_broadcastable(w, dim0, dim1)) {
+        fprintf(stderr, "broadcast_view: can't broadcast %zu x %zu to %zu x %zu\n",
+                w.dims[0], w.dims[1], dim0, dim1);
         exit(1);
     }
-    if (n1 != n2) {
-        fprintf(stderr, "__add: lengths are not compatible\n");
+    return _broadcast_to(w, dim0, dim1);
+}
+
+/*
+    Result shape of a binary op. Shapes that don't broadcast keep the lhs
+    shape, and are then only accepted if they have the same length.
+*/
+static void _broadcast_dims(ARRV w1, ARRV w2, size_t *out) {
+    for (int k = 0; k < 2; ++k) {
+        size_t a = w1.dims[k], b = w2.dims[k];
+        if (a != b && a != 1 && b != 1) {
+            out[0] = w1.dims[0];
+            out[1] = w1.dims[1];
+            return;
+        }
+        out[k] = (a == 1) ? b : a;
+    }
+}
+
+/*result of a binary op on w1, w2, with the given storage order*/
+static ARRP _alloc_binary(ARRV w1, ARRV w2, arrtype_t type, layout_t layout) {
+    size_t d[2];
+    _broadcast_dims(w1, w2, d);
+    return alloc_array_layout(type, d[0], d[1], layout);
+}
+
+/*stretch v1, v2 to the shape of the result, which must be vout's shape*/
+static void _broadcast_operands(ARRV *v1, ARRV *v2, ARRV vout, const char *caller) {
+    size_t d[2];
+    _broadcast_dims(*v1, *v2, d);
+    if (d[0] != vout.dims[0] || d[1] != vout.dims[1]) {
+        fprintf(stderr, "%s: result is %zu x %zu, output is %zu x %zu\n", caller,
+                d[0], d[1], vout.dims[0], vout.dims[1]);
+        exit(1);
+    }
+    *v1 = _broadcast_to(*v1, d[0], d[1]);
+    *v2 = _broadcast_to(*v2, d[0], d[1]);
+}
+
+/*
+    Binary ops are generated from one kernel template per (op, lhs type,
+    rhs type, output type). Operands are converted to the output type
+    before the op, so int + int into a REALS_ARR output is done in double.
+    Each run is walked with a plain unit-stride loop when it can be (the
+    common contiguous and broadcast-scalar cases), so the loop vectorizes.
+    Less common combinations (logicals, mixed float / integer) share one
+    kernel per op that goes through double.
+*/
+typedef enum {
+    _ADD_OP = 0,
+    _SUB_OP,
+    _MUL_OP,
+    _DIV_OP,
+    _N_BINARY_OPS
+} _binary_op_t;
+
+static const char *_binary_op_names[_N_BINARY_OPS] = {
+    "add", "subtract", "mul", "divide"
+};
+
+#define _BINOP_ADD(x, y) ((x) + (y))
+#define _BINOP_SUB(x, y) ((x) - (y))
+#define _BINOP_MUL(x, y) ((x) * (y))
+#define _BINOP_DIV(x, y) ((x) / (y))
+
+#define DEFINE_BINARY_KERNEL(name, OP, LT, lfield, RT, rfield, OT, ofield) \
+static void name(ARRV v1, ARRV v2, ARRV vout, _runs rs) { \
+    const LT *x = v1.arr->lfield; \
+    const RT *y = v2.arr->rfield; \
+    OT *z = vout.arr->ofield; \
+    size_t ix = rs.inner[0], iy = rs.inner[1], iz = rs.inner[2]; \
+    for (size_t r = 0; r < rs.nrun; ++r) { \
+        const LT *xr = x + rs.start[0] + r * rs.outer[0]; \
+        const RT *yr = y + rs.start[1] + r * rs.outer[1]; \
+        OT *zr = z + rs.start[2] + r * rs.outer[2]; \
+        if (ix == 1 && iy == 1 && iz == 1) { \
+            for (size_t k = 0; k < rs.runlen; ++k) \
+                zr[k] = OP((OT)xr[k], (OT)yr[k]); \
+        } else if (ix == 1 && iy == 0 && iz == 1) { \
+            const OT yk = (OT)yr[0]; \
+            for (size_t k = 0; k < rs.runlen; ++k) \
+                zr[k] = OP((OT)xr[k], yk); \
+        } else { \
+            for (size_t k = 0; k < rs.runlen; ++k) \
+                zr[k*iz] = OP((OT)xr[k*ix], (OT)yr[k*iy]); \
+        } \
+    } \
+}
+
+#define DEFINE_GENERIC_BINARY_KERNEL(name, OP) \
+static void name(ARRV v1, ARRV v2, ARRV vout, _runs rs) { \
+    RUNS_LOOP3(rs, a, b, o, _store_real(vout.arr, o, \
+        OP(_load_real(v1.arr, a), _load_real(v2.arr, b)))); \
+}
+
+/*
+    the typed combinations of an op: i / r / f / l are INTS_ARR /
+    REALS_ARR / FLOATS_ARR / LONGS_ARR, in lhs, rhs, output order
+*/
+#define DEFINE_BINARY_OP(op, OP) \
+    DEFINE_BINARY_KERNEL(_##op##_iii, OP, int, ints, int, ints, int, ints) \
+    DEFINE_BINARY_KERNEL(_##op##_rrr, OP, double, reals, double, reals, double, reals) \
+    DEFINE_BINARY_KERNEL(_##op##_fff, OP, float, floats, float, floats, float, floats) \
+    DEFINE_BINARY_KERNEL(_##op##_lll, OP, int64_t, longs, int64_t, longs, int64_t, longs) \
+    DEFINE_BINARY_KERNEL(_##op##_iir, OP, int, ints, int, ints, double, reals) \
+    DEFINE_BINARY_KERNEL(_##op##_llr, OP, int64_t, longs, int64_t, longs, double, reals) \
+    DEFINE_BINARY_KERNEL(_##op##_irr, OP, int, ints, double, reals, double, reals) \
+    DEFINE_BINARY_KERNEL(_##op##_rir, OP, double, reals, int, ints, double, reals) \
+    DEFINE_BINARY_KERNEL(_##op##_frr, OP, float, floats, double, reals, double, reals) \
+    DEFINE_BINARY_KERNEL(_##op##_rfr, OP, double, reals, float, floats, double, reals) \
+    DEFINE_BINARY_KERNEL(_##op##_lrr, OP, int64_t, longs, double, reals, double, reals) \
+    DEFINE_BINARY_KERNEL(_##op##_rlr, OP, double, reals, int64_t, longs, double, reals) \
+    DEFINE_BINARY_KERNEL(_##op##_ill, OP, int, ints, int64_t, longs, int64_t, longs) \
+    DEFINE_BINARY_KERNEL(_##op##_lil, OP, int64_t, longs, int, ints, int64_t, longs) \
+    DEFINE_BINARY_KERNEL(_##op##_frf, OP, float, floats, double, reals, float, floats) \
+    DEFINE_GENERIC_BINARY_KERNEL(_##op##_any, OP)
+
+DEFINE_BINARY_OP(add, _BINOP_ADD)
+DEFINE_BINARY_OP(sub, _BINOP_SUB)
+DEFINE_BINARY_OP(mul, _BINOP_MUL)
+DEFINE_BINARY_OP(div, _BINOP_DIV)
+
+typedef void (*_binary_fn)(ARRV v1, ARRV v2, ARRV vout, _runs rs);
+
+typedef enum {
+    _SLOT_I = 0,
+    _SLOT_R,
+    _SLOT_F,
+    _SLOT_L,
+    _SLOT_B,
+    _N_SLOTS
+} _binary_slot_t;
+
+static int _binary_slot(arrtype_t type) {
+    switch (type) {
+    case INTS_ARR: return _SLOT_I;
+    case REALS_ARR: return _SLOT_R;
+    case FLOATS_ARR: return _SLOT_F;
+    case LONGS_ARR: return _SLOT_L;
+    case BOOLS_ARR: return _SLOT_B;
+    default: return -1;
+    }
+}
+
+/*indexed [op][lhs][rhs][out] by _binary_slot; NULL entries use _op_any*/
+#define BINARY_TABLE_ENTRIES(OPE, op) \
+    [OPE][_SLOT_I][_SLOT_I][_SLOT_I] = _##op##_iii, \
+    [OPE][_SLOT_R][_SLOT_R][_SLOT_R] = _##op##_rrr, \
+    [OPE][_SLOT_F][_SLOT_F][_SLOT_F] = _##op##_fff, \
+    [OPE][_SLOT_L][_SLOT_L][_SLOT_L] = _##op##_lll, \
+    [OPE][_SLOT_I][_SLOT_I][_SLOT_R] = _##op##_iir, \
+    [OPE][_SLOT_L][_SLOT_L][_SLOT_R] = _##op##_llr, \
+    [OPE][_SLOT_I][_SLOT_R][_SLOT_R] = _##op##_irr, \
+    [OPE][_SLOT_R][_SLOT_I][_SLOT_R] = _##op##_rir, \
+    [OPE][_SLOT_F][_SLOT_R][_SLOT_R] = _##op##_frr, \
+    [OPE][_SLOT_R][_SLOT_F][_SLOT_R] = _##op##_rfr, \
+    [OPE][_SLOT_L][_SLOT_R][_SLOT_R] = _##op##_lrr, \
+    [OPE][_SLOT_R][_SLOT_L][_SLOT_R] = _##op##_rlr, \
+    [OPE][_SLOT_I][_SLOT_L][_SLOT_L] = _##op##_ill, \
+    [OPE][_SLOT_L][_SLOT_I][_SLOT_L] = _##op##_lil, \
+    [OPE][_SLOT_F][_SLOT_R][_SLOT_F] = _##op##_frf
+
+static const _binary_fn _binary_table[_N_BINARY_OPS][_N_SLOTS][_N_SLOTS][_N_SLOTS] = {
+    BINARY_TABLE_ENTRIES(_ADD_OP, add),
+    BINARY_TABLE_ENTRIES(_SUB_OP, sub),
+    BINARY_TABLE_ENTRIES(_MUL_OP, mul),
+    BINARY_TABLE_ENTRIES(_DIV_OP, div)
+};
+
+static const _binary_fn _binary_any[_N_BINARY_OPS] = {
+    _add_any, _sub_any, _mul_any, _div_any
+};
+
+/*
+    Result type, as in R / NumPy: logicals count as ints, integer types
+    widen to LONGS_ARR, FLOATS_ARR stays single only against FLOATS_ARR or
+    logicals (otherwise REALS_ARR, so integers aren't rounded to 24 bits),
+    and integer division is real.
+*/
+static arrtype_t _binary_promote(_binary_op_t op, arrtype_t t1, arrtype_t t2) {
+    if ((t1 == FLOATS_ARR || t1 == BOOLS_ARR) && (t2 == FLOATS_ARR || t2 == BOOLS_ARR) &&
+        (t1 == FLOATS_ARR || t2 == FLOATS_ARR))
+        return FLOATS_ARR;
+    if (_is_integral(t1) && _is_integral(t2)) {
+        if (op == _DIV_OP)
+            return REALS_ARR;
+        return (t1 == LONGS_ARR || t2 == LONGS_ARR) ? LONGS_ARR : INTS_ARR;
+    }
+    return REALS_ARR;
+}
+
+/*
+    vout may also be narrower than the promoted type when it is the lhs
+    of an in-place view op (a view can't be cast), as long as it is of the
+    same kind: an integer output needs integer operands. Logical outputs
+    are never written, and neither are integer quotients, since division
+    is always done in doubles.
+*/
+static int _binary_out_ok(_binary_op_t op, arrtype_t t1, arrtype_t t2, arrtype_t tout) {
+    if (tout == _binary_promote(op, t1, t2))
+        return 1;
+    if (tout != t1 || tout == BOOLS_ARR || (op == _DIV_OP && _is_integral(tout)))
+        return 0;
+    return !_is_integral(tout) || _is_integral(t2);
+}
+
+/*
+    An operand that reads the output's data through a different mapping
+    (e.g. a row of x broadcast over x) would be read after it has been
+    overwritten. The exact same view is fine: each element is read before
+    it is written.
+*/
+static int _view_overlaps_out(ARRV w, ARRV vout) {
+    if (w.arr != vout.arr || view_length(w) == 0 || view_length(vout) == 0)
+        return 0;
+    if (w.offset == vout.offset && w.dims[0] == vout.dims[0] && w.dims[1] == vout.dims[1] &&
+        w.strides[0] == vout.strides[0] && w.strides[1] == vout.strides[1])
+        return 0;
+    size_t whi = w.offset + (w.dims[0] - 1) * w.strides[0] + (w.dims[1] - 1) * w.strides[1];
+    size_t ohi = vout.offset + (vout.dims[0] - 1) * vout.strides[0] +
+                 (vout.dims[1] - 1) * vout.strides[1];
+    return w.offset <= ohi && vout.offset <= whi;
+}
+
+/*
+    Apply `op` elementwise into the view `vout`, whose type decides the
+    arithmetic. Shapes must broadcast to vout, or all have the same length.
+    Operands overlapping vout are copied first, as NumPy does.
+*/
+static void __binary_kernel(_binary_op_t op, ARRV v1, ARRV v2, ARRV vout) {
+    const char *caller = _binary_op_names[op];
+    ARRP c1 = empty(), c2 = empty();
+    if (_view_overlaps_out(v1, vout)) {
+        c1 = copy_view(v1);
+        v1 = view(c1);
+    }
+    if (_view_overlaps_out(v2, vout)) {
+        c2 = copy_view(v2);
+        v2 = view(c2);
+    }
+    _broadcast_operands(&v1, &v2, vout, caller);
+    ARRV ws[3] = {v1, v2, vout};
+    _runs rs = _view_runs(ws, 3, caller);
+    _valid_runs(ws, 3, rs);
+    int a = _binary_slot(v1.arr->type);
+    int b = _binary_slot(v2.arr->type);
+    int o = _binary_slot(vout.arr->type);
+    if (a < 0 || b < 0 || o < 0 ||
+        !_binary_out_ok(op, v1.arr->type, v2.arr->type, vout.arr->type)) {
+        fprintf(stderr, "%s: unsupported types: %s, %s -> %s\n", caller,
+                arrtype_str(v1.arr->type), arrtype_str(v2.arr->type),
+                arrtype_str(vout.arr->type));
         exit(1);
     }
-    arrtype_t newtype = arrtype(v1);
+    _binary_fn fn = _binary_table[op][a][b][o];
+    if (fn == NULL)
+        fn = _binary_any[op];
+    fn(v1, v2, vout, rs);
+    if (c1.node)
+        free_array(&c1);
+    if (c2.node)
+        free_array(&c2);
+}
+
+/*
+    If inplace is on, first array is modified in place, so it must already
+    have the shape of the result; it is cast to the result type.
+*/
+static ARRP __binary(_binary_op_t op, ARRP v1, ARRP v2, int inplace) {
+    arrtype_t type = _binary_promote(op, arrtype(v1), arrtype(v2));
     ARRP vnew;
     if (inplace) {
+        _cast_numeric(v1, type, _binary_op_names[op]);
         vnew = v1;
-    } else {
-        vnew = alloc_same(v1, newtype);
-    }
-    switch (newtype)
-    {
-    case INTS_ARR:
-        // both v1 and v2 have to be int
-        for (size_t i = 0; i < n1; ++i) {
-            integer(vnew)[i] = integer(v1)[i] + sign * integer(v2)[i];
-        }
-        break;
-    case REALS_ARR:
-        if (arrtype(v1) == INTS_ARR) {
-            // v2 must be real
-            for (size_t i = 0; i < n1; ++i) {
-                real(vnew)[i] = integer(v1)[i] + sign * real(v2)[i];
-            }
-        } else if (arrtype(v2) == INTS_ARR) {
-            // v1 must be real
-            for (size_t i = 0; i < n1; ++i) {
-                real(vnew)[i] = real(v1)[i] + sign * integer(v2)[i];
-            }
-        } else {
-            // both v1 and v2 are real
-            for (size_t i = 0; i < n1; ++i) {
-                real(vnew)[i] = real(v1)[i] + sign * real(v2)[i];
-            }
-        }
-        break;
-    case STRINGS_ARR:
-    case NULL_ARR:
-        break;
+    } else {
+        vnew = _alloc_binary(view(v1), view(v2), type, arrlayout(v1));
     }
+    __binary_kernel(op, view(v1), view(v2), view(vnew));
+    return vnew;
+}
+
+static ARRP __binary_view(_binary_op_t op, ARRV w1, ARRV w2) {
+    arrtype_t type = _binary_promote(op, w1.arr->type, w2.arr->type);
+    ARRP vnew = _alloc_binary(w1, w2, type, ROW_MAJOR);
+    __binary_kernel(op, w1, w2, view(vnew));
     return vnew;
 }
 
+/*a view can't be cast, so the lhs type is kept (see _binary_out_ok)*/
+static ARRV __set_binary_view(_binary_op_t op, ARRV w1, ARRV w2) {
+    __binary_kernel(op, w1, w2, w1);
+    return w1;
+}
+
 
 ARRP add(ARRP v1, ARRP v2) {
-    return __add(v1, v2, 0, 1);
+    return __binary(_ADD_OP, v1, v2, 0);
 }
 
 ARRP set_add(ARRP v1, ARRP v2) {
-    return __add(v1, v2, 1, 1);
+    return __binary(_ADD_OP, v1, v2, 1);
 }
 
 ARRP subtract(ARRP v1, ARRP v2) {
-    return __add(v1, v2, 0, -1);
+    return __binary(_SUB_OP, v1, v2, 0);
 }
 
 ARRP set_subtract(ARRP v1, ARRP v2) {
-    return __add(v1, v2, 1, -1);
+    return __binary(_SUB_OP, v1, v2, 1);
+}
+
+ARRP mul(ARRP v1, ARRP v2) {
+    return __binary(_MUL_OP, v1, v2, 0);
 }
 
+ARRP set_mul(ARRP v1, ARRP v2) {
+    return __binary(_MUL_OP, v1, v2, 1);
+}
 
-ARRP __mul(ARRP v1, ARRP v2, int inplace) {
-    size_t n1 = length(v1);
-    size_t n2 = length(v2);
-    if (arrtype(v1) == STRINGS_ARR || arrtype(v2) == STRINGS_ARR) {
-        fprintf(stderr, "__mul: not implemented for STRINGS_ARR\n");
+ARRP divide(ARRP v1, ARRP v2) {
+    return __binary(_DIV_OP, v1, v2, 0);
+}
+
+ARRP set_divide(ARRP v1, ARRP v2) {
+    return __binary(_DIV_OP, v1, v2, 1);
+}
+
+ARRP add_view(ARRV w1, ARRV w2) {
+    return __binary_view(_ADD_OP, w1, w2);
+}
+
+ARRV set_add_view(ARRV w1, ARRV w2) {
+    return __set_binary_view(_ADD_OP, w1, w2);
+}
+
+ARRP subtract_view(ARRV w1, ARRV w2) {
+    return __binary_view(_SUB_OP, w1, w2);
+}
+
+ARRV set_subtract_view(ARRV w1, ARRV w2) {
+    return __set_binary_view(_SUB_OP, w1, w2);
+}
+
+ARRP mul_view(ARRV w1, ARRV w2) {
+    return __binary_view(_MUL_OP, w1, w2);
+}
+
+ARRV set_mul_view(ARRV w1, ARRV w2) {
+    return __set_binary_view(_MUL_OP, w1, w2);
+}
+
+ARRP divide_view(ARRV w1, ARRV w2) {
+    return __binary_view(_DIV_OP, w1, w2);
+}
+
+ARRV set_divide_view(ARRV w1, ARRV w2) {
+    return __set_binary_view(_DIV_OP, w1, w2);
+}
+
+
+
+/*
+                REDUCTIONS
+*/
+
+/*
+    Sums are pairwise: blocks of up to PAIRWISE_BLOCK elements are summed
+    with 8 independent accumulators (so the loop pipelines / vectorizes),
+    and blocks are combined as a balanced tree, giving O(log n) error
+    growth instead of O(n). Integer sums are exact (int64 accumulators).
+*/
+#define PAIRWISE_BLOCK 128
+
+#define DEFINE_PAIRWISE_SUM(NAME, T) \
+static double NAME(const T *x, size_t n, size_t stride) { \
+    if (n < 8) { \
+        double res = 0.; \
+        for (size_t i = 0; i < n; ++i) \
+            res += x[i*stride]; \
+        return res; \
+    } else if (n <= PAIRWISE_BLOCK) { \
+        double r[8]; \
+        size_t i; \
+        for (int k = 0; k < 8; ++k) \
+            r[k] = x[k*stride]; \
+        for (i = 8; i + 8 <= n; i += 8) { \
+            r[0] += x[(i+0)*stride]; r[1] += x[(i+1)*stride]; \
+            r[2] += x[(i+2)*stride]; r[3] += x[(i+3)*stride]; \
+            r[4] += x[(i+4)*stride]; r[5] += x[(i+5)*stride]; \
+            r[6] += x[(i+6)*stride]; r[7] += x[(i+7)*stride]; \
+        } \
+        double res = ((r[0] + r[1]) + (r[2] + r[3])) + \
+                     ((r[4] + r[5]) + (r[6] + r[7])); \
+        for (; i < n; ++i) \
+            res += x[i*stride]; \
+        return res; \
+    } \
+    size_t n2 = n / 2; \
+    n2 -= n2 % 8; \
+    return NAME(x, n2, stride) + NAME(x + n2*stride, n - n2, stride); \
+}
+DEFINE_PAIRWISE_SUM(_pairwise_sum, double)
+DEFINE_PAIRWISE_SUM(_pairwise_sum_floats, float)
+
+/*exact integer sums (int64 accumulators)*/
+#define DEFINE_INTEGER_SUM(NAME, T) \
+static int64_t NAME(const T *x, size_t n, size_t stride) { \
+    int64_t r[4] = {0, 0, 0, 0}; \
+    size_t i; \
+    for (i = 0; i + 4 <= n; i += 4) { \
+        r[0] += x[(i+0)*stride]; r[1] += x[(i+1)*stride]; \
+        r[2] += x[(i+2)*stride]; r[3] += x[(i+3)*stride]; \
+    } \
+    for (; i < n; ++i) \
+        r[0] += x[i*stride]; \
+    return (r[0] + r[1]) + (r[2] + r[3]); \
+}
+DEFINE_INTEGER_SUM(_ints_sum, int)
+DEFINE_INTEGER_SUM(_longs_sum, int64_t)
+DEFINE_INTEGER_SUM(_bools_sum, uint8_t)
+
+/*compensated (Neumaier) accumulation, for combining partial sums*/
+static void _neumaier_add(double *sum, double *comp, double x) {
+    double t = *sum + x;
+    if (fabs(*sum) >= fabs(x))
+        *comp += (*sum - t) + x;
+    else
+        *comp += (x - t) + *sum;
+    *sum = t;
+}
+
+/*NaN is sticky in min/max, as in R*/
+#define MIN_STEP(m, x) ((m) = ((x) < (m) || (x) != (x)) ? (x) : (m))
+#define MAX_STEP(m, x) ((m) = ((x) > (m) || (x) != (x)) ? (x) : (m))
+
+/*
+    min/max/prod of one strided run, with 4 accumulators; T is the
+    element type
+*/
+#define DEFINE_RUN_REDUCE(NAME, T) \
+static double NAME(const T *x, size_t n, size_t stride, reduce_op_t op) { \
+    double r[4]; \
+    size_t i; \
+    switch (op) { \
+    case PROD_OP: \
+        r[0] = r[1] = r[2] = r[3] = 1.; \
+        for (i = 0; i + 4 <= n; i += 4) { \
+            r[0] *= x[(i+0)*stride]; r[1] *= x[(i+1)*stride]; \
+            r[2] *= x[(i+2)*stride]; r[3] *= x[(i+3)*stride]; \
+        } \
+        for (; i < n; ++i) r[0] *= x[i*stride]; \
+        return (r[0] * r[1]) * (r[2] * r[3]); \
+    case MIN_OP: \
+        r[0] = r[1] = r[2] = r[3] = x[0]; \
+        for (i = 0; i + 4 <= n; i += 4) { \
+            MIN_STEP(r[0], (double)x[(i+0)*stride]); MIN_STEP(r[1], (double)x[(i+1)*stride]); \
+            MIN_STEP(r[2], (double)x[(i+2)*stride]); MIN_STEP(r[3], (double)x[(i+3)*stride]); \
+        } \
+        for (; i < n; ++i) MIN_STEP(r[0], (double)x[i*stride]); \
+        MIN_STEP(r[0], r[1]); MIN_STEP(r[2], r[3]); MIN_STEP(r[0], r[2]); \
+        return r[0]; \
+    case MAX_OP: \
+        r[0] = r[1] = r[2] = r[3] = x[0]; \
+        for (i = 0; i + 4 <= n; i += 4) { \
+            MAX_STEP(r[0], (double)x[(i+0)*stride]); MAX_STEP(r[1], (double)x[(i+1)*stride]); \
+            MAX_STEP(r[2], (double)x[(i+2)*stride]); MAX_STEP(r[3], (double)x[(i+3)*stride]); \
+        } \
+        for (; i < n; ++i) MAX_STEP(r[0], (double)x[i*stride]); \
+        MAX_STEP(r[0], r[1]); MAX_STEP(r[2], r[3]); MAX_STEP(r[0], r[2]); \
+        return r[0]; \
+    default: \
+        fprintf(stderr, #NAME ": unsupported op: %d\n", op); \
+        exit(1); \
+    } \
+}
+DEFINE_RUN_REDUCE(_reduce_ints_run, int)
+DEFINE_RUN_REDUCE(_reduce_reals_run, double)
+DEFINE_RUN_REDUCE(_reduce_floats_run, float)
+DEFINE_RUN_REDUCE(_reduce_longs_run, int64_t)
+DEFINE_RUN_REDUCE(_reduce_bools_run, uint8_t)
+
+/*reduce one strided run of n > 0 elements starting at flat index start*/
+static double _reduce_run(const ArrayStruct *ar, size_t start, size_t n,
+                          size_t stride, reduce_op_t op) {
+    switch (ar->type) {
+    case INTS_ARR:
+        if (op == SUM_OP || op == MEAN_OP)
+            return (double)_ints_sum(ar->ints + start, n, stride);
+        return _reduce_ints_run(ar->ints + start, n, stride, op);
+    case REALS_ARR:
+        if (op == SUM_OP || op == MEAN_OP)
+            return _pairwise_sum(ar->reals + start, n, stride);
+        return _reduce_reals_run(ar->reals + start, n, stride, op);
+    case FLOATS_ARR:
+        if (op == SUM_OP || op == MEAN_OP)
+            return _pairwise_sum_floats(ar->floats + start, n, stride);
+        return _reduce_floats_run(ar->floats + start, n, stride, op);
+    case LONGS_ARR:
+        if (op == SUM_OP || op == MEAN_OP)
+            return (double)_longs_sum(ar->longs + start, n, stride);
+        return _reduce_longs_run(ar->longs + start, n, stride, op);
+    case BOOLS_ARR:
+        if (op == SUM_OP || op == MEAN_OP)
+            return (double)_bools_sum(ar->bools + start, n, stride);
+        return _reduce_bools_run(ar->bools + start, n, stride, op);
+    default:
+        fprintf(stderr, "reduce: unsupported type: %s\n", arrtype_str(ar->type));
         exit(1);
     }
-    if (n1 != n2) {
-        fprintf(stderr, "__mul: lengths are not compatible\n");
-        exit(1);
+}
+
+/*identity of the combine step: the reduction of no elements*/
+static double _reduce_identity(reduce_op_t op) {
+    switch (op) {
+    case PROD_OP:
+        return 1.;
+    case MIN_OP:
+        return INFINITY;
+    case MAX_OP:
+        return -INFINITY;
+    default:
+        return 0.;
     }
-    arrtype_t newtype = arrtype(v1);
-    ARRP vnew;
-    if (inplace) {
-        vnew = v1;
-    } else {
-        vnew = alloc_same(v1, newtype);
+}
+
+/*combine the reductions of two runs*/
+static double _reduce_combine(double acc, double x, reduce_op_t op) {
+    switch (op) {
+    case PROD_OP:
+        return acc * x;
+    case MIN_OP:
+        return MIN_STEP(acc, x);
+    case MAX_OP:
+        return MAX_STEP(acc, x);
+    default:
+        return acc + x;
     }
-    switch (newtype)
-    {
-    case INTS_ARR:
-        // both v1 and v2 have to be int
-        for (size_t i = 0; i < n1; ++i) {
-            integer(vnew)[i] = integer(v1)[i] * integer(v2)[i];
-        }
-        break;
-    case REALS_ARR:
-        if (arrtype(v1) == INTS_ARR) {
-            // v2 must be real
-            for (size_t i = 0; i < n1; ++i) {
-                real(vnew)[i] = integer(v1)[i] * real(v2)[i];
-            }
-        } else if (arrtype(v2) == INTS_ARR) {
-            // v1 must be real
-            for (size_t i = 0; i < n1; ++i) {
-                real(vnew)[i] = real(v1)[i] * integer(v2)[i];
+}
+
+
+double reduce_view(ARRV w, reduce_op_t op) {
+    if (_view_na_count(w) > 0)
+        return NAN;
+    ARRV ws[1] = {w};
+    _runs rs = _view_runs(ws, 1, "reduce_view");
+    double acc = 0., comp = 0.;
+    for (size_t r = 0; r < rs.nrun; ++r) {
+        double x = _reduce_run(w.arr, rs.start[0] + r * rs.outer[0], rs.runlen,
+                               rs.inner[0], op);
+        if (op == SUM_OP || op == MEAN_OP)
+            _neumaier_add(&acc, &comp, x);
+        else
+            acc = (r == 0) ? x : _reduce_combine(acc, x, op);
+    }
+    acc += comp;
+    return (op == MEAN_OP) ? acc / view_length(w) : acc;
+}
+
+/*
+    Reduction over the present elements of w. Unit-stride runs are read a
+    bitmap word at a time: a block of 64 present elements goes through
+    the same kernels as reduce_view, and only mixed words are walked bit
+    by bit. Empty reductions give 0 / 1 / NaN / Inf / -Inf, as in R.
+*/
+double reduce_view_na_rm(ARRV w, reduce_op_t op) {
+    if (!w.arr->valid)
+        return reduce_view(w, op);
+    ARRV ws[1] = {w};
+    _runs rs = _view_runs(ws, 1, "reduce_view_na_rm");
+    double acc = _reduce_identity(op);
+    double comp = 0.;
+    size_t count = 0;
+    int additive = (op == SUM_OP || op == MEAN_OP);
+    const uint64_t *valid = w.arr->valid;
+    for (size_t r = 0; r < rs.nrun; ++r) {
+        size_t st = rs.start[0] + r * rs.outer[0], inner = rs.inner[0];
+        for (size_t i = 0; i < rs.runlen; i += 64) {
+            size_t m = (rs.runlen - i < 64) ? rs.runlen - i : 64;
+            uint64_t word;
+            if (inner == 1) {
+                word = bitmap_word(valid, st + i, m);
+            } else {
+                word = 0;
+                for (size_t b = 0; b < m; ++b)
+                    word |= (uint64_t)bitmap_get(valid, st + (i + b) * inner) << b;
             }
-        } else {
-            // both v1 and v2 are real
-            for (size_t i = 0; i < n1; ++i) {
-                real(vnew)[i] = real(v1)[i] * real(v2)[i];
+            if (word == 0)
+                continue;
+            double x;
+            if (word == bitmap_mask(m)) {
+                x = _reduce_run(w.arr, st + i * inner, m, inner, op);
+                count += m;
+            } else {
+                x = _reduce_identity(op);
+                for (; word; word &= word - 1) {
+                    double y = _load_real(w.arr, st + (i + __builtin_ctzll(word)) * inner);
+                    x = additive ? x + y : _reduce_combine(x, y, op);
+                    ++count;
+                }
             }
+            if (additive)
+                _neumaier_add(&acc, &comp, x);
+            else
+                acc = _reduce_combine(acc, x, op);
         }
-        break;
-    case STRINGS_ARR:
-    case NULL_ARR:
-        break;
     }
-    return vnew;
+    acc += comp;
+    if (op == MEAN_OP)
+        return count ? acc / count : NAN;
+    return acc;
 }
 
+double sum_na_rm(ARRP v)  { return reduce_view_na_rm(view(v), SUM_OP); }
+double mean_na_rm(ARRP v) { return reduce_view_na_rm(view(v), MEAN_OP); }
 
-ARRP mul(ARRP v1, ARRP v2) {
-    return __mul(v1, v2, 0);
-}
+double sum_view(ARRV w)  { return reduce_view(w, SUM_OP); }
+double mean_view(ARRV w) { return reduce_view(w, MEAN_OP); }
+double min_view(ARRV w)  { return reduce_view(w, MIN_OP); }
+double max_view(ARRV w)  { return reduce_view(w, MAX_OP); }
+double prod_view(ARRV w) { return reduce_view(w, PROD_OP); }
 
-ARRP set_mul(ARRP v1, ARRP v2) {
-    return __mul(v1, v2, 1);
-}
+double sum(ARRP v)  { return reduce_view(view(v), SUM_OP); }
+double mean(ARRP v) { return reduce_view(view(v), MEAN_OP); }
+double min(ARRP v)  { return reduce_view(view(v), MIN_OP); }
+double max(ARRP v)  { return reduce_view(view(v), MAX_OP); }
+double prod(ARRP v) { return reduce_view(view(v), PROD_OP); }
 
 
-ARRP __div(ARRP v1, ARRP v2, int inplace) {
-    size_t n1 = length(v1);
-    size_t n2 = length(v2);
-    if (arrtype(v1) == STRINGS_ARR || arrtype(v2) == STRINGS_ARR) {
-        fprintf(stderr, "__div: not implemented for STRINGS_ARR\n");
-        exit(1);
+/*
+    Reduce every row of w into out[0..nrow).
+    When rows are contiguous each row is one run. Otherwise (e.g. column
+    sums of a row-major matrix) whole columns are folded into `out` at once,
+    so memory is still read in order; sums then go through blocks of
+    PAIRWISE_BLOCK columns combined with Neumaier compensation.
+*/
+#define FOLD_COLUMNS(T, FIELD) { \
+    const T *x = w.arr->FIELD + w.offset; \
+    for (size_t j0 = 0; j0 < ncol; j0 += PAIRWISE_BLOCK) { \
+        size_t j1 = (j0 + PAIRWISE_BLOCK < ncol) ? j0 + PAIRWISE_BLOCK : ncol; \
+        for (size_t j = j0; j < j1; ++j) { \
+            const T *xc = x + j * w.strides[1]; \
+            switch (op) { \
+            case PROD_OP: \
+                for (size_t i = 0; i < nrow; ++i) out[i] *= xc[i * w.strides[0]]; \
+                break; \
+            case MIN_OP: \
+                for (size_t i = 0; i < nrow; ++i) MIN_STEP(out[i], (double)xc[i * w.strides[0]]); \
+                break; \
+            case MAX_OP: \
+                for (size_t i = 0; i < nrow; ++i) MAX_STEP(out[i], (double)xc[i * w.strides[0]]); \
+                break; \
+            default: \
+                for (size_t i = 0; i < nrow; ++i) block[i] += xc[i * w.strides[0]]; \
+                break; \
+            } \
+        } \
+        if (op == SUM_OP || op == MEAN_OP) { \
+            for (size_t i = 0; i < nrow; ++i) { \
+                _neumaier_add(&out[i], &comp[i], block[i]); \
+                block[i] = 0.; \
+            } \
+        } \
+    } \
+}
+
+/*rows holding an NA reduce to NA*/
+static void _reduce_rows_na(ARRV w, double *out) {
+    if (!w.arr->valid)
+        return;
+    for (size_t i = 0; i < w.dims[0]; ++i) {
+        if (_view_na_count(subview(w, i, 0, 1, w.dims[1])) > 0)
+            out[i] = NAN;
     }
-    if (n1 != n2) {
-        fprintf(stderr, "__div: lengths are not compatible\n");
+}
+
+static void _reduce_rows(ARRV w, reduce_op_t op, double *out) {
+    size_t nrow = w.dims[0], ncol = w.dims[1];
+    if (!is_numeric_type(w.arr->type)) {
+        fprintf(stderr, "reduce: unsupported type: %s\n", arrtype_str(w.arr->type));
         exit(1);
     }
-    arrtype_t newtype = arrtype(v1);
-    ARRP vnew;
-    if (inplace) {
-        vnew = v1;
-    } else {
-        vnew = alloc_same(v1, newtype);
-    }
-    switch (newtype)
-    {
-    case INTS_ARR:
-        // both v1 and v2 have to be int
-        for (size_t i = 0; i < n1; ++i) {
-            integer(vnew)[i] = integer(v1)[i] / integer(v2)[i];
-        }
-        break;
-    case REALS_ARR:
-        if (arrtype(v1) == INTS_ARR) {
-            // v2 must be real
-            for (size_t i = 0; i < n1; ++i) {
-                real(vnew)[i] = integer(v1)[i] / real(v2)[i];
-            }
-        } else if (arrtype(v2) == INTS_ARR) {
-            // v1 must be real
-            for (size_t i = 0; i < n1; ++i) {
-                real(vnew)[i] = real(v1)[i] / integer(v2)[i];
-            }
-        } else {
-            // both v1 and v2 are real
-            for (size_t i = 0; i < n1; ++i) {
-                real(vnew)[i] = real(v1)[i] / real(v2)[i];
-            }
+    if (w.strides[1] <= w.strides[0] || nrow == 1) {
+        for (size_t i = 0; i < nrow; ++i) {
+            out[i] = _reduce_run(w.arr, w.offset + i * w.strides[0], ncol,
+                                 w.strides[1], op);
+            if (op == MEAN_OP)
+                out[i] /= ncol;
         }
-        break;
-    case STRINGS_ARR:
-    case NULL_ARR:
-        break;
+        _reduce_rows_na(w, out);
+        return;
     }
-    return vnew;
+    double *block = chk_calloc(nrow, sizeof(double));
+    double *comp = chk_calloc(nrow, sizeof(double));
+    for (size_t i = 0; i < nrow; ++i) {
+        out[i] = (op == PROD_OP) ? 1. :
+                 (op == MIN_OP || op == MAX_OP) ? view_elt(w, i, 0) : 0.;
+    }
+    switch (w.arr->type) {
+    case INTS_ARR:   FOLD_COLUMNS(int, ints) break;
+    case FLOATS_ARR: FOLD_COLUMNS(float, floats) break;
+    case LONGS_ARR:  FOLD_COLUMNS(int64_t, longs) break;
+    case BOOLS_ARR:  FOLD_COLUMNS(uint8_t, bools) break;
+    default:         FOLD_COLUMNS(double, reals) break;
+    }
+    for (size_t i = 0; i < nrow; ++i) {
+        out[i] += comp[i];
+        if (op == MEAN_OP)
+            out[i] /= ncol;
+    }
+    chk_free(block);
+    chk_free(comp);
+    _reduce_rows_na(w, out);
 }
 
-ARRP divide(ARRP v1, ARRP v2) {
-    return __div(v1, v2, 0);
+/*nrow x 1 array with the reduction of each row*/
+ARRP row_reduce_view(ARRV w, reduce_op_t op) {
+    ARRP out = alloc_array(REALS_ARR, w.dims[0], 1);
+    _reduce_rows(w, op, real(out));
+    return out;
 }
 
-ARRP set_divide(ARRP v1, ARRP v2) {
-    return __div(v1, v2, 1);
+/*1 x ncol array with the reduction of each column*/
+ARRP col_reduce_view(ARRV w, reduce_op_t op) {
+    ARRP out = alloc_array(REALS_ARR, 1, w.dims[1]);
+    _reduce_rows(transpose_view(w), op, real(out));
+    return out;
 }
 
+ARRP row_reduce(ARRP v, reduce_op_t op) { return row_reduce_view(view(v), op); }
+ARRP col_reduce(ARRP v, reduce_op_t op) { return col_reduce_view(view(v), op); }
+ARRP row_sums(ARRP v)  { return row_reduce_view(view(v), SUM_OP); }
+ARRP col_sums(ARRP v)  { return col_reduce_view(view(v), SUM_OP); }
+ARRP row_means(ARRP v) { return row_reduce_view(view(v), MEAN_OP); }
+ARRP col_means(ARRP v) { return col_reduce_view(view(v), MEAN_OP); }
+
 
 
 /*
@@ -924,38 +2556,30 @@ ARRP set_divide(ARRP v1, ARRP v2) {
 */
 ARRP row(const ARRP v, size_t dim0) {
     size_t nrow = dims(v)[0];
-    size_t ncol = dims(v)[1];
     if (dim0 >= nrow || dim0 < 0) {
         fprintf(stderr, "row: dim0 out of bounds\n");
         exit(1);
     }
-    ARRP v2 = alloc_array(arrtype(v), 1, ncol);
-    for (size_t j = 0; j < ncol; ++j) {
-        switch (arrtype(v))
-        {
-        case INTS_ARR:
-            set_ints_elt(v2, 0, j, ints_elt(v, dim0, j));
-            break;
-        case REALS_ARR:
-            set_reals_elt(v2, 0, j, reals_elt(v, dim0, j));
-            break;
-        case STRINGS_ARR:
-            set_strings_elt(v2, 0, j, strings_elt(v, dim0, j));
-            break;
-        default:
-            fprintf(stderr, "row: unsupported type: %s\n", arrtype_str(arrtype(v)));
-            exit(1);
-            break;
-        }
-    }
-    return v2;
+    return copy_view(row_view(v, dim0));
 }
 
 
 double *real_row_ptr(const ARRP v, size_t dim0) {
+    if (arrlayout(v) != ROW_MAJOR) {
+        fprintf(stderr, "real_row_ptr: rows are only contiguous in ROW_MAJOR arrays\n");
+        exit(1);
+    }
     return real(v) + dim0 * dims(v)[1];
 }
 
+double *real_col_ptr(const ARRP v, size_t dim1) {
+    if (arrlayout(v) != COL_MAJOR) {
+        fprintf(stderr, "real_col_ptr: cols are only contiguous in COL_MAJOR arrays\n");
+        exit(1);
+    }
+    return real(v) + dim1 * dims(v)[0];
+}
+
 
 void set_row(ARRP v, size_t dim0, ARRP vrow) {
     size_t nrow = dims(v)[0];
@@ -968,55 +2592,18 @@ void set_row(ARRP v, size_t dim0, ARRP vrow) {
         fprintf(stderr, "set_row: dimensions of row array are not compatible\n");
         exit(1);
     }
-    for (size_t j = 0; j < ncol; ++j) {
-        switch (arrtype(v))
-        {
-        case INTS_ARR:
-            set_ints_elt(v, dim0, j, ints_elt(vrow, 0, j));
-            break;
-        case REALS_ARR:
-            set_reals_elt(v, dim0, j, reals_elt(vrow, 0, j));
-            break;
-        case STRINGS_ARR:
-            set_strings_elt(v, dim0, j, strings_elt(vrow, 0, j));
-            break;
-        default:
-            fprintf(stderr, "set_row: unsupported type: %s\n", arrtype_str(arrtype(v)));
-            exit(1);
-            break;
-        }
-    }
+    set_view(row_view(v, dim0), view(vrow));
 }
 
 
 
 ARRP col(ARRP v, size_t dim1) {
-    size_t nrow = dims(v)[0];
     size_t ncol = dims(v)[1];
     if (dim1 >= ncol || dim1 < 0) {
         fprintf(stderr, "col: dim1 out of bounds\n");
         exit(1);
     }
-    ARRP v2 = alloc_array(arrtype(v), nrow, 1);
-    for (size_t i = 0; i < nrow; ++i) {
-        switch (arrtype(v))
-        {
-        case INTS_ARR:
-            set_ints_elt(v2, i, 0, ints_elt(v, i, dim1));
-            break;
-        case REALS_ARR:
-            set_reals_elt(v2, i, 0, reals_elt(v, i, dim1));
-            break;
-        case STRINGS_ARR:
-            set_strings_elt(v2, i, 0, strings_elt(v, i, dim1));
-            break;
-        default:
-            fprintf(stderr, "col: unsupported type: %s\n", arrtype_str(arrtype(v)));
-            exit(1);
-            break;
-        }
-    }
-    return v2;
+    return copy_view(col_view(v, dim1));
 }
 
 
@@ -1031,123 +2618,371 @@ ARRP set_col(ARRP v, size_t dim1, ARRP vcol) {
         fprintf(stderr, "set_col: dimensions of col array are not compatible\n");
         exit(1);
     }
-    for (size_t i = 0; i < nrow; ++i) {
-        switch (arrtype(v))
-        {
-        case INTS_ARR:
-            set_ints_elt(v, i, dim1, ints_elt(vcol, i, 0));
-            break;
-        case REALS_ARR:
-            set_reals_elt(v, i, dim1, reals_elt(vcol, i, 0));
-            break;
-        case STRINGS_ARR:
-            set_strings_elt(v, i, dim1, strings_elt(vcol, i, 0));
-            break;
-        default:
-            fprintf(stderr, "set_col: unsupported type: %s\n", arrtype_str(arrtype(v)));
-            exit(1);
-            break;
+    set_view(col_view(v, dim1), view(vcol));
+    return v;
+}
+
+
+
+/*
+    4 x 4 register block of C: 16 independent accumulators over k, with
+    8 strided loads per 16 multiply-adds. Stride agnostic, so the same
+    kernel serves every layout / transposed-view combination.
+    The kernel and the blocked loops around it are instantiated for double
+    and float elements; float products still accumulate in double, so
+    FLOATS_ARR halves the memory traffic without losing the sums.
+*/
+#define GEMM_MR 4
+#define GEMM_NR 4
+#define GEMM_ST(r, c, v) C[(r)*cs0 + (c)*cs1] += alpha * (v)
+
+#define DEFINE_GEMM_KERNEL(NAME, T) \
+static void NAME(size_t kn, double alpha, \
+                 const T *A, size_t as0, size_t as1, \
+                 const T *B, size_t bs0, size_t bs1, \
+                 T *C, size_t cs0, size_t cs1) { \
+    double c00 = 0, c01 = 0, c02 = 0, c03 = 0, c10 = 0, c11 = 0, c12 = 0, c13 = 0, \
+           c20 = 0, c21 = 0, c22 = 0, c23 = 0, c30 = 0, c31 = 0, c32 = 0, c33 = 0; \
+    for (size_t k = 0; k < kn; ++k) { \
+        const T *a = A + k*as1, *b = B + k*bs0; \
+        double a0 = a[0], a1 = a[as0], a2 = a[2*as0], a3 = a[3*as0]; \
+        double b0 = b[0], b1 = b[bs1], b2 = b[2*bs1], b3 = b[3*bs1]; \
+        c00 += a0*b0; c01 += a0*b1; c02 += a0*b2; c03 += a0*b3; \
+        c10 += a1*b0; c11 += a1*b1; c12 += a1*b2; c13 += a1*b3; \
+        c20 += a2*b0; c21 += a2*b1; c22 += a2*b2; c23 += a2*b3; \
+        c30 += a3*b0; c31 += a3*b1; c32 += a3*b2; c33 += a3*b3; \
+    } \
+    GEMM_ST(0,0,c00); GEMM_ST(0,1,c01); GEMM_ST(0,2,c02); GEMM_ST(0,3,c03); \
+    GEMM_ST(1,0,c10); GEMM_ST(1,1,c11); GEMM_ST(1,2,c12); GEMM_ST(1,3,c13); \
+    GEMM_ST(2,0,c20); GEMM_ST(2,1,c21); GEMM_ST(2,2,c22); GEMM_ST(2,3,c23); \
+    GEMM_ST(3,0,c30); GEMM_ST(3,1,c31); GEMM_ST(3,2,c32); GEMM_ST(3,3,c33); \
+}
+
+/*
+    All three loops are blocked so the panels of A and B being combined
+    stay in cache while the register kernel sweeps C; edges that don't fill
+    a 4 x 4 block fall back to dot products.
+*/
+#define GEMM_BLOCK 64
+#define GEMM_KBLOCK 256
+#define DEFINE_GEMM(NAME, KERNEL, T, FIELD) \
+static void NAME(double alpha, ARRV a, ARRV b, double beta, ARRV c) { \
+    size_t m = a.dims[0], n = b.dims[1], p = a.dims[1]; \
+    const T *A = a.arr->FIELD + a.offset; \
+    const T *B = b.arr->FIELD + b.offset; \
+    T *C = c.arr->FIELD + c.offset; \
+    size_t as0 = a.strides[0], as1 = a.strides[1]; \
+    size_t bs0 = b.strides[0], bs1 = b.strides[1]; \
+    size_t cs0 = c.strides[0], cs1 = c.strides[1]; \
+    for (size_t i = 0; i < m; ++i) { \
+        for (size_t j = 0; j < n; ++j) \
+            C[i*cs0 + j*cs1] = (beta == 0) ? 0 : beta * C[i*cs0 + j*cs1]; \
+    } \
+    for (size_t i0 = 0; i0 < m; i0 += GEMM_BLOCK) { \
+        size_t i1 = (i0 + GEMM_BLOCK < m) ? i0 + GEMM_BLOCK : m; \
+        for (size_t k0 = 0; k0 < p; k0 += GEMM_KBLOCK) { \
+            size_t k1 = (k0 + GEMM_KBLOCK < p) ? k0 + GEMM_KBLOCK : p; \
+            const T *Ak = A + k0*as1, *Bk = B + k0*bs0; \
+            for (size_t j0 = 0; j0 < n; j0 += GEMM_BLOCK) { \
+                size_t j1 = (j0 + GEMM_BLOCK < n) ? j0 + GEMM_BLOCK : n; \
+                size_t i, j; \
+                for (i = i0; i + GEMM_MR <= i1; i += GEMM_MR) { \
+                    for (j = j0; j + GEMM_NR <= j1; j += GEMM_NR) \
+                        KERNEL(k1 - k0, alpha, Ak + i*as0, as0, as1, \
+                               Bk + j*bs1, bs0, bs1, \
+                               C + i*cs0 + j*cs1, cs0, cs1); \
+                } \
+                /* ragged edges: rows i.. of the block, and columns j.. of */ \
+                /* the rows already covered */ \
+                size_t ie = i; \
+                for (i = i0; i < i1; ++i) { \
+                    for (j = (i < ie) ? j0 + (j1 - j0) / GEMM_NR * GEMM_NR : j0; \
+                         j < j1; ++j) { \
+                        double s = 0; \
+                        for (size_t k = 0; k < k1 - k0; ++k) \
+                            s += (double)Ak[i*as0 + k*as1] * Bk[k*bs0 + j*bs1]; \
+                        C[i*cs0 + j*cs1] += alpha * s; \
+                    } \
+                } \
+            } \
+        } \
+    } \
+}
+
+DEFINE_GEMM_KERNEL(_gemm_kernel, double)
+DEFINE_GEMM_KERNEL(_gemm_kernel_floats, float)
+DEFINE_GEMM(_gemm_reals, _gemm_kernel, double, reals)
+DEFINE_GEMM(_gemm_floats, _gemm_kernel_floats, float, floats)
+
+/*
+    C = alpha * A %*% B + beta * C, on views that are all REALS_ARR or all
+    FLOATS_ARR (C must not overlap A or B). Any strides are accepted, so
+    transposed views and column-major operands cost nothing extra.
+*/
+void gemm_view(double alpha, ARRV a, ARRV b, double beta, ARRV c) {
+    arrtype_t t = c.arr->type;
+    if ((t != REALS_ARR && t != FLOATS_ARR) ||
+        a.arr->type != t || b.arr->type != t) {
+        fprintf(stderr, "gemm_view: operands must be all REALS_ARR or all FLOATS_ARR\n");
+        exit(1);
+    }
+    if (a.dims[1] != b.dims[0] ||
+        c.dims[0] != a.dims[0] || c.dims[1] != b.dims[1]) {
+        fprintf(stderr, "gemm_view: dimensions are not compatible\n");
+        exit(1);
+    }
+    if (t == FLOATS_ARR)
+        _gemm_floats(alpha, a, b, beta, c);
+    else
+        _gemm_reals(alpha, a, b, beta, c);
+}
+
+
+/*
+    C = alpha * A'A + beta * C, for symmetric C (p x p, A is n x p).
+    Only the upper-triangle tiles are computed (each a gemm_view on
+    subviews) and then mirrored, halving the work of a general crossprod.
+    Tiles are spread over threads; gemm_view doesn't allocate, so this is
+    safe off the main thread.
+*/
+#define SYRK_TILE 64
+typedef struct _syrk_job {
+    double alpha, beta;
+    ARRV a, c;
+    size_t ntile;
+    size_t *tiles;  // (row tile, col tile) pairs, upper triangle only
+} _syrk_job;
+
+static void _syrk_worker(void *arg, size_t start, size_t end, int tid) {
+    _syrk_job *job = (_syrk_job*)arg;
+    size_t p = job->c.dims[0], n = job->a.dims[0];
+    for (size_t t = start; t < end; ++t) {
+        size_t j0 = job->tiles[2*t] * SYRK_TILE, k0 = job->tiles[2*t + 1] * SYRK_TILE;
+        size_t nj = (p - j0 < SYRK_TILE) ? p - j0 : SYRK_TILE;
+        size_t nk = (p - k0 < SYRK_TILE) ? p - k0 : SYRK_TILE;
+        gemm_view(job->alpha, transpose_view(subview(job->a, 0, j0, n, nj)),
+                  subview(job->a, 0, k0, n, nk),
+                  job->beta, subview(job->c, j0, k0, nj, nk));
+    }
+}
+
+void syrk_view(double alpha, ARRV a, double beta, ARRV c) {
+    size_t p = a.dims[1];
+    if (c.dims[0] != p || c.dims[1] != p) {
+        fprintf(stderr, "syrk_view: dimensions are not compatible\n");
+        exit(1);
+    }
+    size_t nt = (p + SYRK_TILE - 1) / SYRK_TILE;
+    _syrk_job job = {alpha, beta, a, c, 0, NULL};
+    job.tiles = chk_malloc(nt * (nt + 1) * sizeof(size_t));
+    for (size_t j = 0; j < nt; ++j) {
+        for (size_t k = j; k < nt; ++k) {
+            job.tiles[2*job.ntile] = j;
+            job.tiles[2*job.ntile + 1] = k;
+            job.ntile++;
         }
     }
-    return v;
+    parallel_for(job.ntile, parallel_nthreads(job.ntile), _syrk_worker, &job);
+    chk_free(job.tiles);
+#define SYRK_MIRROR(FIELD) { \
+    for (size_t j = 0; j < p; ++j) { \
+        for (size_t k = j + 1; k < p; ++k) \
+            c.arr->FIELD[c.offset + k*c.strides[0] + j*c.strides[1]] = \
+                c.arr->FIELD[c.offset + j*c.strides[0] + k*c.strides[1]]; \
+    } \
+}
+    if (c.arr->type == FLOATS_ARR)
+        SYRK_MIRROR(floats)
+    else
+        SYRK_MIRROR(reals)
 }
 
 
+static void _swap_arraystruct(ARRP v1, ARRP v2);
 
-ARRP matmul(const ARRP m1, const ARRP m2) {
-    if (arrtype(m1) != REALS_ARR || arrtype(m2) != REALS_ARR) {
-        fprintf(stderr, "matmul: only REALS_ARR supported\n");
+/*
+    Dense products are done in single precision when both operands are
+    FLOATS_ARR, and in double otherwise; other numeric operands go through
+    a REALS_ARR copy.
+*/
+static arrtype_t _product_type(ARRP x, ARRP y) {
+    return (arrtype(x) == FLOATS_ARR && arrtype(y) == FLOATS_ARR) ? FLOATS_ARR : REALS_ARR;
+}
+
+/*v itself if it already has the product type, else a converted copy*/
+static ARRP _product_operand(ARRP v, arrtype_t type, const char *caller) {
+    if (arrtype(v) == type)
+        return v;
+    if (!is_numeric_type(arrtype(v))) {
+        fprintf(stderr, "%s: unsupported type: %s\n", caller, arrtype_str(arrtype(v)));
         exit(1);
     }
+    ARRP c = alloc_same(v, type);
+    set_view(view(c), view(v));
+    return c;
+}
+
+static void _free_product_operand(ARRP c, ARRP v) {
+    if (c.node != v.node)
+        free_array(&c);
+}
+
+/*
+    Missing values in products, as in R: an element of the product is NA
+    when its row of the lhs or its column of the rhs holds one (NA * 0 is
+    NA). _na_lines flags the rows (by_col = 0) or columns of v holding an
+    NA, or is NULL when there are none.
+*/
+static char *_na_lines(ARRP v, int by_col) {
+    ArrayStruct *ar = v.node->arr;
+    if (!has_na(v))
+        return NULL;
+    char *flag = chk_calloc(dims(v)[by_col], 1);
+    for (size_t i = 0; i < dims(v)[0]; ++i) {
+        for (size_t j = 0; j < dims(v)[1]; ++j) {
+            size_t ixs[2] = {i, j};
+            if (!bitmap_get(ar->valid, _as_ix(ar, ixs)))
+                flag[by_col ? j : i] = 1;
+        }
+    }
+    return flag;
+}
+
+static void _product_na(ARRP out, char *rows, char *cols) {
+    if (!rows && !cols)
+        return;
+    for (size_t i = 0; i < dims(out)[0]; ++i) {
+        for (size_t j = 0; j < dims(out)[1]; ++j) {
+            if ((rows && rows[i]) || (cols && cols[j]))
+                set_na(out, i, j);
+        }
+    }
+    chk_free(rows);
+    chk_free(cols);
+}
+
+/*product keeps the layout of m1*/
+ARRP matmul(const ARRP m1, const ARRP m2) {
+    if (is_sparse(m1) || is_sparse(m2))
+        return sparse_matmul(m1, 0, m2, 0);
     if (dims(m1)[1] != dims(m2)[0]) { // m1 cols must eq m2 rows
         fprintf(stderr, "__matmul: dimensions are not compatible\n");
         exit(1);
     }
-    ARRP out = alloc_array(REALS_ARR, dims(m1)[0], dims(m2)[1]); // m1.rows x m2.cols
-    double sum;
-    for (size_t i = 0; i < dims(m1)[0]; ++i) {
-        for (size_t j = 0; j < dims(m2)[1]; ++j) {
-            sum = 0;
-            for (size_t k = 0; k < dims(m1)[1]; ++k) {
-                sum += reals_elt(m1, i, k) * reals_elt(m2, k, j);
-            }
-            set_reals_elt(out, i, j, sum);
-        }
-    }
+    arrtype_t type = _product_type(m1, m2);
+    ARRP a = _product_operand(m1, type, "matmul");
+    ARRP b = (m2.node == m1.node) ? a : _product_operand(m2, type, "matmul");
+    ARRP out = alloc_array_layout(type, dims(m1)[0], dims(m2)[1], // m1.rows x m2.cols
+                                  arrlayout(m1));
+    gemm_view(1.0, view(a), view(b), 0.0, view(out));
+    _product_na(out, _na_lines(m1, 0), _na_lines(m2, 1));
+    if (b.node != a.node)
+        _free_product_operand(b, m2);
+    _free_product_operand(a, m1);
     return out;
 }
 
+/*m1 is replaced by the product (and takes its type)*/
 ARRP set_matmul(ARRP m1, const ARRP m2) {
-    // compute product
     ARRP prod = matmul(m1, m2);
-    // reshape m1 and copy product into it
-    m1 = resize_array(m1, length(prod));
-    m1.node->arr->dims[0] = dims(prod)[0];
-    m1.node->arr->dims[1] = dims(prod)[1];
-    for (size_t i = 0; i < length(prod); ++i) {
-        real(m1)[i] = real(prod)[i];
-    }
-    // discard temp array
+    _swap_arraystruct(m1, prod);
     free_array(&prod);
     return m1;
 }
 
 
+/*transposed copy, stored in the same layout as v*/
 ARRP transpose(const ARRP v) {
     size_t nrow = dims(v)[0];
     size_t ncol = dims(v)[1];
-    ARRP v2 = alloc_array(arrtype(v), ncol, nrow);
-    for (size_t i = 0; i < nrow; ++i) {
-        for (size_t j = 0; j < ncol; ++j) {
-            switch (arrtype(v))
-            {
-            case INTS_ARR:
-                set_ints_elt(v2, j, i, ints_elt(v, i, j));
-                break;
-            case REALS_ARR:
-                set_reals_elt(v2, j, i, reals_elt(v, i, j));
-                break;
-            case STRINGS_ARR:
-                set_strings_elt(v2, j, i, strings_elt(v, i, j));
-                break;
-            default:
-                fprintf(stderr, "transpose: unsupported type: %s\n", arrtype_str(arrtype(v)));
-                exit(1);
-                break;
-            }
-        }
+    if (!is_numeric_type(arrtype(v)) && arrtype(v) != STRINGS_ARR) {
+        fprintf(stderr, "transpose: unsupported type: %s\n", arrtype_str(arrtype(v)));
+        exit(1);
     }
+    ARRP v2 = alloc_array_layout(arrtype(v), ncol, nrow, arrlayout(v));
+    set_view(view(v2), transpose_view(view(v)));
     return v2;
 }
 
 
+/*exchange the contents of two arrays, leaving their memstack nodes in place*/
+static void _swap_arraystruct(ARRP v1, ARRP v2) {
+    ArrayStruct tmp = *v1.node->arr;
+    *v1.node->arr = *v2.node->arr;
+    *v2.node->arr = tmp;
+}
+
 ARRP set_transpose(ARRP v) {
     // perform transpose
     ARRP tmp = transpose(v);
-    // reshape v and copy transposed into it
-    v = resize_array(v, length(tmp));
-    v.node->arr->dims[0] = dims(tmp)[0];
-    v.node->arr->dims[1] = dims(tmp)[1];
-    for (size_t i=0; i < length(tmp); ++i) {
-        real(v)[i] = real(tmp)[i];
-    }
-    // discard temp array
+    // move transposed data into v and discard the old data
+    _swap_arraystruct(v, tmp);
+    free_array(&tmp);
+    return v;
+}
+
+
+/*copy of v with its elements stored in the given order*/
+ARRP as_layout(const ARRP v, layout_t layout) {
+    ARRP v2 = alloc_array_layout(arrtype(v), dims(v)[0], dims(v)[1], layout);
+    set_view(view(v2), view(v));
+    return v2;
+}
+
+/*reorder the elements of v in place (through one temporary buffer)*/
+ARRP set_layout(ARRP v, layout_t layout) {
+    if (arrlayout(v) == layout) {
+        return v;
+    }
+    ARRP tmp = as_layout(v, layout);
+    _swap_arraystruct(v, tmp);
     free_array(&tmp);
     return v;
 }
 
-/*X'Y*/
+/*X'Y, in the layout of X*/
 ARRP crossprod(const ARRP x, const ARRP y) {
-    ARRP out = transpose(x);
-    set_matmul(out, y);
+    if (dims(x)[0] != dims(y)[0]) {
+        fprintf(stderr, "crossprod: dimensions are not compatible\n");
+        exit(1);
+    }
+    if (is_sparse(x) || is_sparse(y)) {
+        return (x.node == y.node) ? sparse_gram(x, 0) : sparse_matmul(x, 1, y, 0);
+    }
+    arrtype_t type = _product_type(x, y);
+    ARRP a = _product_operand(x, type, "crossprod");
+    ARRP b = (y.node == x.node) ? a : _product_operand(y, type, "crossprod");
+    ARRP out = alloc_array_layout(type, dims(x)[1], dims(y)[1], arrlayout(x));
+    if (x.node == y.node) {
+        // X'X is symmetric: compute one triangle
+        syrk_view(1.0, view(a), 0.0, view(out));
+    } else {
+        gemm_view(1.0, transpose_view(view(a)), view(b), 0.0, view(out));
+    }
+    _product_na(out, _na_lines(x, 1), _na_lines(y, 1));
+    if (b.node != a.node)
+        _free_product_operand(b, y);
+    _free_product_operand(a, x);
     return out;
 }
 
-/*XY'*/
+/*XY', in the layout of X*/
 ARRP tcrossprod(const ARRP x, const ARRP y) {
-    ARRP yt = transpose(y);
-    ARRP out = matmul(x, yt);
-    free_array(&yt);
+    if (dims(x)[1] != dims(y)[1]) {
+        fprintf(stderr, "tcrossprod: dimensions are not compatible\n");
+        exit(1);
+    }
+    if (is_sparse(x) || is_sparse(y)) {
+        return (x.node == y.node) ? sparse_gram(x, 1) : sparse_matmul(x, 0, y, 1);
+    }
+    arrtype_t type = _product_type(x, y);
+    ARRP a = _product_operand(x, type, "tcrossprod");
+    ARRP b = (y.node == x.node) ? a : _product_operand(y, type, "tcrossprod");
+    ARRP out = alloc_array_layout(type, dims(x)[0], dims(y)[0], arrlayout(x));
+    gemm_view(1.0, view(a), transpose_view(view(b)), 0.0, view(out));
+    _product_na(out, _na_lines(x, 0), _na_lines(y, 0));
+    if (b.node != a.node)
+        _free_product_operand(b, y);
+    _free_product_operand(a, x);
     return out;
 }
-
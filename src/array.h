@@ -3,7 +3,7 @@
 
 
 #include <stdlib.h> // size_t
-#include <stdint.h> // uint32_t
+#include <stdint.h> // uint32_t, int64_t
 
 
 /*
@@ -14,21 +14,41 @@ typedef enum {
     INTS_ARR = 0,
     REALS_ARR,
     STRINGS_ARR,
+    CSR_ARR,        // sparse reals, compressed sparse rows
+    CSC_ARR,        // sparse reals, compressed sparse columns
+    FLOATS_ARR,     // 32-bit reals
+    LONGS_ARR,      // 64-bit integers
+    BOOLS_ARR,      // logicals, one byte (0 / 1) per element
     NULL_ARR
 } arrtype_t;
 
 const char *arrtype_str(arrtype_t t);
 
+/*order in which the elements of a matrix are stored*/
+typedef enum {
+    ROW_MAJOR = 0,
+    COL_MAJOR
+} layout_t;
+
+const char *layout_str(layout_t l);
+
 
 typedef struct ArrayStruct {
     arrtype_t type;         // type of data contained by vector
+    layout_t layout;        // storage order of matrix elements
     void *data;             // pointer to the memory allocated for the vector
     int *ints;              // pointer to data, if type is INTS_ARR
     double *reals;        // pointer to data, if type is REALS_ARR
     char **strings;         // pointer to data, if type is STRINGS_ARR
+    float *floats;          // pointer to data, if type is FLOATS_ARR
+    int64_t *longs;         // pointer to data, if type is LONGS_ARR
+    uint8_t *bools;         // pointer to data, if type is BOOLS_ARR
     size_t capacity;        // vector capacity / length
     size_t nalloc;          // number of allocated elements (differs from capacity only for STRINGS_ARR)
     size_t dims[2];
+    size_t *ptr;            // CSR_ARR / CSC_ARR: start of each row / column in reals and idx
+    size_t *idx;            // CSR_ARR / CSC_ARR: column / row index of each stored value
+    uint64_t *valid;        // validity bitmap by flat index (set = present), NULL if no NAs
 } ArrayStruct;
 
 void alloc_array_struct(ArrayStruct *ar, arrtype_t type, size_t dim0, size_t dim1);
@@ -40,6 +60,7 @@ typedef struct ARRP {
 } ARRP;
 
 ARRP alloc_array(arrtype_t type, size_t dim0, size_t dim1);
+ARRP alloc_array_layout(arrtype_t type, size_t dim0, size_t dim1, layout_t layout);
 ARRP alloc_row_array(arrtype_t type, size_t length);
 ARRP resize_array(ARRP v, size_t newsize);
 ARRP empty();
@@ -57,6 +78,21 @@ double as_real(ARRP v, size_t dim0, size_t dim1);
 void set_reals_elt(ARRP v, size_t dim0, size_t dim1, double val);
 void cast_reals(ARRP v);
 //
+float *single(ARRP v);
+float floats_elt(ARRP v, size_t dim0, size_t dim1);
+void set_floats_elt(ARRP v, size_t dim0, size_t dim1, float val);
+void cast_floats(ARRP v);
+//
+int64_t *int64(ARRP v);
+int64_t longs_elt(ARRP v, size_t dim0, size_t dim1);
+void set_longs_elt(ARRP v, size_t dim0, size_t dim1, int64_t val);
+void cast_longs(ARRP v);
+//
+uint8_t *logical(ARRP v);
+int bools_elt(ARRP v, size_t dim0, size_t dim1);
+void set_bools_elt(ARRP v, size_t dim0, size_t dim1, int val);
+void cast_bools(ARRP v);
+//
 const char *strings_elt(ARRP v, size_t dim0, size_t dim1);
 void set_strings_elt(ARRP v, size_t dim0, size_t dim1, const char *val);
 
@@ -64,6 +100,9 @@ size_t length(ARRP v);
 size_t capacity(ARRP v);
 size_t *dims(ARRP v);
 arrtype_t arrtype(ARRP v);
+layout_t arrlayout(ARRP v);
+int is_numeric_type(arrtype_t t);
+size_t arrtype_size(arrtype_t t);
 
 void* arrp_data(ARRP v); // generic version of real/integer
 ARRP alloc_same(const ARRP v, arrtype_t type);
@@ -72,6 +111,50 @@ int dims_eq(ARRP v1, ARRP v2);
 int ints_eq(ARRP v1, ARRP v2);
 int reals_eq_tol(ARRP v1, ARRP v2, double tol);
 
+
+/*
+    MISSING VALUES
+    An array has a validity bitmap only once an element is set to NA.
+    Element-wise ops mark a result NA where any operand is NA, reductions
+    return NA (NaN) if the view holds one unless they are _na_rm, and
+    set_*_elt / fills make elements present again. Writing through the raw
+    data pointers (real(), integer(), ...) leaves the bitmap alone.
+*/
+int has_na(ARRP v);
+size_t na_count(ARRP v);
+int is_na(ARRP v, size_t dim0, size_t dim1);
+void set_na(ARRP v, size_t dim0, size_t dim1);
+ARRP na_mask(ARRP v);
+
+
+/*
+    ARRAY VIEWS
+    Non-owning, strided windows onto the data of an ARRP. Views are plain
+    values - creating one allocates nothing, and a view is only valid for as
+    long as the array it looks into.
+*/
+typedef struct ARRV {
+    ArrayStruct *arr;       // array being viewed (not owned by the view)
+    size_t offset;          // flat index of the first element of the view
+    size_t dims[2];         // shape of the view
+    size_t strides[2];      // flat distance between consecutive rows / cols
+} ARRV;
+
+ARRV view(ARRP v);
+ARRV row_view(ARRP v, size_t dim0);
+ARRV col_view(ARRP v, size_t dim1);
+ARRV slice(ARRP v, size_t offset, size_t len, size_t stride);
+ARRV subview(ARRV w, size_t dim0, size_t dim1, size_t nrow, size_t ncol);
+ARRV transpose_view(ARRV w);
+ARRV broadcast_view(ARRV w, size_t dim0, size_t dim1);
+size_t view_length(ARRV w);
+arrtype_t view_type(ARRV w);
+double view_elt(ARRV w, size_t dim0, size_t dim1);
+int view_is_na(ARRV w, size_t dim0, size_t dim1);
+void view_gather_reals(ARRV w, size_t start, size_t n, double *buf);
+ARRP copy_view(ARRV w);
+void set_view(ARRV dst, ARRV src);
+
 /*
     ARRAY OPERATIONS
 */
@@ -84,11 +167,25 @@ ARRP mul_num(ARRP v, double scalar);
 ARRP set_mul_num(ARRP v, double scalar);
 ARRP div_num(ARRP v, double scalar);
 ARRP set_div_num(ARRP v, double scalar);
+ARRP add_num_view(ARRV w, double scalar);
+ARRV set_add_num_view(ARRV w, double scalar);
+ARRP mul_num_view(ARRV w, double scalar);
+ARRV set_mul_num_view(ARRV w, double scalar);
+ARRP div_num_view(ARRV w, double scalar);
+ARRV set_div_num_view(ARRV w, double scalar);
 /*
         FILL VALUES
 */
 ARRP set_fill_num(ARRP v, double start, double step);
+ARRV set_fill_num_view(ARRV w, double start, double step);
 ARRP set_rand_unif(ARRP v, uint32_t seed);
+ARRP set_rand_norm(ARRP v, double mu, double sd, uint32_t seed);
+ARRP set_rand_exp(ARRP v, double rate, uint32_t seed);
+ARRP set_rand_gamma(ARRP v, double shape, double scale, uint32_t seed);
+ARRP set_rand_binom(ARRP v, int n, double p, uint32_t seed);
+ARRP set_rand_pois(ARRP v, double lambda, uint32_t seed);
+ARRP set_rand_philox(ARRP v, uint32_t seed, uint32_t stream);
+ARRP rand_unif(size_t nrow, size_t ncol);
 ARRP set_fill_str(ARRP v, const char *val);
 /*
     ELEMENT-WISE FUNCTIONS
@@ -97,6 +194,10 @@ ARRP arrp_pow2(ARRP v);
 ARRP set_arrp_pow2(ARRP v);
 ARRP arrp_sqrt(ARRP v);
 ARRP set_arrp_sqrt(ARRP v);
+ARRP arrv_pow2(ARRV w);
+ARRV set_arrv_pow2(ARRV w);
+ARRP arrv_sqrt(ARRV w);
+ARRV set_arrv_sqrt(ARRV w);
 /*
     ARRAY OPERATIONS
 */
@@ -108,13 +209,66 @@ ARRP mul(ARRP v1, ARRP v2);
 ARRP set_mul(ARRP v1, ARRP v2);
 ARRP divide(ARRP v1, ARRP v2);
 ARRP set_divide(ARRP v1, ARRP v2);
+ARRP add_view(ARRV w1, ARRV w2);
+ARRV set_add_view(ARRV w1, ARRV w2);
+ARRP subtract_view(ARRV w1, ARRV w2);
+ARRV set_subtract_view(ARRV w1, ARRV w2);
+ARRP mul_view(ARRV w1, ARRV w2);
+ARRV set_mul_view(ARRV w1, ARRV w2);
+ARRP divide_view(ARRV w1, ARRV w2);
+ARRV set_divide_view(ARRV w1, ARRV w2);
+/*
+    REDUCTIONS
+    full reductions return a double; row/col reductions return a REALS_ARR
+    column (nrow x 1) or row (1 x ncol)
+*/
+typedef enum {
+    SUM_OP = 0,
+    MEAN_OP,
+    MIN_OP,
+    MAX_OP,
+    PROD_OP
+} reduce_op_t;
+
+double reduce_view(ARRV w, reduce_op_t op);
+double reduce_view_na_rm(ARRV w, reduce_op_t op);
+double sum_na_rm(ARRP v);
+double mean_na_rm(ARRP v);
+double sum(ARRP v);
+double mean(ARRP v);
+double min(ARRP v);
+double max(ARRP v);
+double prod(ARRP v);
+double sum_view(ARRV w);
+double mean_view(ARRV w);
+double min_view(ARRV w);
+double max_view(ARRV w);
+double prod_view(ARRV w);
+ARRP row_reduce(ARRP v, reduce_op_t op);
+ARRP col_reduce(ARRP v, reduce_op_t op);
+ARRP row_reduce_view(ARRV w, reduce_op_t op);
+ARRP col_reduce_view(ARRV w, reduce_op_t op);
+ARRP row_sums(ARRP v);
+ARRP col_sums(ARRP v);
+ARRP row_means(ARRP v);
+ARRP col_means(ARRP v);
 /*
     MATIRX OPERATIONS
 */
+ARRP row(const ARRP v, size_t dim0);
+double *real_row_ptr(const ARRP v, size_t dim0);
+double *real_col_ptr(const ARRP v, size_t dim1);
+void set_row(ARRP v, size_t dim0, ARRP vrow);
+ARRP col(ARRP v, size_t dim1);
+ARRP set_col(ARRP v, size_t dim1, ARRP vcol);
+void gemm_view(double alpha, ARRV a, ARRV b, double beta, ARRV c);
+void syrk_view(double alpha, ARRV a, double beta, ARRV c);
 ARRP matmul(const ARRP m1, const ARRP m2);
 ARRP set_matmul(ARRP m1, const ARRP m2);
 ARRP transpose(const ARRP v);
 ARRP set_transpose(ARRP v);
+ARRP as_layout(const ARRP v, layout_t layout);
+ARRP set_layout(ARRP v, layout_t layout);
 ARRP crossprod(ARRP x, ARRP y);
 ARRP tcrossprod(ARRP x, ARRP y);
 
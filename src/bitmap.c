@@ -0,0 +1,72 @@
+#include <string.h> // memset, memcpy
+
+#include "bitmap.h"
+#include "memory.h"
+
+
+/*n bits, all set to value (trailing bits of the last word included)*/
+uint64_t *bitmap_alloc(size_t n, int value) {
+    size_t nw = BITMAP_WORDS(n);
+    uint64_t *bits = chk_malloc((nw ? nw : 1) * sizeof(uint64_t));
+    memset(bits, value ? 0xff : 0, (nw ? nw : 1) * sizeof(uint64_t));
+    return bits;
+}
+
+/*grow or shrink to n_new bits; bits past n_old are set to value*/
+void bitmap_resize(uint64_t **bits, size_t n_old, size_t n_new, int value) {
+    size_t nw = BITMAP_WORDS(n_new);
+    chk_realloc((void**)bits, (nw ? nw : 1) * sizeof(uint64_t));
+    for (size_t i = n_old; i < n_new; ) {
+        if ((i & 63) == 0 && i + 64 <= n_new) {
+            (*bits)[i >> 6] = value ? ~(uint64_t)0 : 0;
+            i += 64;
+        } else {
+            if (value) bitmap_set(*bits, i); else bitmap_clear(*bits, i);
+            ++i;
+        }
+    }
+}
+
+uint64_t *bitmap_copy(const uint64_t *bits, size_t n) {
+    size_t nw = BITMAP_WORDS(n);
+    uint64_t *out = chk_malloc((nw ? nw : 1) * sizeof(uint64_t));
+    memcpy(out, bits, nw * sizeof(uint64_t));
+    return out;
+}
+
+/*bits [start, start + n) as the low n bits of a word (n <= 64)*/
+uint64_t bitmap_word(const uint64_t *bits, size_t start, size_t n) {
+    size_t w = start >> 6, s = start & 63;
+    uint64_t x = bits[w] >> s;
+    if (s && s + n > 64)
+        x |= bits[w + 1] << (64 - s);
+    return x & bitmap_mask(n);
+}
+
+/*write the low n bits of word to bits [start, start + n) (n <= 64)*/
+void bitmap_put(uint64_t *bits, size_t start, size_t n, uint64_t word) {
+    size_t w = start >> 6, s = start & 63;
+    uint64_t m = bitmap_mask(n);
+    word &= m;
+    bits[w] = (bits[w] & ~(m << s)) | (word << s);
+    if (s && s + n > 64)
+        bits[w + 1] = (bits[w + 1] & ~(m >> (64 - s))) | (word >> (64 - s));
+}
+
+/*number of set bits in [start, start + n)*/
+size_t bitmap_count(const uint64_t *bits, size_t start, size_t n) {
+    size_t c = 0;
+    // unaligned head, then whole words
+    if (start & 63) {
+        size_t h = 64 - (start & 63);
+        h = (h < n) ? h : n;
+        c += __builtin_popcountll(bitmap_word(bits, start, h));
+        start += h;
+        n -= h;
+    }
+    for (; n >= 64; start += 64, n -= 64)
+        c += __builtin_popcountll(bits[start >> 6]);
+    if (n)
+        c += __builtin_popcountll(bitmap_word(bits, start, n));
+    return c;
+}
@@ -0,0 +1,40 @@
+#ifndef __BITMAP_H
+#define __BITMAP_H
+
+#include <stdlib.h> // size_t
+#include <stdint.h> // uint64_t
+
+
+/*
+    BITMAPS
+    Bit i of a bitmap is bit (i % 64) of word i / 64. Ranges may start at
+    any bit; the range kernels work a 64-bit word at a time.
+*/
+#define BITMAP_WORDS(n) (((n) + 63) / 64)
+
+uint64_t *bitmap_alloc(size_t n, int value);
+void bitmap_resize(uint64_t **bits, size_t n_old, size_t n_new, int value);
+uint64_t *bitmap_copy(const uint64_t *bits, size_t n);
+uint64_t bitmap_word(const uint64_t *bits, size_t start, size_t n);
+void bitmap_put(uint64_t *bits, size_t start, size_t n, uint64_t word);
+size_t bitmap_count(const uint64_t *bits, size_t start, size_t n);
+
+/*the low n bits set (n <= 64)*/
+static inline uint64_t bitmap_mask(size_t n) {
+    return (n >= 64) ? ~(uint64_t)0 : (((uint64_t)1 << n) - 1);
+}
+
+static inline int bitmap_get(const uint64_t *bits, size_t i) {
+    return (bits[i >> 6] >> (i & 63)) & 1;
+}
+
+static inline void bitmap_set(uint64_t *bits, size_t i) {
+    bits[i >> 6] |= (uint64_t)1 << (i & 63);
+}
+
+static inline void bitmap_clear(uint64_t *bits, size_t i) {
+    bits[i >> 6] &= ~((uint64_t)1 << (i & 63));
+}
+
+
+#endif // __BITMAP_H
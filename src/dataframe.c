@@ -0,0 +1,78 @@
+#include "dataframe.h"
+#include "array.h"
+#include "memory.h"
+
+#include <stdio.h>
+#include <string.h> // strcmp
+
+
+
+data_frame df_init(size_t nrow) {
+    data_frame df;
+    df.nrow = nrow;
+    df.ncol = 0;
+    df.cap = 8;
+    df.names = chk_malloc(df.cap * sizeof(char*));
+    df.cols = chk_malloc(df.cap * sizeof(ARRP));
+    return df;
+}
+
+/*col may be nrow x 1 or 1 x nrow; names must be unique*/
+void df_add_col(data_frame *df, const char *name, ARRP col) {
+    arrtype_t t = arrtype(col);
+    if (!is_numeric_type(t) && t != STRINGS_ARR) {
+        fprintf(stderr, "df_add_col: column '%s' has unsupported type %s\n",
+                name, arrtype_str(t));
+        exit(1);
+    }
+    size_t *d = dims(col);
+    if (d[0] * d[1] != df->nrow || (d[0] != 1 && d[1] != 1)) {
+        fprintf(stderr, "df_add_col: column '%s' is not a vector of length %zu\n",
+                name, df->nrow);
+        exit(1);
+    }
+    if (df_col_ix(df, name) >= 0) {
+        fprintf(stderr, "df_add_col: duplicate column name '%s'\n", name);
+        exit(1);
+    }
+    if (df->ncol == df->cap) {
+        df->cap *= 2;
+        chk_realloc((void**)&df->names, df->cap * sizeof(char*));
+        chk_realloc((void**)&df->cols, df->cap * sizeof(ARRP));
+    }
+    // store as a column vector
+    dims(col)[0] = df->nrow;
+    dims(col)[1] = 1;
+    chk_strcpy(&df->names[df->ncol], name);
+    df->cols[df->ncol++] = col;
+}
+
+/*-1 if there is no such column*/
+int df_col_ix(const data_frame *df, const char *name) {
+    for (size_t j = 0; j < df->ncol; ++j) {
+        if (strcmp(df->names[j], name) == 0)
+            return (int)j;
+    }
+    return -1;
+}
+
+ARRP df_col(const data_frame *df, const char *name) {
+    int j = df_col_ix(df, name);
+    if (j < 0) {
+        fprintf(stderr, "df_col: no column named '%s'\n", name);
+        exit(1);
+    }
+    return df->cols[j];
+}
+
+void free_df(data_frame *df) {
+    for (size_t j = 0; j < df->ncol; ++j) {
+        chk_free(df->names[j]);
+        free_array(&df->cols[j]);
+    }
+    chk_free(df->names);
+    chk_free(df->cols);
+    df->names = NULL;
+    df->cols = NULL;
+    df->ncol = 0;
+}
@@ -0,0 +1,30 @@
+#ifndef __DATAFRAME_H
+#define __DATAFRAME_H
+
+#include <stdlib.h> // size_t
+#include "array.h"
+
+
+/*
+    DATA FRAMES
+    Named columns of a common length, each an nrow x 1 dense numeric array
+    (INTS_ARR, LONGS_ARR, REALS_ARR, FLOATS_ARR or BOOLS_ARR) or STRINGS_ARR;
+    sparse arrays are rejected. The data frame owns its columns: df_add_col
+    takes the array, and free_df frees it.
+*/
+typedef struct data_frame {
+    size_t nrow;
+    size_t ncol;
+    char **names;
+    ARRP *cols;
+    size_t cap;     // room in names / cols
+} data_frame;
+
+data_frame df_init(size_t nrow);
+void df_add_col(data_frame *df, const char *name, ARRP col);
+int df_col_ix(const data_frame *df, const char *name);
+ARRP df_col(const data_frame *df, const char *name);
+void free_df(data_frame *df);
+
+
+#endif // __DATAFRAME_H
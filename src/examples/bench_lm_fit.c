@@ -0,0 +1,52 @@
+#include <stdio.h>
+#include <math.h> // fabs
+#include <time.h> // clock_gettime
+
+#include "global.h"
+#include "array.h"
+#include "models.h"
+
+#include "examples/bench_lm_fit.h"
+
+
+
+static double elapsed(struct timespec t0, struct timespec t1) {
+    return (double)(t1.tv_sec - t0.tv_sec) + 1e-9 * (double)(t1.tv_nsec - t0.tv_nsec);
+}
+
+
+/*
+    time lm_fit on a random n x p design, e.g. n = 1000000, p = 200
+    (the design alone is n * p * 8 bytes, 1.6GB at that size)
+*/
+int example__bench_lm_fit(size_t n, size_t p) {
+    init_memstack();
+    struct timespec t0, t1;
+
+    ARRP x = alloc_array_layout(REALS_ARR, n, p, COL_MAJOR);
+    set_rand_unif(x, global_seed);
+    ARRP beta = alloc_array(REALS_ARR, p, 1);
+    set_fill_num(beta, 1, 1);
+    ARRP y = matmul(x, beta);
+    ARRP noise = alloc_array(REALS_ARR, n, 1);
+    set_rand_unif(noise, global_seed + 1);
+    set_add(y, noise);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    lm_t fit = lm_fit(x, y);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    double maxerr = 0.;
+    for (size_t j = 1; j < p; ++j) {
+        double e = fabs(real(fit.coef)[j] - real(beta)[j]);
+        maxerr = (e > maxerr) ? e : maxerr;
+    }
+    printf("lm_fit: n = %zu, p = %zu, threads = %d\n", n, p, get_num_threads());
+    printf("  time: %.3fs\n", elapsed(t0, t1));
+    printf("  sigma: %f, max |b - beta| (slopes): %g\n", fit.sigma, maxerr);
+
+    free_lm(&fit);
+    free_array(&x); free_array(&beta); free_array(&y); free_array(&noise);
+    free_memstack();
+    return 0;
+}
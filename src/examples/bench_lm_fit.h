@@ -0,0 +1,11 @@
+#ifndef __BENCH_LM_FIT_H
+#define __BENCH_LM_FIT_H
+
+#include <stddef.h>
+
+
+int example__bench_lm_fit(size_t n, size_t p);
+
+
+
+#endif // __BENCH_LM_FIT_H
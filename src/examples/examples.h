@@ -2,5 +2,10 @@
 #define __EXAMPLES_H
 
 #include "examples/read_sqlite_table.h"
+#include "examples/bench_lm_fit.h"
+#include "examples/lm_sqlite.h"
+#include "examples/glm_sqlite.h"
+#include "examples/model_matrix_sqlite.h"
+#include "examples/reservoir_sqlite.h"
 
-#endif // __EXAMPLES_H
\ No newline at end of file
+#endif // __EXAMPLES_H
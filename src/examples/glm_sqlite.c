@@ -0,0 +1,69 @@
+#include <stdio.h>
+
+#include "global.h"
+#include "array.h"
+#include "models.h"
+#include "sqlite/sqlite3.h"
+
+#include "examples/glm_sqlite.h"
+
+
+
+/*
+    logistic regression of baby_low_weight ~ 1 + mom_age + mom_weight +
+    mom_smoke on the birthwt table, then a poisson regression of the
+    number of physician visits (mom_ftv) on the same predictors
+*/
+int example__glm_sqlite(const char *dbpath) {
+    init_memstack();
+    const char *names[] = {"(Intercept)", "mom_age", "mom_weight", "mom_smoke"};
+    const size_t p = 4;
+
+    sqlite3 *db;
+    if (sqlite3_open(dbpath, &db) != SQLITE_OK) {
+        fprintf(stderr, "Can't open database: %s\n", sqlite3_errmsg(db));
+        exit(1);
+    }
+    sqlite3_stmt *stmt;
+    const char *query =
+        "SELECT baby_low_weight, mom_ftv, mom_age, mom_weight, mom_smoke FROM birthwt";
+    if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "sqlite3 error: %s\n", sqlite3_errmsg(db));
+        exit(1);
+    }
+    size_t n = 0;
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+        ++n;
+    sqlite3_reset(stmt);
+
+    ARRP X = alloc_array(REALS_ARR, n, p);
+    ARRP low = alloc_array(REALS_ARR, n, 1), ftv = alloc_array(REALS_ARR, n, 1);
+    for (size_t i = 0; i < n && sqlite3_step(stmt) == SQLITE_ROW; ++i) {
+        real(low)[i] = sqlite3_column_double(stmt, 0);
+        real(ftv)[i] = sqlite3_column_double(stmt, 1);
+        set_reals_elt(X, i, 0, 1.);
+        for (size_t j = 1; j < p; ++j)
+            set_reals_elt(X, i, j, sqlite3_column_double(stmt, (int)j + 1));
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+
+    // both fits share one workspace
+    glm_work_t work = glm_work_alloc(n, p);
+    const char *titles[] = {"binomial: baby_low_weight", "poisson: mom_ftv"};
+    glm_family_t families[] = {BINOMIAL_FAMILY, POISSON_FAMILY};
+    ARRP ys[] = {low, ftv};
+    for (int f = 0; f < 2; ++f) {
+        glm_t fit = glm_fit_work(X, ys[f], families[f], &work);
+        printf("%s (n = %zu, %d iterations)\n", titles[f], n, fit.iter);
+        for (size_t j = 0; j < p; ++j)
+            printf("  %-12s %10.5f  (se %.5f)\n", names[j],
+                   real(fit.coef)[j], real(fit.se)[j]);
+        printf("  residual deviance: %.3f on %zu df\n", fit.deviance, fit.df);
+        free_glm(&fit);
+    }
+
+    free_glm_work(&work);
+    free_array(&X); free_array(&low); free_array(&ftv);
+    return 0;
+}
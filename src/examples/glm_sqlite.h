@@ -0,0 +1,9 @@
+#ifndef __GLM_SQLITE_H
+#define __GLM_SQLITE_H
+
+
+int example__glm_sqlite(const char *dbpath);
+
+
+
+#endif // __GLM_SQLITE_H
@@ -0,0 +1,71 @@
+#include <stdio.h>
+
+#include "global.h"
+#include "array.h"
+#include "models.h"
+#include "sqlite/sqlite3.h"
+
+#include "examples/lm_sqlite.h"
+
+
+
+/*
+    baby_weight ~ 1 + mom_age + mom_weight + mom_smoke over the birthwt
+    table, in one scan of `batch` rows at a time: memory use depends on the
+    number of columns, not the number of rows.
+*/
+int example__lm_sqlite(const char *dbpath, size_t batch) {
+    init_memstack();
+    const char *names[] = {"(Intercept)", "mom_age", "mom_weight", "mom_smoke"};
+    const size_t p = 4;
+
+    sqlite3 *db;
+    if (sqlite3_open(dbpath, &db) != SQLITE_OK) {
+        fprintf(stderr, "Can't open database: %s\n", sqlite3_errmsg(db));
+        exit(1);
+    }
+    sqlite3_stmt *stmt;
+    const char *query =
+        "SELECT baby_weight, mom_age, mom_weight, mom_smoke FROM birthwt";
+    if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "sqlite3 error: %s\n", sqlite3_errmsg(db));
+        exit(1);
+    }
+
+    ARRP X = alloc_array(REALS_ARR, batch, p);
+    ARRP y = alloc_array(REALS_ARR, batch, 1);
+    lm_accum_t acc = lm_accum_init(p);
+    size_t nfill = 0;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        real(y)[nfill] = sqlite3_column_double(stmt, 0);
+        set_reals_elt(X, nfill, 0, 1.);
+        for (size_t j = 1; j < p; ++j)
+            set_reals_elt(X, nfill, j, sqlite3_column_double(stmt, (int)j));
+        if (++nfill == batch) {
+            lm_accum_update(&acc, X, y);
+            nfill = 0;
+        }
+    }
+    if (rc != SQLITE_DONE) {
+        fprintf(stderr, "sqlite3 error: %s\n", sqlite3_errmsg(db));
+        exit(1);
+    }
+    if (nfill > 0)
+        lm_accum_update_view(&acc, subview(view(X), 0, 0, nfill, p),
+                             subview(view(y), 0, 0, nfill, 1));
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+
+    lm_t fit = lm_accum_fit(&acc);
+    printf("baby_weight ~ mom_age + mom_weight + mom_smoke (n = %zu)\n", acc.n);
+    for (size_t j = 0; j < p; ++j)
+        printf("  %-12s %10.4f  (se %.4f)\n", names[j],
+               real(fit.coef)[j], real(fit.se)[j]);
+    printf("  sigma: %.4f on %zu df\n", fit.sigma, fit.df);
+
+    free_lm(&fit);
+    free_lm_accum(&acc);
+    free_array(&X); free_array(&y);
+    return 0;
+}
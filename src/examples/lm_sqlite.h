@@ -0,0 +1,11 @@
+#ifndef __LM_SQLITE_H
+#define __LM_SQLITE_H
+
+#include <stddef.h>
+
+
+int example__lm_sqlite(const char *dbpath, size_t batch);
+
+
+
+#endif // __LM_SQLITE_H
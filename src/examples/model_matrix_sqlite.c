@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include <string.h> // strcmp
+
+#include "global.h"
+#include "array.h"
+#include "dataframe.h"
+#include "models.h"
+#include "sqlite/sqlite3.h"
+
+#include "examples/model_matrix_sqlite.h"
+
+
+
+static arrtype_t _decltype_arrtype(const char *decl) {
+    if (decl && strcmp(decl, "INTEGER") == 0)
+        return LONGS_ARR;  // sqlite integers are 64-bit
+    if (decl && strcmp(decl, "REAL") == 0)
+        return REALS_ARR;
+    return STRINGS_ARR;
+}
+
+/*
+    the result of a query as a data frame, one column per result column,
+    typed by the declared sqlite column type (as in db_coltypes)
+*/
+data_frame read_sqlite_df(sqlite3 *db, const char *query) {
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "sqlite3 error: %s\n", sqlite3_errmsg(db));
+        exit(1);
+    }
+    size_t n = 0;
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+        ++n;
+    sqlite3_reset(stmt);
+
+    int ncol = sqlite3_column_count(stmt);
+    data_frame df = df_init(n);
+    for (int j = 0; j < ncol; ++j) {
+        arrtype_t t = _decltype_arrtype(sqlite3_column_decltype(stmt, j));
+        df_add_col(&df, sqlite3_column_name(stmt, j), alloc_array(t, n, 1));
+    }
+    for (size_t i = 0; i < n && sqlite3_step(stmt) == SQLITE_ROW; ++i) {
+        for (int j = 0; j < ncol; ++j) {
+            ARRP col = df.cols[j];
+            if (sqlite3_column_type(stmt, j) == SQLITE_NULL) {
+                set_na(col, i, 0);
+                continue;
+            }
+            switch (arrtype(col)) {
+            case LONGS_ARR:
+                int64(col)[i] = sqlite3_column_int64(stmt, j);
+                break;
+            case REALS_ARR:
+                real(col)[i] = sqlite3_column_double(stmt, j);
+                break;
+            default: ;
+                const unsigned char *txt = sqlite3_column_text(stmt, j);
+                set_strings_elt(col, i, 0, (const char*)txt);
+                break;
+            }
+        }
+    }
+    sqlite3_finalize(stmt);
+    return df;
+}
+
+
+/*
+    baby_low_weight ~ mom_age + mom_weight + factor(mom_race) + mom_smoke,
+    the design built by model_matrix straight from the loaded table
+*/
+int example__model_matrix_sqlite(const char *dbpath) {
+    init_memstack();
+    sqlite3 *db;
+    if (sqlite3_open(dbpath, &db) != SQLITE_OK) {
+        fprintf(stderr, "Can't open database: %s\n", sqlite3_errmsg(db));
+        exit(1);
+    }
+    data_frame df = read_sqlite_df(db, "SELECT * FROM birthwt");
+    sqlite3_close(db);
+
+    const char *formula = "baby_low_weight ~ mom_age + mom_weight + factor(mom_race) + mom_smoke";
+    // glm_fit takes a dense design, so don't let MM_AUTO pick CSR
+    model_matrix_t mm = model_matrix(&df, formula, MM_DENSE);
+    glm_t fit = glm_fit(mm.x, mm.y, BINOMIAL_FAMILY); // rows with NULLs dropped
+
+    printf("%s\n  (n = %zu)\n", formula, dims(mm.x)[0]);
+    for (size_t j = 0; j < dims(mm.x)[1]; ++j)
+        printf("  %-20s %10.5f  (se %.5f)\n", strings_elt(mm.colnames, 0, j),
+               real(fit.coef)[j], real(fit.se)[j]);
+    printf("  residual deviance: %.3f on %zu df\n", fit.deviance, fit.df);
+
+    free_glm(&fit);
+    free_model_matrix(&mm);
+    free_df(&df);
+    return 0;
+}
@@ -0,0 +1,13 @@
+#ifndef __MODEL_MATRIX_SQLITE_H
+#define __MODEL_MATRIX_SQLITE_H
+
+#include "dataframe.h"
+#include "sqlite/sqlite3.h"
+
+
+data_frame read_sqlite_df(sqlite3 *db, const char *query);
+int example__model_matrix_sqlite(const char *dbpath);
+
+
+
+#endif // __MODEL_MATRIX_SQLITE_H
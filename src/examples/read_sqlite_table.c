@@ -48,7 +48,7 @@ int print_callback(void *print_header, int argc, char **data, char **columns) {
         (*ph) = 0;
     }
     for (int i = 0; i < argc; i++) {
-        printf("%s\t", data[i] ? data[i] : "NULL");
+        printf("%s\t", data[i] ? data[i] : "NA");
     }
     putchar('\n');
     return 0;
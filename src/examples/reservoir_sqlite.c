@@ -0,0 +1,79 @@
+#include <stdio.h>
+
+#include "global.h"
+#include "array.h"
+#include "models.h"
+#include "stats.h"
+#include "sqlite/sqlite3.h"
+
+#include "examples/reservoir_sqlite.h"
+
+
+
+/*
+    A uniform subsample of k rows of the birthwt table, taken in one scan
+    of `batch` rows at a time, then baby_weight ~ 1 + mom_age + mom_weight
+    + mom_smoke fit on the subsample alone.
+*/
+int example__reservoir_sqlite(const char *dbpath, size_t k, size_t batch) {
+    init_memstack();
+    const char *names[] = {"(Intercept)", "mom_age", "mom_weight", "mom_smoke"};
+    const size_t p = 4;
+
+    sqlite3 *db;
+    if (sqlite3_open(dbpath, &db) != SQLITE_OK) {
+        fprintf(stderr, "Can't open database: %s\n", sqlite3_errmsg(db));
+        exit(1);
+    }
+    sqlite3_stmt *stmt;
+    const char *query =
+        "SELECT baby_weight, mom_age, mom_weight, mom_smoke FROM birthwt";
+    if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "sqlite3 error: %s\n", sqlite3_errmsg(db));
+        exit(1);
+    }
+
+    // chunk rows are (y, x1, x2, x3)
+    ARRP chunk = alloc_array(REALS_ARR, batch, p);
+    reservoir_t res = reservoir_init(k, p, global_seed);
+    size_t nfill = 0;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        for (size_t j = 0; j < p; ++j) {
+            if (sqlite3_column_type(stmt, (int)j) == SQLITE_NULL)
+                set_na(chunk, nfill, j);
+            else
+                set_reals_elt(chunk, nfill, j, sqlite3_column_double(stmt, (int)j));
+        }
+        if (++nfill == batch) {
+            reservoir_update(&res, chunk);
+            nfill = 0;
+        }
+    }
+    if (rc != SQLITE_DONE) {
+        fprintf(stderr, "sqlite3 error: %s\n", sqlite3_errmsg(db));
+        exit(1);
+    }
+    if (nfill > 0)
+        reservoir_update_view(&res, subview(view(chunk), 0, 0, nfill, p));
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+
+    ARRV s = reservoir_view(&res);
+    size_t n = s.dims[0];
+    ARRP y = copy_view(subview(s, 0, 0, n, 1));
+    ARRP X = copy_view(s);
+    set_fill_num_view(col_view(X, 0), 1., 0.); // y column -> intercept
+
+    lm_t fit = lm_fit(X, y);
+    printf("baby_weight ~ mom_age + mom_weight + mom_smoke "
+           "(subsample of %zu from %zu rows)\n", n, res.seen);
+    for (size_t j = 0; j < p; ++j)
+        printf("  %-12s %10.4f  (se %.4f)\n", names[j],
+               real(fit.coef)[j], real(fit.se)[j]);
+
+    free_lm(&fit);
+    free_reservoir(&res);
+    free_array(&chunk); free_array(&y); free_array(&X);
+    return 0;
+}
@@ -0,0 +1,11 @@
+#ifndef __RESERVOIR_SQLITE_H
+#define __RESERVOIR_SQLITE_H
+
+#include <stddef.h>
+
+
+int example__reservoir_sqlite(const char *dbpath, size_t k, size_t batch);
+
+
+
+#endif // __RESERVOIR_SQLITE_H
@@ -1,10 +1,14 @@
 #include "global.h"
 #include "list.h"
+#include "parallel.h" // MAX_THREADS
 #include <stdio.h>
+#include <unistd.h> // sysconf
 
 struct DLList memstack = {/*head=*/NULL, /*tail=*/NULL, /*len=*/0};
 int mem = 0;
-uint32_t global_seed = 123; //TODO: implement usage in r.v. functions
+uint32_t global_seed = 123;   // seed of the unseeded random fills (rand_unif)
+uint32_t global_stream = 0;   // next Philox stream drawn from global_seed
+int num_threads = 0; // 0: one per online core
 
 
 void init_memstack(void) {
@@ -18,10 +22,28 @@ void init_memstack(void) {
 // atexit free all consumed memory
 void free_memstack(void) {
     if (memstack.len > 0) {
-        for (struct DLNode *n = memstack.tail; n != NULL; n = n->prev) {
+        struct DLNode *prev;
+        for (struct DLNode *n = memstack.tail; n != NULL; n = prev) {
+            prev = n->prev; // n is freed by dllist_remove
             dllist_remove(&memstack, n);
         }
     }
     printf("\n  ~Final memstack len: %zu\n", memstack.len);
     printf("  ~Memory leaks: %d\n", mem);
-}
\ No newline at end of file
+}
+
+
+/*number of threads used by parallel kernels, at most MAX_THREADS*/
+int get_num_threads(void) {
+    if (num_threads > 0)
+        return num_threads;
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    if (ncpu > MAX_THREADS)
+        ncpu = MAX_THREADS;
+    return (ncpu > 0) ? (int)ncpu : 1;
+}
+
+/*n <= 0 resets to one thread per online core; n is capped at MAX_THREADS*/
+void set_num_threads(int n) {
+    num_threads = (n > MAX_THREADS) ? MAX_THREADS : (n > 0) ? n : 0;
+}
@@ -6,9 +6,13 @@
 
 extern int mem;
 extern uint32_t global_seed;
+extern uint32_t global_stream;
 
 extern struct DLList memstack;
 void init_memstack(void);
 void free_memstack(void);
 
+int get_num_threads(void);
+void set_num_threads(int n);
+
 #endif // _GLOBAL_H_
\ No newline at end of file
@@ -0,0 +1,817 @@
+#include "linalg.h"
+#include "array.h"
+#include "memory.h"
+#include "rand/rng.h"
+
+#include <stdio.h>
+#include <math.h> // sqrt, hypot, copysign
+
+
+
+/*
+    Strided element access for views, used by all kernels below: column
+    major views make the column walks contiguous.
+*/
+#define VX(w) ((w).arr->reals + (w).offset)
+#define AT(p, w, i, j) ((p)[(i) * (w).strides[0] + (j) * (w).strides[1]])
+
+static void _check_square_reals(ARRV a, const char *caller) {
+    if (a.arr->type != REALS_ARR) {
+        fprintf(stderr, "%s: only REALS_ARR supported\n", caller);
+        exit(1);
+    }
+    if (a.dims[0] != a.dims[1]) {
+        fprintf(stderr, "%s: matrix is not square\n", caller);
+        exit(1);
+    }
+}
+
+
+
+/*
+    TRIANGULAR SOLVES
+*/
+
+/*
+    Both directions walk columns of R, so a column-major R is read
+    contiguously: R'X = B by dot products with columns of R, RX = B by
+    subtracting multiples of columns of R (axpy form).
+*/
+void backsolve_view(ARRV r, ARRV b, int trans) {
+    _check_square_reals(r, "backsolve");
+    if (b.arr->type != REALS_ARR || b.dims[0] != r.dims[0]) {
+        fprintf(stderr, "backsolve: dimensions are not compatible\n");
+        exit(1);
+    }
+    size_t n = r.dims[0];
+    const double *R = VX(r);
+    double *B = VX(b);
+    for (size_t c = 0; c < b.dims[1]; ++c) {
+        if (trans) {
+            for (size_t i = 0; i < n; ++i) {
+                double s = AT(B, b, i, c);
+                for (size_t l = 0; l < i; ++l)
+                    s -= AT(R, r, l, i) * AT(B, b, l, c);
+                AT(B, b, i, c) = s / AT(R, r, i, i);
+            }
+        } else {
+            for (size_t i = n; i-- > 0; ) {
+                double xi = AT(B, b, i, c) / AT(R, r, i, i);
+                AT(B, b, i, c) = xi;
+                for (size_t l = 0; l < i; ++l)
+                    AT(B, b, l, c) -= AT(R, r, l, i) * xi;
+            }
+        }
+    }
+}
+
+ARRP backsolve(ARRP r, ARRP b) {
+    ARRP x = copyarr(b);
+    backsolve_view(view(r), view(x), 0);
+    return x;
+}
+
+/*solve R'X = B, i.e. a forward solve with the lower-triangular R'*/
+ARRP forwardsolve_t(ARRP r, ARRP b) {
+    ARRP x = copyarr(b);
+    backsolve_view(view(r), view(x), 1);
+    return x;
+}
+
+
+
+/*
+    CHOLESKY
+*/
+
+/*unblocked upper Cholesky (column by column), for the diagonal blocks*/
+static int _chol_unblocked(ARRV a) {
+    size_t n = a.dims[0];
+    double *A = VX(a);
+    for (size_t j = 0; j < n; ++j) {
+        double s = AT(A, a, j, j);
+        for (size_t l = 0; l < j; ++l)
+            s -= AT(A, a, l, j) * AT(A, a, l, j);
+        if (!(s > 0))
+            return (int)j + 1;
+        double rjj = sqrt(s);
+        AT(A, a, j, j) = rjj;
+        for (size_t k = j + 1; k < n; ++k) {
+            double t = AT(A, a, j, k);
+            for (size_t l = 0; l < j; ++l)
+                t -= AT(A, a, l, j) * AT(A, a, l, k);
+            AT(A, a, j, k) = t / rjj;
+        }
+    }
+    return 0;
+}
+
+/*
+    Right-looking blocked Cholesky: factor a CHOL_BLOCK diagonal block,
+    solve for the panel to its right, then downdate the trailing matrix with
+    a symmetric rank-CHOL_BLOCK update (syrk_view). Nearly all the work is
+    in that update, which is matmul-shaped and cache blocked. Reads and
+    writes the upper triangle; the strict lower triangle is zeroed.
+*/
+#define CHOL_BLOCK 64
+int chol_view(ARRV a) {
+    _check_square_reals(a, "chol");
+    size_t n = a.dims[0];
+    for (size_t k0 = 0; k0 < n; k0 += CHOL_BLOCK) {
+        size_t nb = (n - k0 < CHOL_BLOCK) ? n - k0 : CHOL_BLOCK;
+        size_t k1 = k0 + nb;
+        ARRV a11 = subview(a, k0, k0, nb, nb);
+        int info = _chol_unblocked(a11);
+        if (info)
+            return (int)k0 + info;
+        if (k1 < n) {
+            ARRV a12 = subview(a, k0, k1, nb, n - k1);
+            backsolve_view(a11, a12, 1);   // R11' R12 = A12
+            syrk_view(-1.0, a12, 1.0, subview(a, k1, k1, n - k1, n - k1));
+        }
+    }
+    double *A = VX(a);
+    for (size_t j = 0; j < n; ++j) {
+        for (size_t i = j + 1; i < n; ++i)
+            AT(A, a, i, j) = 0.;
+    }
+    return 0;
+}
+
+ARRP chol(ARRP a) {
+    ARRP r = as_layout(a, COL_MAJOR);
+    int info = chol_view(view(r));
+    if (info) {
+        fprintf(stderr, "chol: leading minor of order %d is not positive definite\n", info);
+        exit(1);
+    }
+    return r;
+}
+
+/*(R'R)^-1 from the Cholesky factor R*/
+ARRP chol2inv(ARRP r) {
+    size_t n = dims(r)[0];
+    ARRP rinv = alloc_array_layout(REALS_ARR, n, n, COL_MAJOR);
+    for (size_t i = 0; i < n; ++i)
+        set_reals_elt(rinv, i, i, 1.);
+    backsolve_view(view(r), view(rinv), 0);
+    ARRP out = tcrossprod(rinv, rinv);
+    free_array(&rinv);
+    return out;
+}
+
+
+
+/*
+    QR
+*/
+
+/*
+    Unblocked Householder QR of a panel (LAPACK dgeqr2). Each reflector
+    H = I - tau v v' maps column j onto beta e_j; v is stored below the
+    diagonal with v_j = 1 implied.
+*/
+static void _qr_unblocked(ARRV a, double *tau) {
+    size_t m = a.dims[0], n = a.dims[1];
+    size_t k = (m < n) ? m : n;
+    double *A = VX(a);
+    for (size_t j = 0; j < k; ++j) {
+        double alpha = AT(A, a, j, j), xnorm = 0.;
+        for (size_t i = j + 1; i < m; ++i)
+            xnorm += AT(A, a, i, j) * AT(A, a, i, j);
+        if (xnorm == 0.) {
+            tau[j] = 0.;
+            continue;
+        }
+        double beta = -copysign(sqrt(alpha * alpha + xnorm), alpha);
+        tau[j] = (beta - alpha) / beta;
+        double scale = 1. / (alpha - beta);
+        for (size_t i = j + 1; i < m; ++i)
+            AT(A, a, i, j) *= scale;
+        AT(A, a, j, j) = beta;
+        // apply H to the rest of the panel
+        for (size_t c = j + 1; c < n; ++c) {
+            double w = AT(A, a, j, c);
+            for (size_t i = j + 1; i < m; ++i)
+                w += AT(A, a, i, j) * AT(A, a, i, c);
+            w *= tau[j];
+            AT(A, a, j, c) -= w;
+            for (size_t i = j + 1; i < m; ++i)
+                AT(A, a, i, c) -= w * AT(A, a, i, j);
+        }
+    }
+}
+
+/*copy the reflectors of a factored panel into V, with the implied unit
+  diagonal and zeros above it, so V can go straight to gemm_view*/
+static void _qr_reflectors(ARRV panel, ARRV v) {
+    const double *P = VX(panel);
+    double *V = VX(v);
+    for (size_t j = 0; j < v.dims[1]; ++j) {
+        for (size_t i = 0; i < v.dims[0]; ++i)
+            AT(V, v, i, j) = (i < j) ? 0. : (i == j) ? 1. : AT(P, panel, i, j);
+    }
+}
+
+/*
+    Triangular factor T of the compact WY form H_1 ... H_nb = I - V T V'
+    (LAPACK dlarft, forward / columnwise). T is nb x nb, column-major.
+*/
+static void _qr_T(ARRV v, const double *tau, double *T, size_t ldt) {
+    size_t m = v.dims[0], nb = v.dims[1];
+    const double *V = VX(v);
+    for (size_t i = 0; i < nb; ++i) {
+        // t = -tau_i V(:, 0:i)' v_i, then T(0:i, i) = T(0:i, 0:i) t
+        for (size_t l = 0; l < i; ++l) {
+            double s = 0.;
+            for (size_t r = i; r < m; ++r)
+                s += AT(V, v, r, l) * AT(V, v, r, i);
+            T[l + i*ldt] = -tau[i] * s;
+        }
+        for (size_t r = 0; r < i; ++r) {
+            double s = 0.;
+            for (size_t l = r; l < i; ++l)
+                s += T[r + l*ldt] * T[l + i*ldt];
+            T[r + i*ldt] = s;
+        }
+        T[i + i*ldt] = tau[i];
+    }
+}
+
+/*
+    C = (I - V op(T) V') C, with op(T) = T' if trans: two gemms through the
+    nb x ncol(C) workspace W and a small triangular multiply in between.
+*/
+static void _qr_apply_block(ARRV v, const double *T, size_t ldt, ARRV c,
+                            ARRP work, int trans) {
+    size_t nb = v.dims[1], nc = c.dims[1];
+    ARRV w = subview(view(work), 0, 0, nb, nc);
+    double *W = VX(w);
+    gemm_view(1.0, transpose_view(v), c, 0.0, w);
+    for (size_t j = 0; j < nc; ++j) {
+        if (trans) {
+            for (size_t i = nb; i-- > 0; ) {
+                double s = 0.;
+                for (size_t l = 0; l <= i; ++l)
+                    s += T[l + i*ldt] * AT(W, w, l, j);
+                AT(W, w, i, j) = s;
+            }
+        } else {
+            for (size_t i = 0; i < nb; ++i) {
+                double s = 0.;
+                for (size_t l = i; l < nb; ++l)
+                    s += T[i + l*ldt] * AT(W, w, l, j);
+                AT(W, w, i, j) = s;
+            }
+        }
+    }
+    gemm_view(-1.0, v, w, 1.0, c);
+}
+
+/*
+    Blocked QR (LAPACK dgeqrf): factor a QR_BLOCK column panel unblocked,
+    then apply its reflectors to the trailing columns at once in compact WY
+    form, so nearly all the flops go through gemm_view. tau must hold
+    min(m, n) doubles.
+*/
+#define QR_BLOCK 32
+void qr_view(ARRV a, double *tau) {
+    if (a.arr->type != REALS_ARR) {
+        fprintf(stderr, "qr: only REALS_ARR supported\n");
+        exit(1);
+    }
+    size_t m = a.dims[0], n = a.dims[1];
+    size_t k = (m < n) ? m : n;
+    ARRP vbuf = alloc_array_layout(REALS_ARR, m, QR_BLOCK, COL_MAJOR);
+    ARRP work = alloc_array_layout(REALS_ARR, QR_BLOCK, (n > 0) ? n : 1, COL_MAJOR);
+    double T[QR_BLOCK * QR_BLOCK];
+    for (size_t j0 = 0; j0 < k; j0 += QR_BLOCK) {
+        size_t nb = (k - j0 < QR_BLOCK) ? k - j0 : QR_BLOCK;
+        ARRV panel = subview(a, j0, j0, m - j0, nb);
+        _qr_unblocked(panel, tau + j0);
+        if (j0 + nb < n) {
+            ARRV v = subview(view(vbuf), 0, 0, m - j0, nb);
+            _qr_reflectors(panel, v);
+            _qr_T(v, tau + j0, T, QR_BLOCK);
+            _qr_apply_block(v, T, QR_BLOCK,
+                            subview(a, j0, j0 + nb, m - j0, n - j0 - nb), work, 1);
+        }
+    }
+    free_array(&vbuf);
+    free_array(&work);
+}
+
+qr_t qr(ARRP x) {
+    qr_t q;
+    q.qr = as_layout(x, COL_MAJOR);
+    size_t k = (dims(x)[0] < dims(x)[1]) ? dims(x)[0] : dims(x)[1];
+    q.tau = alloc_array(REALS_ARR, (k > 0) ? k : 1, 1);
+    qr_view(view(q.qr), real(q.tau));
+    return q;
+}
+
+void free_qr(qr_t *q) {
+    free_array(&q->qr);
+    free_array(&q->tau);
+}
+
+/*Q'b = H_k ... H_1 b (blocks in forward order), or Qb (reverse order)*/
+static void _qr_apply_q(const qr_t *q, ARRV b, int trans) {
+    size_t m = dims(q->qr)[0], n = dims(q->qr)[1];
+    size_t k = (m < n) ? m : n;
+    if (b.arr->type != REALS_ARR || b.dims[0] != m) {
+        fprintf(stderr, "qr: b must be REALS_ARR with nrow(x) rows\n");
+        exit(1);
+    }
+    if (k == 0)
+        return;
+    ARRP vbuf = alloc_array_layout(REALS_ARR, m, QR_BLOCK, COL_MAJOR);
+    ARRP work = alloc_array_layout(REALS_ARR, QR_BLOCK, (b.dims[1] > 0) ? b.dims[1] : 1,
+                                   COL_MAJOR);
+    double T[QR_BLOCK * QR_BLOCK];
+    size_t nblock = (k + QR_BLOCK - 1) / QR_BLOCK;
+    for (size_t t = 0; t < nblock; ++t) {
+        size_t j0 = (trans ? t : nblock - 1 - t) * QR_BLOCK;
+        size_t nb = (k - j0 < QR_BLOCK) ? k - j0 : QR_BLOCK;
+        ARRV v = subview(view(vbuf), 0, 0, m - j0, nb);
+        _qr_reflectors(subview(view(q->qr), j0, j0, m - j0, nb), v);
+        _qr_T(v, real(q->tau) + j0, T, QR_BLOCK);
+        _qr_apply_block(v, T, QR_BLOCK, subview(b, j0, 0, m - j0, b.dims[1]),
+                        work, trans);
+    }
+    free_array(&vbuf);
+    free_array(&work);
+}
+
+void qr_qty_view(const qr_t *q, ARRV b) {
+    _qr_apply_q(q, b, 1);
+}
+
+void qr_qy_view(const qr_t *q, ARRV b) {
+    _qr_apply_q(q, b, 0);
+}
+
+/*min(m, n) x n upper-triangular R*/
+ARRP qr_R(const qr_t *q) {
+    size_t m = dims(q->qr)[0], n = dims(q->qr)[1];
+    size_t k = (m < n) ? m : n;
+    ARRP r = alloc_array_layout(REALS_ARR, k, n, COL_MAJOR);
+    for (size_t j = 0; j < n; ++j) {
+        for (size_t i = 0; i <= j && i < k; ++i)
+            set_reals_elt(r, i, j, reals_elt(q->qr, i, j));
+    }
+    return r;
+}
+
+/*m x min(m, n) Q with orthonormal columns (the "thin" Q)*/
+ARRP qr_Q(const qr_t *q) {
+    size_t m = dims(q->qr)[0], n = dims(q->qr)[1];
+    size_t k = (m < n) ? m : n;
+    ARRP Q = alloc_array_layout(REALS_ARR, m, k, COL_MAJOR);
+    for (size_t i = 0; i < k; ++i)
+        set_reals_elt(Q, i, i, 1.);
+    qr_qy_view(q, view(Q));
+    return Q;
+}
+
+/*
+    Least squares solution of x b = y for full-rank x with nrow >= ncol:
+    R b = (Q'y)[1:n]. Returns n x ncol(y) (y may also be a length-m vector).
+*/
+ARRP qr_solve(const qr_t *q, ARRP y) {
+    size_t m = dims(q->qr)[0], n = dims(q->qr)[1];
+    if (m < n) {
+        fprintf(stderr, "qr_solve: need nrow(x) >= ncol(x)\n");
+        exit(1);
+    }
+    ARRV yv = (dims(y)[0] == 1 && length(y) == m && m > 1)
+        ? transpose_view(view(y)) : view(y);
+    ARRP qty = alloc_array_layout(REALS_ARR, m, yv.dims[1], COL_MAJOR);
+    set_view(view(qty), yv);
+    qr_qty_view(q, view(qty));
+    ARRV r = subview(view(q->qr), 0, 0, n, n);
+    double rmax = 0.;
+    for (size_t j = 0; j < n; ++j)
+        rmax = fmax(rmax, fabs(reals_elt(q->qr, j, j)));
+    for (size_t j = 0; j < n; ++j) {
+        if (fabs(reals_elt(q->qr, j, j)) <= rmax * 1e-12) {
+            fprintf(stderr, "qr_solve: x is rank deficient (column %zu)\n", j + 1);
+            exit(1);
+        }
+    }
+    ARRV b = subview(view(qty), 0, 0, n, yv.dims[1]);
+    backsolve_view(r, b, 0);
+    ARRP out = copy_view(b);
+    free_array(&qty);
+    return out;
+}
+
+
+
+/*
+    SYMMETRIC EIGENDECOMPOSITION
+    Householder reduction to tridiagonal form, accumulating the
+    transformations (EISPACK tred2), then the implicit QL algorithm on the
+    tridiagonal matrix (tql2), as in JAMA. V is column-major n x n, so the
+    inner loops walk its columns.
+*/
+#define V_(i, j) V[(i) + (j) * n]
+
+static void _tred2(double *V, double *d, double *e, size_t n) {
+    for (size_t j = 0; j < n; ++j)
+        d[j] = V_(n - 1, j);
+    for (size_t i = n - 1; i > 0; --i) {
+        double scale = 0., h = 0.;
+        for (size_t k = 0; k < i; ++k)
+            scale += fabs(d[k]);
+        if (scale == 0.) {
+            e[i] = d[i - 1];
+            for (size_t j = 0; j < i; ++j) {
+                d[j] = V_(i - 1, j);
+                V_(i, j) = 0.;
+                V_(j, i) = 0.;
+            }
+        } else {
+            for (size_t k = 0; k < i; ++k) {
+                d[k] /= scale;
+                h += d[k] * d[k];
+            }
+            double f = d[i - 1];
+            double g = (f > 0) ? -sqrt(h) : sqrt(h);
+            e[i] = scale * g;
+            h -= f * g;
+            d[i - 1] = f - g;
+            for (size_t j = 0; j < i; ++j)
+                e[j] = 0.;
+            for (size_t j = 0; j < i; ++j) {
+                f = d[j];
+                V_(j, i) = f;
+                g = e[j] + V_(j, j) * f;
+                for (size_t k = j + 1; k <= i - 1; ++k) {
+                    g += V_(k, j) * d[k];
+                    e[k] += V_(k, j) * f;
+                }
+                e[j] = g;
+            }
+            f = 0.;
+            for (size_t j = 0; j < i; ++j) {
+                e[j] /= h;
+                f += e[j] * d[j];
+            }
+            double hh = f / (h + h);
+            for (size_t j = 0; j < i; ++j)
+                e[j] -= hh * d[j];
+            for (size_t j = 0; j < i; ++j) {
+                f = d[j];
+                g = e[j];
+                for (size_t k = j; k <= i - 1; ++k)
+                    V_(k, j) -= (f * e[k] + g * d[k]);
+                d[j] = V_(i - 1, j);
+                V_(i, j) = 0.;
+            }
+        }
+        d[i] = h;
+    }
+    // accumulate the transformations
+    for (size_t i = 0; i + 1 < n; ++i) {
+        V_(n - 1, i) = V_(i, i);
+        V_(i, i) = 1.;
+        double h = d[i + 1];
+        if (h != 0.) {
+            for (size_t k = 0; k <= i; ++k)
+                d[k] = V_(k, i + 1) / h;
+            for (size_t j = 0; j <= i; ++j) {
+                double g = 0.;
+                for (size_t k = 0; k <= i; ++k)
+                    g += V_(k, i + 1) * V_(k, j);
+                for (size_t k = 0; k <= i; ++k)
+                    V_(k, j) -= g * d[k];
+            }
+        }
+        for (size_t k = 0; k <= i; ++k)
+            V_(k, i + 1) = 0.;
+    }
+    for (size_t j = 0; j < n; ++j) {
+        d[j] = V_(n - 1, j);
+        V_(n - 1, j) = 0.;
+    }
+    V_(n - 1, n - 1) = 1.;
+    e[0] = 0.;
+}
+
+static void _tql2(double *V, double *d, double *e, size_t n) {
+    for (size_t i = 1; i < n; ++i)
+        e[i - 1] = e[i];
+    e[n - 1] = 0.;
+    double f = 0., tst1 = 0., eps = 0x1p-52;
+    for (size_t l = 0; l < n; ++l) {
+        tst1 = fmax(tst1, fabs(d[l]) + fabs(e[l]));
+        size_t m = l;
+        while (m < n - 1 && fabs(e[m]) > eps * tst1)
+            ++m;
+        int iter = 0;
+        if (m > l) {
+            do {
+                if (++iter > 60) {
+                    fprintf(stderr, "eigen_sym: QL iteration did not converge\n");
+                    exit(1);
+                }
+                double g = d[l];
+                double p = (d[l + 1] - g) / (2. * e[l]);
+                double r = hypot(p, 1.);
+                if (p < 0)
+                    r = -r;
+                d[l] = e[l] / (p + r);
+                d[l + 1] = e[l] * (p + r);
+                double dl1 = d[l + 1];
+                double h = g - d[l];
+                for (size_t i = l + 2; i < n; ++i)
+                    d[i] -= h;
+                f += h;
+                // implicit QL transformation
+                p = d[m];
+                double c = 1., c2 = 1., c3 = 1., el1 = e[l + 1], s = 0., s2 = 0.;
+                for (size_t i = m; i-- > l; ) {
+                    c3 = c2;
+                    c2 = c;
+                    s2 = s;
+                    g = c * e[i];
+                    h = c * p;
+                    r = hypot(p, e[i]);
+                    e[i + 1] = s * r;
+                    s = e[i] / r;
+                    c = p / r;
+                    p = c * d[i] - s * g;
+                    d[i + 1] = h + s * (c * g + s * d[i]);
+                    double *vi = &V_(0, i), *vi1 = &V_(0, i + 1);
+                    for (size_t k = 0; k < n; ++k) {
+                        h = vi1[k];
+                        vi1[k] = s * vi[k] + c * h;
+                        vi[k] = c * vi[k] - s * h;
+                    }
+                }
+                p = -s * s2 * c3 * el1 * e[l] / dl1;
+                e[l] = s * p;
+                d[l] = c * p;
+            } while (fabs(e[l]) > eps * tst1);
+        }
+        d[l] += f;
+        e[l] = 0.;
+    }
+}
+
+/*sort d decreasing, permuting the columns of V (n x n, or NULL) along*/
+static void _sort_desc(double *d, double *V, size_t nrow, size_t n) {
+    for (size_t i = 0; i + 1 < n; ++i) {
+        size_t k = i;
+        for (size_t j = i + 1; j < n; ++j) {
+            if (d[j] > d[k])
+                k = j;
+        }
+        if (k == i)
+            continue;
+        double t = d[i]; d[i] = d[k]; d[k] = t;
+        if (V) {
+            for (size_t r = 0; r < nrow; ++r) {
+                t = V[r + i * nrow]; V[r + i * nrow] = V[r + k * nrow]; V[r + k * nrow] = t;
+            }
+        }
+    }
+}
+
+eigen_t eigen_sym(ARRP a) {
+    _check_square_reals(view(a), "eigen_sym");
+    size_t n = dims(a)[0];
+    eigen_t out;
+    out.values = alloc_array(REALS_ARR, n, 1);
+    out.vectors = alloc_array_layout(REALS_ARR, n, n, COL_MAJOR);
+    if (n == 0)
+        return out;
+    double *V = real(out.vectors), *d = real(out.values);
+    // lower triangle of a, mirrored
+    for (size_t j = 0; j < n; ++j) {
+        for (size_t i = j; i < n; ++i)
+            V_(i, j) = V_(j, i) = reals_elt(a, i, j);
+    }
+    double *e = chk_malloc(n * sizeof(double));
+    _tred2(V, d, e, n);
+    _tql2(V, d, e, n);
+    chk_free(e);
+    _sort_desc(d, V, n, n);
+    return out;
+}
+
+#undef V_
+
+void free_eigen(eigen_t *e) {
+    free_array(&e->values);
+    free_array(&e->vectors);
+}
+
+
+
+/*
+    SVD
+*/
+
+/*
+    One-sided (Hestenes) Jacobi on the columns of the n x n column-major W:
+    rotate column pairs until all are mutually orthogonal, accumulating the
+    rotations in V. Then W = U diag(d), so d is read off the column norms.
+    Slow for large n but accurate to the relative size of each singular
+    value; it is only ever run on the small triangular factor from QR.
+*/
+static void _jacobi_svd(double *W, double *V, double *d, size_t n) {
+    const double eps = 0x1p-52;
+    for (size_t i = 0; i < n * n; ++i)
+        V[i] = 0.;
+    for (size_t i = 0; i < n; ++i)
+        V[i + i * n] = 1.;
+    int rotated = 1;
+    for (int sweep = 0; rotated && sweep < 60; ++sweep) {
+        rotated = 0;
+        for (size_t p = 0; p + 1 < n; ++p) {
+            for (size_t q = p + 1; q < n; ++q) {
+                double *wp = W + p * n, *wq = W + q * n;
+                double alpha = 0., beta = 0., gamma = 0.;
+                for (size_t i = 0; i < n; ++i) {
+                    alpha += wp[i] * wp[i];
+                    beta += wq[i] * wq[i];
+                    gamma += wp[i] * wq[i];
+                }
+                if (fabs(gamma) <= eps * sqrt(alpha * beta))
+                    continue;
+                rotated = 1;
+                double zeta = (beta - alpha) / (2. * gamma);
+                double t = ((zeta >= 0) ? 1. : -1.) / (fabs(zeta) + sqrt(1. + zeta * zeta));
+                double c = 1. / sqrt(1. + t * t), s = c * t;
+                double *vp = V + p * n, *vq = V + q * n;
+                for (size_t i = 0; i < n; ++i) {
+                    double x = wp[i], y = wq[i];
+                    wp[i] = c * x - s * y;
+                    wq[i] = s * x + c * y;
+                    x = vp[i]; y = vq[i];
+                    vp[i] = c * x - s * y;
+                    vq[i] = s * x + c * y;
+                }
+            }
+        }
+    }
+    if (rotated) {
+        fprintf(stderr, "svd: Jacobi sweeps did not converge\n");
+        exit(1);
+    }
+    for (size_t j = 0; j < n; ++j) {
+        double s = 0.;
+        for (size_t i = 0; i < n; ++i)
+            s += W[i + j * n] * W[i + j * n];
+        d[j] = sqrt(s);
+        for (size_t i = 0; i < n; ++i)
+            W[i + j * n] = (d[j] > 0) ? W[i + j * n] / d[j] : 0.;
+    }
+}
+
+/*sort d decreasing and permute the columns of u (m x k) and v (n x k)*/
+static void _svd_sort(svd_t *s) {
+    size_t k = dims(s->d)[0], m = dims(s->u)[0], n = dims(s->v)[0];
+    double *d = real(s->d), *U = real(s->u), *V = real(s->v);
+    for (size_t i = 0; i + 1 < k; ++i) {
+        size_t b = i;
+        for (size_t j = i + 1; j < k; ++j) {
+            if (d[j] > d[b])
+                b = j;
+        }
+        if (b == i)
+            continue;
+        double t = d[i]; d[i] = d[b]; d[b] = t;
+        for (size_t r = 0; r < m; ++r) {
+            t = U[r + i * m]; U[r + i * m] = U[r + b * m]; U[r + b * m] = t;
+        }
+        for (size_t r = 0; r < n; ++r) {
+            t = V[r + i * n]; V[r + i * n] = V[r + b * n]; V[r + b * n] = t;
+        }
+    }
+}
+
+/*
+    Tall case (m >= n): A = QR, R = U_r diag(d) V' by one-sided Jacobi, then
+    U = Q U_r, applied blockwise without forming Q. Wide matrices go through
+    the transpose. Columns of u for zero singular values are zero.
+*/
+svd_t svd(ARRP a) {
+    if (arrtype(a) != REALS_ARR) {
+        fprintf(stderr, "svd: only REALS_ARR supported\n");
+        exit(1);
+    }
+    size_t m = dims(a)[0], n = dims(a)[1];
+    if (m < n) {
+        ARRP at = as_layout(a, COL_MAJOR);
+        set_transpose(at);
+        svd_t st = svd(at);
+        free_array(&at);
+        svd_t s = {st.d, st.v, st.u};
+        return s;
+    }
+    svd_t s;
+    s.d = alloc_array(REALS_ARR, n, 1);
+    s.u = alloc_array_layout(REALS_ARR, m, n, COL_MAJOR);
+    s.v = alloc_array_layout(REALS_ARR, n, n, COL_MAJOR);
+    if (n == 0)
+        return s;
+    qr_t q = qr(a);
+    ARRP w = qr_R(&q);
+    _jacobi_svd(real(w), real(s.v), real(s.d), n);
+    set_view(subview(view(s.u), 0, 0, n, n), view(w));
+    qr_qy_view(&q, view(s.u));
+    free_array(&w);
+    free_qr(&q);
+    _svd_sort(&s);
+    return s;
+}
+
+/*standard normal fill by Box-Muller on the Mersenne Twister*/
+static void _fill_gauss(ARRP x, uint32_t seed) {
+    MTRand r = seedRand(seed);
+    size_t len = length(x);
+    double *X = real(x);
+    genRands(&r, X, len);
+    double odd = (len % 2) ? genRand(&r) : 0.;
+    for (size_t i = 0; i < len; i += 2) {
+        double u1 = X[i], u2 = (i + 1 < len) ? X[i + 1] : odd;
+        double rad = sqrt(-2. * log((u1 > 0) ? u1 : 0x1p-53));
+        X[i] = rad * cos(2. * M_PI * u2);
+        if (i + 1 < len)
+            X[i + 1] = rad * sin(2. * M_PI * u2);
+    }
+}
+
+/*orthonormal basis for the columns of y (m x l, m >= l), freeing y*/
+static ARRP _orth(ARRP y) {
+    qr_t q = qr(y);
+    ARRP Q = qr_Q(&q);
+    free_qr(&q);
+    free_array(&y);
+    return Q;
+}
+
+/*
+    Randomized SVD (Halko, Martinsson & Tropp 2011): Y = A Omega for a
+    Gaussian n x l test matrix, l = k + oversample, sharpened by n_iter
+    power iterations Y = A (A'Q) with re-orthonormalization in between.
+    With Q an orthonormal basis of Y, the small l x n matrix B = Q'A has
+    the exact thin SVD B = U_b D V', and A ~ (Q U_b) D V'. Every pass over
+    A is one gemm_view.
+*/
+svd_t svd_rand(ARRP a, size_t k, size_t oversample, size_t n_iter, uint32_t seed) {
+    if (arrtype(a) != REALS_ARR) {
+        fprintf(stderr, "svd_rand: only REALS_ARR supported\n");
+        exit(1);
+    }
+    size_t m = dims(a)[0], n = dims(a)[1];
+    size_t mn = (m < n) ? m : n;
+    if (k == 0 || k > mn) {
+        fprintf(stderr, "svd_rand: k must be between 1 and min(nrow, ncol)\n");
+        exit(1);
+    }
+    size_t l = (k + oversample < mn) ? k + oversample : mn;
+    ARRV av = view(a);
+
+    ARRP omega = alloc_array_layout(REALS_ARR, n, l, COL_MAJOR);
+    _fill_gauss(omega, seed);
+    ARRP y = alloc_array_layout(REALS_ARR, m, l, COL_MAJOR);
+    gemm_view(1.0, av, view(omega), 0.0, view(y));
+    free_array(&omega);
+    ARRP Q = _orth(y);
+    for (size_t it = 0; it < n_iter; ++it) {
+        ARRP z = alloc_array_layout(REALS_ARR, n, l, COL_MAJOR);
+        gemm_view(1.0, transpose_view(av), view(Q), 0.0, view(z));
+        free_array(&Q);
+        z = _orth(z);
+        y = alloc_array_layout(REALS_ARR, m, l, COL_MAJOR);
+        gemm_view(1.0, av, view(z), 0.0, view(y));
+        free_array(&z);
+        Q = _orth(y);
+    }
+
+    ARRP b = alloc_array_layout(REALS_ARR, l, n, COL_MAJOR);
+    gemm_view(1.0, transpose_view(view(Q)), av, 0.0, view(b));
+    svd_t sb = svd(b);
+    free_array(&b);
+
+    svd_t s;
+    s.d = alloc_array(REALS_ARR, k, 1);
+    s.u = alloc_array_layout(REALS_ARR, m, k, COL_MAJOR);
+    s.v = alloc_array_layout(REALS_ARR, n, k, COL_MAJOR);
+    set_view(view(s.d), subview(view(sb.d), 0, 0, k, 1));
+    set_view(view(s.v), subview(view(sb.v), 0, 0, n, k));
+    gemm_view(1.0, view(Q), subview(view(sb.u), 0, 0, l, k), 0.0, view(s.u));
+    free_svd(&sb);
+    free_array(&Q);
+    return s;
+}
+
+void free_svd(svd_t *s) {
+    free_array(&s->d);
+    free_array(&s->u);
+    free_array(&s->v);
+}
@@ -0,0 +1,78 @@
+#ifndef __LINALG_H
+#define __LINALG_H
+
+#include "array.h"
+
+
+/*
+    CHOLESKY
+    Upper-triangular factor R with A = R'R, for symmetric positive definite
+    REALS_ARR matrices. chol_view works in place and returns 0, or k + 1 if
+    the leading minor of order k + 1 is not positive definite.
+*/
+int chol_view(ARRV a);
+ARRP chol(ARRP a);
+ARRP chol2inv(ARRP r);
+
+/*
+    TRIANGULAR SOLVES
+    Solve R X = B (or R'X = B if trans) for upper-triangular R; the view
+    versions overwrite B with X.
+*/
+void backsolve_view(ARRV r, ARRV b, int trans);
+ARRP backsolve(ARRP r, ARRP b);
+ARRP forwardsolve_t(ARRP r, ARRP b);
+
+/*
+    QR
+    Householder QR, X = QR, stored compactly as in LAPACK: R in the upper
+    triangle of qr, the reflectors below it (unit diagonal implied), and
+    their scalings in tau (min(m, n) x 1). Q is never formed unless asked
+    for; qr_qty / qr_qy apply Q' / Q to the columns of b in place.
+*/
+typedef struct qr_t {
+    ARRP qr;
+    ARRP tau;
+} qr_t;
+
+void qr_view(ARRV a, double *tau);
+qr_t qr(ARRP x);
+void free_qr(qr_t *q);
+void qr_qty_view(const qr_t *q, ARRV b);
+void qr_qy_view(const qr_t *q, ARRV b);
+ARRP qr_R(const qr_t *q);
+ARRP qr_Q(const qr_t *q);
+ARRP qr_solve(const qr_t *q, ARRP b);
+
+/*
+    SYMMETRIC EIGENDECOMPOSITION
+    A = V diag(values) V' for symmetric A (only the lower triangle is read),
+    values in decreasing order, eigenvectors in the columns of vectors.
+*/
+typedef struct eigen_t {
+    ARRP values;   // n x 1
+    ARRP vectors;  // n x n
+} eigen_t;
+
+eigen_t eigen_sym(ARRP a);
+void free_eigen(eigen_t *e);
+
+/*
+    SVD
+    Thin SVD A = U diag(d) V', d decreasing, k = min(m, n) components.
+    svd_rand approximates the top k through a randomized range finder
+    (oversample extra columns, n_iter power iterations), for when k is far
+    below min(m, n).
+*/
+typedef struct svd_t {
+    ARRP d;   // k x 1
+    ARRP u;   // m x k
+    ARRP v;   // n x k
+} svd_t;
+
+svd_t svd(ARRP a);
+svd_t svd_rand(ARRP a, size_t k, size_t oversample, size_t n_iter, uint32_t seed);
+void free_svd(svd_t *s);
+
+
+#endif // __LINALG_H
@@ -18,6 +18,7 @@ void dllist_append(struct DLList *list, struct DLNode *newnode) {
         }
         list->tail->next = newnode;
         newnode->prev = list->tail;
+        newnode->next = NULL;
         list->tail = newnode;
     }
     list->len++;
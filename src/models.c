@@ -0,0 +1,849 @@
+#include "models.h"
+#include "array.h"
+#include "linalg.h"
+
+#include "memory.h"
+#include "list.h"
+#include "sparse.h"
+
+#include <stdio.h>
+#include <string.h> // strlen, strcmp, strncmp
+#include <ctype.h> // isspace
+#include <stdint.h> // uint64_t
+#include <math.h> // sqrt, exp, log
+
+
+
+/*y as an n x 1 view, whichever way round the vector is stored*/
+static ARRV _column_view(ARRP y, size_t n, const char *caller) {
+    if (arrtype(y) != REALS_ARR || length(y) != n ||
+        (dims(y)[0] != 1 && dims(y)[1] != 1)) {
+        fprintf(stderr, "%s: y must be a REALS_ARR vector of length nrow(X)\n",
+                caller);
+        exit(1);
+    }
+    if (has_na(y)) {
+        fprintf(stderr, "%s: y has missing values\n", caller);
+        exit(1);
+    }
+    return transpose_view(slice(y, 0, n, 1));
+}
+
+/*residual sum of squares of y - Xb*/
+static double _rss(ARRV xv, ARRV yv, ARRP coef) {
+    ARRP resid = copy_view(yv);
+    gemm_view(-1.0, xv, view(coef), 1.0, view(resid));
+    double rss = 0.;
+    for (size_t i = 0; i < length(resid); ++i)
+        rss += real(resid)[i] * real(resid)[i];
+    free_array(&resid);
+    return rss;
+}
+
+/*
+    Standard errors sigma * sqrt(diag((X'X)^-1)) from the triangular factor
+    R (R'R = X'X): diag((X'X)^-1) = row sums of squares of R^-1. Only the
+    upper triangle of r is read.
+*/
+static ARRP _chol_se(ARRV r, double sigma) {
+    size_t p = r.dims[0];
+    ARRP rinv = alloc_array_layout(REALS_ARR, p, p, COL_MAJOR);
+    for (size_t i = 0; i < p; ++i)
+        set_reals_elt(rinv, i, i, 1.);
+    backsolve_view(r, view(rinv), 0);
+    ARRP se = alloc_array(REALS_ARR, p, 1);
+    for (size_t j = 0; j < p; ++j) {
+        double s = 0.;
+        for (size_t k = j; k < p; ++k)
+            s += real(rinv)[j + k * p] * real(rinv)[j + k * p];
+        real(se)[j] = sigma * sqrt(s);
+    }
+    free_array(&rinv);
+    return se;
+}
+
+static void _lm_finish(lm_t *fit, double rss, size_t n, ARRV r) {
+    fit->df = n - r.dims[0];
+    fit->sigma = sqrt(rss / (double)fit->df);
+    fit->se = _chol_se(r, fit->sigma);
+}
+
+static void _check_design(ARRP X, const char *caller) {
+    if (arrtype(X) != REALS_ARR) {
+        fprintf(stderr, "%s: X must be REALS_ARR\n", caller);
+        exit(1);
+    }
+    if (has_na(X)) {
+        fprintf(stderr, "%s: X has missing values\n", caller);
+        exit(1);
+    }
+    if (dims(X)[0] <= dims(X)[1]) {
+        fprintf(stderr, "%s: need more observations than columns\n", caller);
+        exit(1);
+    }
+}
+
+/*
+    Cost is dominated by forming X'X (syrk, n p^2 / 2 flops, threaded); the
+    Cholesky factorization and solves are O(p^3) and do not touch X.
+    The normal equations square the condition number of X, which is fine
+    for well-conditioned designs; lm_fit_qr is the stable alternative.
+*/
+lm_t lm_fit(ARRP X, ARRP y) {
+    _check_design(X, "lm_fit");
+    size_t n = dims(X)[0], p = dims(X)[1];
+    ARRV xv = view(X);
+    ARRV yv = _column_view(y, n, "lm_fit");
+
+    ARRP R = alloc_array_layout(REALS_ARR, p, p, COL_MAJOR);
+    syrk_view(1.0, xv, 0.0, view(R));
+    int info = chol_view(view(R));
+    if (info) {
+        fprintf(stderr, "lm_fit: X is rank deficient (column %d)\n", info);
+        exit(1);
+    }
+
+    lm_t fit;
+    fit.coef = alloc_array(REALS_ARR, p, 1);
+    gemm_view(1.0, transpose_view(xv), yv, 0.0, view(fit.coef));
+    backsolve_view(view(R), view(fit.coef), 1);
+    backsolve_view(view(R), view(fit.coef), 0);
+    _lm_finish(&fit, _rss(xv, yv, fit.coef), n, view(R));
+    free_array(&R);
+    return fit;
+}
+
+/*
+    Same fit through Householder QR of X: accurate to the conditioning of X
+    rather than of X'X, at roughly twice the flops of lm_fit.
+*/
+lm_t lm_fit_qr(ARRP X, ARRP y) {
+    _check_design(X, "lm_fit_qr");
+    size_t n = dims(X)[0], p = dims(X)[1];
+    ARRV yv = _column_view(y, n, "lm_fit_qr");
+
+    qr_t q = qr(X);
+    lm_t fit;
+    fit.coef = qr_solve(&q, y);
+    _lm_finish(&fit, _rss(view(X), yv, fit.coef), n,
+               subview(view(q.qr), 0, 0, p, p));
+    free_qr(&q);
+    return fit;
+}
+
+/*
+    STREAMED LEAST SQUARES
+    Each batch adds its rows' X'X (syrk, upper triangle then mirrored) and
+    X'y to the running sums; nothing of size n is kept. The residual sum of
+    squares comes from y'y - b'X'y at the end, so it loses relative
+    accuracy when the fit is very close (RSS << y'y).
+*/
+lm_accum_t lm_accum_init(size_t p) {
+    lm_accum_t acc;
+    acc.p = p;
+    acc.n = 0;
+    acc.xtx = alloc_array_layout(REALS_ARR, p, p, COL_MAJOR);
+    acc.xty = alloc_array(REALS_ARR, p, 1);
+    acc.yty = 0.;
+    return acc;
+}
+
+void lm_accum_update_view(lm_accum_t *acc, ARRV X, ARRV y) {
+    if (X.arr->type != REALS_ARR || X.dims[1] != acc->p) {
+        fprintf(stderr, "lm_accum_update: X must be REALS_ARR with %zu columns\n",
+                acc->p);
+        exit(1);
+    }
+    if (y.arr->type != REALS_ARR || y.dims[0] != X.dims[0] || y.dims[1] != 1) {
+        fprintf(stderr, "lm_accum_update: y must be a REALS_ARR column of nrow(X)\n");
+        exit(1);
+    }
+    syrk_view(1.0, X, 1.0, view(acc->xtx));
+    gemm_view(1.0, transpose_view(X), y, 1.0, view(acc->xty));
+    for (size_t i = 0; i < y.dims[0]; ++i) {
+        double yi = view_elt(y, i, 0);
+        acc->yty += yi * yi;
+    }
+    acc->n += X.dims[0];
+}
+
+void lm_accum_update(lm_accum_t *acc, ARRP X, ARRP y) {
+    lm_accum_update_view(acc, view(X), _column_view(y, dims(X)[0], "lm_accum_update"));
+}
+
+/*combine the sums of two accumulators (e.g. from separate scans) into a*/
+void lm_accum_merge(lm_accum_t *a, const lm_accum_t *b) {
+    if (a->p != b->p) {
+        fprintf(stderr, "lm_accum_merge: accumulators have different p\n");
+        exit(1);
+    }
+    set_add(a->xtx, b->xtx);
+    set_add(a->xty, b->xty);
+    a->yty += b->yty;
+    a->n += b->n;
+}
+
+/*solve the accumulated normal equations; acc is left unchanged*/
+lm_t lm_accum_fit(const lm_accum_t *acc) {
+    size_t p = acc->p;
+    if (acc->n <= p) {
+        fprintf(stderr, "lm_accum_fit: need more observations than columns\n");
+        exit(1);
+    }
+    ARRP R = copyarr(acc->xtx);
+    int info = chol_view(view(R));
+    if (info) {
+        fprintf(stderr, "lm_accum_fit: X is rank deficient (column %d)\n", info);
+        exit(1);
+    }
+    lm_t fit;
+    fit.coef = copyarr(acc->xty);
+    backsolve_view(view(R), view(fit.coef), 1);
+    backsolve_view(view(R), view(fit.coef), 0);
+    double bxty = 0.;
+    for (size_t j = 0; j < p; ++j)
+        bxty += real(fit.coef)[j] * real(acc->xty)[j];
+    double rss = acc->yty - bxty;
+    _lm_finish(&fit, (rss > 0) ? rss : 0., acc->n, view(R));
+    free_array(&R);
+    return fit;
+}
+
+void free_lm_accum(lm_accum_t *acc) {
+    free_array(&acc->xtx);
+    free_array(&acc->xty);
+}
+
+void free_lm(lm_t *fit) {
+    free_array(&fit->coef);
+    free_array(&fit->se);
+}
+
+
+
+/*
+    GENERALIZED LINEAR MODELS
+    Canonical links: identity (gaussian), logit (binomial), log (poisson).
+*/
+
+glm_work_t glm_work_alloc(size_t n, size_t p) {
+    glm_work_t w;
+    w.n = n;
+    w.p = p;
+    w.eta = alloc_array(REALS_ARR, n, 1);
+    w.mu = alloc_array(REALS_ARR, n, 1);
+    w.w = alloc_array(REALS_ARR, n, 1);
+    w.wz = alloc_array(REALS_ARR, n, 1);
+    w.wx = alloc_array_layout(REALS_ARR, n, p, COL_MAJOR);
+    w.xtwx = alloc_array_layout(REALS_ARR, p, p, COL_MAJOR);
+    w.coef = alloc_array(REALS_ARR, p, 1);
+    return w;
+}
+
+void free_glm_work(glm_work_t *w) {
+    free_array(&w->eta);
+    free_array(&w->mu);
+    free_array(&w->w);
+    free_array(&w->wz);
+    free_array(&w->wx);
+    free_array(&w->xtwx);
+    free_array(&w->coef);
+}
+
+#define GLM_EPS 1e-10
+
+static double _linkinv(glm_family_t family, double eta) {
+    switch (family) {
+    case BINOMIAL_FAMILY: {
+        double mu = 1. / (1. + exp(-eta));
+        return (mu < GLM_EPS) ? GLM_EPS : (mu > 1. - GLM_EPS) ? 1. - GLM_EPS : mu;
+    }
+    case POISSON_FAMILY: {
+        double mu = exp(eta);
+        return (mu < GLM_EPS) ? GLM_EPS : mu;
+    }
+    default:
+        return eta;
+    }
+}
+
+/*for the canonical links dmu/deta equals the variance function*/
+static double _variance(glm_family_t family, double mu) {
+    switch (family) {
+    case BINOMIAL_FAMILY: return mu * (1. - mu);
+    case POISSON_FAMILY:  return mu;
+    default:              return 1.;
+    }
+}
+
+static double _ylogy(double y, double mu) {
+    return (y > 0) ? y * log(y / mu) : 0.;
+}
+
+static double _deviance(glm_family_t family, const double *y, const double *mu,
+                        size_t n) {
+    double dev = 0.;
+    for (size_t i = 0; i < n; ++i) {
+        switch (family) {
+        case BINOMIAL_FAMILY:
+            dev += 2. * (_ylogy(y[i], mu[i]) + _ylogy(1. - y[i], 1. - mu[i]));
+            break;
+        case POISSON_FAMILY:
+            dev += 2. * (_ylogy(y[i], mu[i]) - (y[i] - mu[i]));
+            break;
+        default:
+            dev += (y[i] - mu[i]) * (y[i] - mu[i]);
+            break;
+        }
+    }
+    return dev;
+}
+
+/*
+    Iteratively reweighted least squares, as in R's glm.fit: each step
+    solves the weighted least squares problem of the working response
+    z = eta + (y - mu) / mu', with weights w = mu'^2 / V(mu), through the
+    Cholesky factor of X'WX. All per-iteration state lives in the
+    workspace, so the loop itself never allocates on the memstack, and a
+    workspace can be reused over many fits of the same shape (e.g. in a
+    bootstrap). y is a 0/1 (binomial) or count (poisson) vector.
+*/
+#define GLM_MAXIT 25
+#define GLM_TOL 1e-8
+glm_t glm_fit_work(ARRP X, ARRP y, glm_family_t family, glm_work_t *work) {
+    _check_design(X, "glm_fit");
+    size_t n = dims(X)[0], p = dims(X)[1];
+    if (work->n != n || work->p != p) {
+        fprintf(stderr, "glm_fit: workspace is %zu x %zu, X is %zu x %zu\n",
+                work->n, work->p, n, p);
+        exit(1);
+    }
+    ARRV xv = view(X);
+    ARRP yc = copy_view(_column_view(y, n, "glm_fit"));
+    const double *Y = real(yc);
+    double *eta = real(work->eta), *mu = real(work->mu), *w = real(work->w),
+           *wz = real(work->wz), *wx = real(work->wx);
+    for (size_t i = 0; i < n; ++i) {
+        if ((family == BINOMIAL_FAMILY && (Y[i] < 0 || Y[i] > 1)) ||
+            (family == POISSON_FAMILY && Y[i] < 0)) {
+            fprintf(stderr, "glm_fit: y out of range for the %s family\n",
+                    (family == BINOMIAL_FAMILY) ? "binomial" : "poisson");
+            exit(1);
+        }
+        // starting values as in R's family()$initialize
+        mu[i] = (family == BINOMIAL_FAMILY) ? (Y[i] + 0.5) / 2.
+              : (family == POISSON_FAMILY)  ? Y[i] + 0.1 : Y[i];
+        eta[i] = (family == BINOMIAL_FAMILY) ? log(mu[i] / (1. - mu[i]))
+               : (family == POISSON_FAMILY)  ? log(mu[i]) : mu[i];
+    }
+
+    glm_t fit;
+    fit.converged = 0;
+    double dev = _deviance(family, Y, mu, n);
+    for (fit.iter = 1; fit.iter <= GLM_MAXIT; ++fit.iter) {
+        // sqrt(W) X and sqrt(W) z, so X'WX is a plain syrk
+        for (size_t i = 0; i < n; ++i) {
+            double v = _variance(family, mu[i]);
+            w[i] = sqrt(v);
+            wz[i] = w[i] * (eta[i] + (Y[i] - mu[i]) / v);
+        }
+        for (size_t j = 0; j < p; ++j) {
+            double *col = wx + j * n;
+            const double *xj = xv.arr->reals + xv.offset + j * xv.strides[1];
+            for (size_t i = 0; i < n; ++i)
+                col[i] = w[i] * xj[i * xv.strides[0]];
+        }
+        syrk_view(1.0, view(work->wx), 0.0, view(work->xtwx));
+        gemm_view(1.0, transpose_view(view(work->wx)), view(work->wz), 0.0,
+                  view(work->coef));
+        int info = chol_view(view(work->xtwx));
+        if (info) {
+            fprintf(stderr, "glm_fit: X'WX is singular (column %d)\n", info);
+            exit(1);
+        }
+        backsolve_view(view(work->xtwx), view(work->coef), 1);
+        backsolve_view(view(work->xtwx), view(work->coef), 0);
+
+        gemm_view(1.0, xv, view(work->coef), 0.0, view(work->eta));
+        for (size_t i = 0; i < n; ++i)
+            mu[i] = _linkinv(family, eta[i]);
+        double dev_old = dev;
+        dev = _deviance(family, Y, mu, n);
+        if (fabs(dev - dev_old) / (fabs(dev) + 0.1) < GLM_TOL) {
+            fit.converged = 1;
+            break;
+        }
+    }
+    if (!fit.converged) {
+        fit.iter = GLM_MAXIT;
+        fprintf(stderr, "Warning: glm_fit: did not converge in %d iterations\n",
+                GLM_MAXIT);
+    }
+
+    fit.deviance = dev;
+    fit.df = n - p;
+    // dispersion is fixed at 1 for binomial / poisson, estimated for gaussian
+    double phi = (family == GAUSSIAN_FAMILY) ? dev / (double)fit.df : 1.;
+    fit.coef = copyarr(work->coef);
+    fit.se = _chol_se(view(work->xtwx), sqrt(phi));
+    free_array(&yc);
+    return fit;
+}
+
+glm_t glm_fit(ARRP X, ARRP y, glm_family_t family) {
+    _check_design(X, "glm_fit");
+    glm_work_t work = glm_work_alloc(dims(X)[0], dims(X)[1]);
+    glm_t fit = glm_fit_work(X, y, family, &work);
+    free_glm_work(&work);
+    return fit;
+}
+
+void free_glm(glm_t *fit) {
+    free_array(&fit->coef);
+    free_array(&fit->se);
+}
+
+
+
+/*
+    MODEL MATRICES
+*/
+
+/*
+    Open-addressing string -> level index table for factor levels (FNV-1a,
+    linear probing, kept at most half full). Keys are copies.
+*/
+typedef struct _level_hash {
+    char **keys;
+    size_t *vals;
+    size_t cap;
+    size_t n;
+} _level_hash;
+
+static uint64_t _fnv1a(const char *s) {
+    uint64_t h = 14695981039346656037ULL;
+    for (; *s; ++s) {
+        h ^= (unsigned char)*s;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static void _lh_init(_level_hash *h, size_t cap) {
+    h->cap = cap;
+    h->n = 0;
+    h->keys = chk_calloc(cap, sizeof(char*));
+    h->vals = chk_malloc(cap * sizeof(size_t));
+}
+
+static void _lh_free(_level_hash *h) {
+    for (size_t i = 0; i < h->cap; ++i)
+        chk_free(h->keys[i]);
+    chk_free(h->keys);
+    chk_free(h->vals);
+}
+
+/*index of key, inserting it as level h->n if new*/
+static size_t _lh_get(_level_hash *h, const char *key) {
+    if (2 * (h->n + 1) > h->cap) {
+        _level_hash big;
+        _lh_init(&big, 2 * h->cap);
+        for (size_t i = 0; i < h->cap; ++i) {
+            if (!h->keys[i])
+                continue;
+            size_t j = _fnv1a(h->keys[i]) & (big.cap - 1);
+            while (big.keys[j])
+                j = (j + 1) & (big.cap - 1);
+            big.keys[j] = h->keys[i];
+            big.vals[j] = h->vals[i];
+            h->keys[i] = NULL;
+        }
+        big.n = h->n;
+        _lh_free(h);
+        *h = big;
+    }
+    size_t j = _fnv1a(key) & (h->cap - 1);
+    while (h->keys[j]) {
+        if (strcmp(h->keys[j], key) == 0)
+            return h->vals[j];
+        j = (j + 1) & (h->cap - 1);
+    }
+    chk_strcpy(&h->keys[j], key);
+    h->vals[j] = h->n;
+    return h->n++;
+}
+
+/*a data frame column as used by the formula: numeric, or a factor*/
+typedef struct _mm_var {
+    int col;
+    int is_factor;
+    ARRP data;
+    size_t nlev;
+    char **levels;   // sorted labels (factors)
+    size_t *codes;   // level of each row (factors)
+} _mm_var;
+
+typedef struct _mm_level {
+    const char *label;
+    double num;
+    size_t old;
+} _mm_level;
+
+static int _cmp_level_str(const void *a, const void *b) {
+    return strcmp(((const _mm_level*)a)->label, ((const _mm_level*)b)->label);
+}
+
+static int _cmp_level_num(const void *a, const void *b) {
+    double x = ((const _mm_level*)a)->num, y = ((const _mm_level*)b)->num;
+    return (x > y) - (x < y);
+}
+
+/*
+    hash every used row to a level, then renumber the levels in sorted
+    order; codes are indexed by data frame row
+*/
+static void _mm_factor_levels(_mm_var *v, size_t n, const size_t *rows, size_t nobs) {
+    _level_hash h;
+    _lh_init(&h, 64);
+    v->codes = chk_malloc(n * sizeof(size_t));
+    char buf[64];
+    arrtype_t t = arrtype(v->data);
+    for (size_t r = 0; r < nobs; ++r) {
+        size_t i = rows[r];
+        const char *key;
+        if (t == STRINGS_ARR) {
+            key = v->data.node->arr->strings[i];
+        } else {
+            double x = as_real(v->data, i, 0);
+            snprintf(buf, sizeof(buf), "%.15g", x);
+            key = buf;
+        }
+        v->codes[i] = _lh_get(&h, key);
+    }
+    v->nlev = h.n;
+    _mm_level *lev = chk_malloc(h.n * sizeof(_mm_level));
+    for (size_t j = 0; j < h.cap; ++j) {
+        if (!h.keys[j])
+            continue;
+        _mm_level *l = &lev[h.vals[j]];
+        l->label = h.keys[j];
+        l->num = (t == STRINGS_ARR) ? 0. : strtod(h.keys[j], NULL);
+        l->old = h.vals[j];
+    }
+    qsort(lev, h.n, sizeof(_mm_level),
+          (t == STRINGS_ARR) ? _cmp_level_str : _cmp_level_num);
+    size_t *remap = chk_malloc(h.n * sizeof(size_t));
+    v->levels = chk_malloc(h.n * sizeof(char*));
+    for (size_t k = 0; k < h.n; ++k) {
+        remap[lev[k].old] = k;
+        chk_strcpy(&v->levels[k], lev[k].label);
+    }
+    for (size_t r = 0; r < nobs; ++r)
+        v->codes[rows[r]] = remap[v->codes[rows[r]]];
+    chk_free(remap);
+    chk_free(lev);
+    _lh_free(&h);
+}
+
+#define MM_MAX_COMP 8
+typedef struct _mm_term {
+    size_t ncomp;
+    size_t var[MM_MAX_COMP];
+    char *label[MM_MAX_COMP];   // component as written, for column names
+    int full;                   // factor keeps all its levels
+    size_t ncols;
+    size_t first;               // first design column
+} _mm_term;
+
+static char *_trim(char *s) {
+    while (isspace((unsigned char)*s))
+        ++s;
+    char *e = s + strlen(s);
+    while (e > s && isspace((unsigned char)e[-1]))
+        *--e = '\0';
+    return s;
+}
+
+/*index into vars of "name" / "factor(name)", adding it if new*/
+static size_t _mm_var_ix(const data_frame *df, char *comp, _mm_var *vars, size_t *nvar) {
+    int as_factor = 0;
+    char *name = comp;
+    size_t len = strlen(comp);
+    if (strncmp(comp, "factor(", 7) == 0 && len > 8 && comp[len - 1] == ')') {
+        as_factor = 1;
+        comp[len - 1] = '\0';
+        name = _trim(comp + 7);
+    }
+    int col = df_col_ix(df, name);
+    if (col < 0) {
+        fprintf(stderr, "model_matrix: no column named '%s'\n", name);
+        exit(1);
+    }
+    if (as_factor)
+        comp[len - 1] = ')';
+    arrtype_t t = arrtype(df->cols[col]);
+    if (!is_numeric_type(t) && t != STRINGS_ARR) {
+        fprintf(stderr, "model_matrix: column '%s' has unsupported type %s\n",
+                name, arrtype_str(t));
+        exit(1);
+    }
+    int is_factor = as_factor || t == STRINGS_ARR;
+    for (size_t k = 0; k < *nvar; ++k) {
+        if (vars[k].col == col && vars[k].is_factor == is_factor)
+            return k;
+    }
+    _mm_var *v = &vars[(*nvar)++];
+    v->col = col;
+    v->is_factor = is_factor;
+    v->data = df->cols[col];
+    v->nlev = 0;
+    v->levels = NULL;
+    v->codes = NULL;
+    return *nvar - 1;
+}
+
+/*NA-marked, or NaN in a numeric column*/
+static int _mm_missing(ARRP col, size_t i) {
+    if (is_na(col, i, 0))
+        return 1;
+    return is_numeric_type(arrtype(col)) && isnan(as_real(col, i, 0));
+}
+
+/*
+    Column within the term for row i and its value; returns 0 if the whole
+    term is zero on this row (a baseline level, or a zero numeric).
+*/
+static int _mm_term_value(const _mm_term *t, const _mm_var *vars, size_t i,
+                          size_t *col, double *val) {
+    size_t c = 0, stride = 1;
+    double x = 1.;
+    for (size_t k = 0; k < t->ncomp; ++k) {
+        const _mm_var *v = &vars[t->var[k]];
+        if (v->is_factor) {
+            size_t code = v->codes[i];
+            if (!t->full) {
+                if (code == 0)
+                    return 0;
+                code -= 1;
+            }
+            c += code * stride;
+            stride *= t->full ? v->nlev : v->nlev - 1;
+        } else {
+            x *= as_real(v->data, i, 0);
+        }
+    }
+    if (x == 0.)
+        return 0;
+    *col = t->first + c;
+    *val = x;
+    return 1;
+}
+
+/*design column names, first component varying fastest*/
+static void _mm_colnames(const _mm_term *t, const _mm_var *vars, ARRP names) {
+    char buf[512];
+    for (size_t c = 0; c < t->ncols; ++c) {
+        size_t rem = c, pos = 0;
+        buf[0] = '\0';
+        for (size_t k = 0; k < t->ncomp; ++k) {
+            const _mm_var *v = &vars[t->var[k]];
+            const char *lev = "";
+            if (v->is_factor) {
+                size_t nl = t->full ? v->nlev : v->nlev - 1;
+                lev = v->levels[rem % nl + (t->full ? 0 : 1)];
+                rem /= nl;
+            }
+            int w = snprintf(buf + pos, sizeof(buf) - pos, "%s%s%s",
+                             (k > 0) ? ":" : "", t->label[k], lev);
+            pos = (w > 0 && pos + (size_t)w < sizeof(buf)) ? pos + (size_t)w : sizeof(buf) - 1;
+        }
+        set_strings_elt(names, 0, t->first + c, buf);
+    }
+}
+
+/*
+    Factor levels are found with one hashed pass over each factor column.
+    A counting pass then sizes the output (nonzeros per row: each term puts
+    at most one nonzero in a row), and a single pass over the rows writes
+    either the dense matrix or the CSR arrays directly, with no dense
+    intermediate.
+*/
+model_matrix_t model_matrix(const data_frame *df, const char *spec, mm_output_t out) {
+    size_t n = df->nrow;
+    char *buf;
+    chk_strcpy(&buf, spec);
+    char *rhs = buf, *tilde = strchr(buf, '~');
+    int ycol = -1;
+    if (tilde) {
+        *tilde = '\0';
+        rhs = tilde + 1;
+        char *lhs = _trim(buf);
+        if (*lhs) {
+            ycol = df_col_ix(df, lhs);
+            if (ycol < 0 || !is_numeric_type(arrtype(df->cols[ycol]))) {
+                fprintf(stderr, "model_matrix: no numeric response column '%s'\n", lhs);
+                exit(1);
+            }
+        }
+    }
+
+    size_t maxterms = 2;
+    for (const char *c = rhs; *c; ++c)
+        maxterms += (*c == '+' || *c == '-' || *c == ':');
+    _mm_term *terms = chk_malloc(maxterms * sizeof(_mm_term));
+    _mm_var *vars = chk_malloc(maxterms * sizeof(_mm_var));
+    size_t nterm = 0, nvar = 0;
+    int intercept = 1;
+
+    // split on '+' / '-', then each term on ':'
+    char *p = rhs;
+    int negate = 0;
+    while (p) {
+        char *next = strpbrk(p, "+-");
+        char sep = next ? *next : '\0';
+        if (next)
+            *next = '\0';
+        char *term = _trim(p);
+        if (strcmp(term, "1") == 0 || strcmp(term, "0") == 0) {
+            intercept = (strcmp(term, "1") == 0) != negate;
+        } else if (*term) {
+            if (negate) {
+                fprintf(stderr, "model_matrix: only the intercept can be removed ('-1')\n");
+                exit(1);
+            }
+            _mm_term *t = &terms[nterm++];
+            t->ncomp = 0;
+            t->full = 0;
+            char *save = NULL;
+            for (char *comp = strtok_r(term, ":", &save); comp; comp = strtok_r(NULL, ":", &save)) {
+                if (t->ncomp == MM_MAX_COMP) {
+                    fprintf(stderr, "model_matrix: at most %d-way interactions\n", MM_MAX_COMP);
+                    exit(1);
+                }
+                comp = _trim(comp);
+                t->var[t->ncomp] = _mm_var_ix(df, comp, vars, &nvar);
+                t->label[t->ncomp++] = comp;
+            }
+        }
+        negate = (sep == '-');
+        p = next ? next + 1 : NULL;
+    }
+
+    // rows with a missing value in any used column are dropped (na.omit)
+    size_t *rows = chk_malloc((n ? n : 1) * sizeof(size_t)), nobs = 0;
+    for (size_t i = 0; i < n; ++i) {
+        int miss = (ycol >= 0) && _mm_missing(df->cols[ycol], i);
+        for (size_t k = 0; k < nvar && !miss; ++k)
+            miss = _mm_missing(vars[k].data, i);
+        if (!miss)
+            rows[nobs++] = i;
+    }
+    if (nobs == 0) {
+        fprintf(stderr, "model_matrix: no rows without missing values\n");
+        exit(1);
+    }
+    for (size_t k = 0; k < nvar; ++k) {
+        if (vars[k].is_factor)
+            _mm_factor_levels(&vars[k], n, rows, nobs);
+    }
+
+    // lay out the columns
+    size_t ncol = intercept ? 1 : 0;
+    int full_used = intercept;
+    for (size_t k = 0; k < nterm; ++k) {
+        _mm_term *t = &terms[k];
+        if (!full_used && t->ncomp == 1 && vars[t->var[0]].is_factor) {
+            t->full = 1;
+            full_used = 1;
+        }
+        t->ncols = 1;
+        for (size_t c = 0; c < t->ncomp; ++c) {
+            const _mm_var *v = &vars[t->var[c]];
+            if (v->is_factor)
+                t->ncols *= t->full ? v->nlev : v->nlev - 1;
+        }
+        t->first = ncol;
+        ncol += t->ncols;
+    }
+    if (ncol == 0) {
+        fprintf(stderr, "model_matrix: formula has no columns\n");
+        exit(1);
+    }
+
+    // counting pass
+    size_t nz = intercept ? nobs : 0, col;
+    double val;
+    for (size_t r = 0; r < nobs; ++r) {
+        for (size_t k = 0; k < nterm; ++k)
+            nz += _mm_term_value(&terms[k], vars, rows[r], &col, &val);
+    }
+    int sparse = (out == MM_SPARSE) ||
+        (out == MM_AUTO && (double)nz < MM_SPARSE_DENSITY * (double)nobs * (double)ncol);
+
+    model_matrix_t mm;
+    if (sparse) {
+        mm.x = alloc_sparse(CSR_ARR, nobs, ncol, nz);
+        ArrayStruct *a = mm.x.node->arr;
+        size_t e = 0;
+        for (size_t r = 0; r < nobs; ++r) {
+            size_t i = rows[r];
+            a->ptr[r] = e;
+            if (intercept) {
+                a->idx[e] = 0;
+                a->reals[e++] = 1.;
+            }
+            for (size_t k = 0; k < nterm; ++k) {
+                if (_mm_term_value(&terms[k], vars, i, &col, &val)) {
+                    a->idx[e] = col;
+                    a->reals[e++] = val;
+                }
+            }
+        }
+        a->ptr[nobs] = e;
+    } else {
+        mm.x = alloc_array(REALS_ARR, nobs, ncol);
+        double *x = real(mm.x);
+        for (size_t r = 0; r < nobs; ++r) {
+            size_t i = rows[r];
+            double *row = x + r * ncol;
+            if (intercept)
+                row[0] = 1.;
+            for (size_t k = 0; k < nterm; ++k) {
+                if (_mm_term_value(&terms[k], vars, i, &col, &val))
+                    row[col] = val;
+            }
+        }
+    }
+
+    mm.colnames = alloc_row_array(STRINGS_ARR, ncol);
+    if (intercept)
+        set_strings_elt(mm.colnames, 0, 0, "(Intercept)");
+    for (size_t k = 0; k < nterm; ++k)
+        _mm_colnames(&terms[k], vars, mm.colnames);
+    mm.rows = alloc_array(LONGS_ARR, nobs, 1);
+    mm.y = (ycol >= 0) ? alloc_array(REALS_ARR, nobs, 1) : empty();
+    for (size_t r = 0; r < nobs; ++r) {
+        int64(mm.rows)[r] = (int64_t)rows[r];
+        if (ycol >= 0)
+            real(mm.y)[r] = as_real(df->cols[ycol], rows[r], 0);
+    }
+    chk_free(rows);
+
+    for (size_t k = 0; k < nvar; ++k) {
+        for (size_t l = 0; l < vars[k].nlev; ++l)
+            chk_free(vars[k].levels[l]);
+        chk_free(vars[k].levels);
+        chk_free(vars[k].codes);
+    }
+    chk_free(vars);
+    chk_free(terms);
+    chk_free(buf);
+    return mm;
+}
+
+void free_model_matrix(model_matrix_t *mm) {
+    free_array(&mm->x);
+    free_array(&mm->colnames);
+    free_array(&mm->rows);
+    free_array(&mm->y);
+}
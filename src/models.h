@@ -0,0 +1,120 @@
+#ifndef __MODELS_H
+#define __MODELS_H
+
+#include "array.h"
+#include "dataframe.h"
+
+
+/*
+    LINEAR MODELS
+    lm_fit solves the least squares problem min ||y - Xb|| through the
+    normal equations X'X b = X'y, factoring X'X by blocked Cholesky;
+    lm_fit_qr solves it through a Householder QR of X.
+*/
+typedef struct lm_t {
+    ARRP coef;     // p x 1 coefficients
+    ARRP se;       // p x 1 standard errors
+    double sigma;  // residual standard error
+    size_t df;     // residual degrees of freedom, n - p
+} lm_t;
+
+lm_t lm_fit(ARRP X, ARRP y);
+lm_t lm_fit_qr(ARRP X, ARRP y);
+void free_lm(lm_t *fit);
+
+/*
+    Least squares over row batches in O(p^2) memory: feed every batch to
+    lm_accum_update, then solve once with lm_accum_fit.
+*/
+typedef struct lm_accum_t {
+    size_t p;      // number of columns
+    size_t n;      // rows seen so far
+    ARRP xtx;      // p x p running X'X
+    ARRP xty;      // p x 1 running X'y
+    double yty;    // running y'y
+} lm_accum_t;
+
+lm_accum_t lm_accum_init(size_t p);
+void lm_accum_update_view(lm_accum_t *acc, ARRV X, ARRV y);
+void lm_accum_update(lm_accum_t *acc, ARRP X, ARRP y);
+void lm_accum_merge(lm_accum_t *a, const lm_accum_t *b);
+lm_t lm_accum_fit(const lm_accum_t *acc);
+void free_lm_accum(lm_accum_t *acc);
+
+
+/*
+    GENERALIZED LINEAR MODELS
+    glm_fit fits by iteratively reweighted least squares. glm_fit_work does
+    the same with a caller-owned workspace from glm_work_alloc(n, p), which
+    can be reused across fits of the same shape.
+*/
+typedef enum {
+    GAUSSIAN_FAMILY = 0,
+    BINOMIAL_FAMILY,
+    POISSON_FAMILY
+} glm_family_t;
+
+typedef struct glm_t {
+    ARRP coef;        // p x 1 coefficients
+    ARRP se;          // p x 1 standard errors
+    double deviance;  // residual deviance
+    size_t df;        // residual degrees of freedom, n - p
+    int iter;         // IRLS iterations used
+    int converged;
+} glm_t;
+
+typedef struct glm_work_t {
+    size_t n, p;
+    ARRP eta;   // n x 1 linear predictor
+    ARRP mu;    // n x 1 fitted means
+    ARRP w;     // n x 1 square-root working weights
+    ARRP wz;    // n x 1 weighted working response
+    ARRP wx;    // n x p weighted design (column-major)
+    ARRP xtwx;  // p x p X'WX, then its Cholesky factor
+    ARRP coef;  // p x 1 current coefficients
+} glm_work_t;
+
+glm_work_t glm_work_alloc(size_t n, size_t p);
+void free_glm_work(glm_work_t *w);
+glm_t glm_fit_work(ARRP X, ARRP y, glm_family_t family, glm_work_t *work);
+glm_t glm_fit(ARRP X, ARRP y, glm_family_t family);
+void free_glm(glm_t *fit);
+
+
+/*
+    MODEL MATRICES
+    Design matrix for the right-hand side of an R-style formula over a data
+    frame, e.g. "age + factor(race) + smoke + smoke:factor(race)":
+    - terms are joined by '+'; "-1" or "0" drops the intercept
+    - numeric (INTS_ARR / REALS_ARR) columns enter as they are
+    - STRINGS_ARR columns, and factor(col) for numeric codes, are dummy
+      coded against their first (sorted) level; without an intercept the
+      first factor term keeps every level
+    - a:b is the product of the columns of a and b
+    - a response before '~' is returned as y, aligned with the design
+    Rows with a missing value (NA or NaN) in any column the formula uses
+    are dropped, as R's na.omit; rows holds the data frame row of each
+    design row.
+    Output is CSR_ARR when MM_SPARSE is asked for, or for MM_AUTO when the
+    share of nonzeros is below MM_SPARSE_DENSITY; REALS_ARR otherwise.
+*/
+typedef enum {
+    MM_AUTO = 0,
+    MM_DENSE,
+    MM_SPARSE
+} mm_output_t;
+
+#define MM_SPARSE_DENSITY 0.1
+
+typedef struct model_matrix_t {
+    ARRP x;          // n x p design
+    ARRP colnames;   // 1 x p STRINGS_ARR
+    ARRP rows;       // n x 1 LONGS_ARR, 0-based data frame rows
+    ARRP y;          // n x 1 REALS_ARR response, empty without one
+} model_matrix_t;
+
+model_matrix_t model_matrix(const data_frame *df, const char *spec, mm_output_t out);
+void free_model_matrix(model_matrix_t *mm);
+
+
+#endif // __MODELS_H
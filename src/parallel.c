@@ -0,0 +1,58 @@
+#include "parallel.h"
+#include "global.h"
+
+#include <stdio.h>
+#include <pthread.h>
+
+
+
+/*threads worth using for n work items: at most one per item*/
+int parallel_nthreads(size_t n) {
+    size_t nt = (size_t)get_num_threads();
+    if (nt > MAX_THREADS)
+        nt = MAX_THREADS;
+    if (nt > n)
+        nt = n;
+    return (nt > 0) ? (int)nt : 1;
+}
+
+
+typedef struct _chunk {
+    parallel_fn fn;
+    void *arg;
+    size_t start;
+    size_t end;
+    int tid;
+} _chunk;
+
+static void *_run_chunk(void *p) {
+    _chunk *c = (_chunk*)p;
+    c->fn(c->arg, c->start, c->end, c->tid);
+    return NULL;
+}
+
+/*chunk 0 runs on the calling thread*/
+void parallel_for(size_t n, int nthreads, parallel_fn fn, void *arg) {
+    if (nthreads < 1 || nthreads > MAX_THREADS) {
+        fprintf(stderr, "parallel_for: nthreads must be in [1, %d]\n", MAX_THREADS);
+        exit(1);
+    }
+    _chunk chunks[MAX_THREADS];
+    pthread_t threads[MAX_THREADS];
+    for (int t = 0; t < nthreads; ++t) {
+        chunks[t].fn = fn;
+        chunks[t].arg = arg;
+        chunks[t].start = t * n / nthreads;
+        chunks[t].end = (t + 1) * n / nthreads;
+        chunks[t].tid = t;
+    }
+    for (int t = 1; t < nthreads; ++t) {
+        if (pthread_create(&threads[t], NULL, _run_chunk, &chunks[t])) {
+            fprintf(stderr, "parallel_for: failed to create thread\n");
+            exit(1);
+        }
+    }
+    _run_chunk(&chunks[0]);
+    for (int t = 1; t < nthreads; ++t)
+        pthread_join(threads[t], NULL);
+}
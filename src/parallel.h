@@ -0,0 +1,23 @@
+#ifndef __PARALLEL_H
+#define __PARALLEL_H
+
+#include <stdlib.h> // size_t
+
+
+/*
+    PARALLEL LOOPS
+    fn(arg, start, end, tid) is called on nthreads contiguous chunks of
+    [0, n); chunk tid is [tid * n / nthreads, (tid + 1) * n / nthreads).
+    The memstack is not thread safe: workers must not allocate arrays or
+    call chk_malloc, so allocate per-thread scratch before the loop.
+    At most MAX_THREADS threads are used.
+*/
+#define MAX_THREADS 256
+
+typedef void (*parallel_fn)(void *arg, size_t start, size_t end, int tid);
+
+int parallel_nthreads(size_t n);
+void parallel_for(size_t n, int nthreads, parallel_fn fn, void *arg);
+
+
+#endif // __PARALLEL_H
@@ -0,0 +1,312 @@
+/*
+    Non-uniform random deviates
+*/
+
+#include <math.h>
+#include <stdint.h>
+#include "rand/dist.h"
+
+
+/*uniform on the open interval (0, 1), safe to take logs of*/
+double genUnifOpen(MTRand *rand) {
+    return ((double)genRandLong(rand) + 0.5) * 0x1p-32;
+}
+
+
+/*unbiased integer in [0, m): Lemire's multiply-shift below 2^32, masked rejection above*/
+uint64_t genRandBelow(MTRand *rand, uint64_t m) {
+    if (m <= 1)
+        return 0;
+    if (m <= 0xffffffff) {
+        uint64_t x = (uint64_t)genRandLong(rand) * m;
+        uint32_t l = (uint32_t)x;
+        if (l < m) {
+            uint32_t t = (uint32_t)(-(uint32_t)m) % (uint32_t)m;
+            while (l < t) {
+                x = (uint64_t)genRandLong(rand) * m;
+                l = (uint32_t)x;
+            }
+        }
+        return x >> 32;
+    }
+    uint64_t mask = ~(uint64_t)0 >> __builtin_clzll(m - 1);
+    for (;;) {
+        uint64_t x = ((uint64_t)genRandLong(rand) << 32) | genRandLong(rand);
+        if ((x & mask) < m)
+            return x & mask;
+    }
+}
+
+/*
+    ZIGGURATS
+    128 layers for the normal, 256 for the exponential. The layer index
+    comes from a second word so it is independent of the abscissa (the
+    original algorithm reused the low bits of one word).
+*/
+#define ZIG_NORM_R 3.442619855899
+#define ZIG_NORM_V 9.91256303526217e-3
+#define ZIG_EXP_R 7.697117470131487
+#define ZIG_EXP_V 3.949659822581572e-3
+
+static uint32_t kn[128], ke[256];
+static double wn[128], fn[128], we[256], fe[256];
+static int zig_ready = 0;
+
+static void _zig_init(void) {
+    const double m1 = 2147483648.0, m2 = 4294967296.0;
+    double dn = ZIG_NORM_R, tn = dn, vn = ZIG_NORM_V;
+    double q = vn / exp(-.5 * dn * dn);
+    kn[0] = (uint32_t)((dn / q) * m1);
+    kn[1] = 0;
+    wn[0] = q / m1;
+    wn[127] = dn / m1;
+    fn[0] = 1.;
+    fn[127] = exp(-.5 * dn * dn);
+    for (int i = 126; i >= 1; --i) {
+        dn = sqrt(-2. * log(vn / dn + exp(-.5 * dn * dn)));
+        kn[i + 1] = (uint32_t)((dn / tn) * m1);
+        tn = dn;
+        fn[i] = exp(-.5 * dn * dn);
+        wn[i] = dn / m1;
+    }
+    double de = ZIG_EXP_R, te = de, ve = ZIG_EXP_V;
+    q = ve / exp(-de);
+    ke[0] = (uint32_t)((de / q) * m2);
+    ke[1] = 0;
+    we[0] = q / m2;
+    we[255] = de / m2;
+    fe[0] = 1.;
+    fe[255] = exp(-de);
+    for (int i = 254; i >= 1; --i) {
+        de = -log(ve / de + exp(-de));
+        ke[i + 1] = (uint32_t)((de / te) * m2);
+        te = de;
+        fe[i] = exp(-de);
+        we[i] = de / m2;
+    }
+    zig_ready = 1;
+}
+
+double genNorm(MTRand *rand) {
+    if (!zig_ready)
+        _zig_init();
+    for (;;) {
+        int32_t hz = (int32_t)genRandLong(rand);
+        uint32_t iz = genRandLong(rand) & 127;
+        uint32_t ahz = (hz < 0) ? -(uint32_t)hz : (uint32_t)hz;
+        double x = hz * wn[iz];
+        if (ahz < kn[iz])
+            return x;
+        if (iz == 0) {
+            // tail beyond r
+            double xt, y;
+            do {
+                xt = -log(genUnifOpen(rand)) / ZIG_NORM_R;
+                y = -log(genUnifOpen(rand));
+            } while (y + y < xt * xt);
+            return (hz > 0) ? ZIG_NORM_R + xt : -ZIG_NORM_R - xt;
+        }
+        if (fn[iz] + genUnifOpen(rand) * (fn[iz - 1] - fn[iz]) < exp(-.5 * x * x))
+            return x;
+    }
+}
+
+double genExp(MTRand *rand) {
+    if (!zig_ready)
+        _zig_init();
+    for (;;) {
+        uint32_t jz = genRandLong(rand);
+        uint32_t iz = genRandLong(rand) & 255;
+        double x = jz * we[iz];
+        if (jz < ke[iz])
+            return x;
+        if (iz == 0)
+            return ZIG_EXP_R - log(genUnifOpen(rand));
+        if (fe[iz] + genUnifOpen(rand) * (fe[iz - 1] - fe[iz]) < exp(-x))
+            return x;
+    }
+}
+
+
+/*unit-scale gamma; shape < 1 is boosted through G(a) = G(a + 1) U^(1/a)*/
+double genGamma(MTRand *rand, double shape) {
+    if (shape < 1.) {
+        double u = genUnifOpen(rand);
+        return genGamma(rand, shape + 1.) * pow(u, 1. / shape);
+    }
+    double d = shape - 1. / 3., c = 1. / sqrt(9. * d);
+    for (;;) {
+        double x, v;
+        do {
+            x = genNorm(rand);
+            v = 1. + c * x;
+        } while (v <= 0.);
+        v = v * v * v;
+        double u = genUnifOpen(rand);
+        if (u < 1. - 0.0331 * (x * x) * (x * x))
+            return d * v;
+        if (log(u) < 0.5 * x * x + d * (1. - v + log(v)))
+            return d * v;
+    }
+}
+
+
+/*
+    BINOMIAL
+    Inversion by sequential search while n * min(p, 1 - p) < 30, BTPE
+    (triangle / parallelogram / exponential-tail majorizer with squeeze)
+    above. Both draw with p <= 1/2 and reflect.
+*/
+static int _binom_inversion(MTRand *rand, int n, double r) {
+    double q = 1. - r, np = n * r;
+    double qn = exp(n * log(q));
+    double bound = fmin((double)n, np + 10. * sqrt(np * q + 1.));
+    int x = 0;
+    double px = qn, u = genUnifOpen(rand);
+    while (u > px) {
+        ++x;
+        if (x > bound) {
+            x = 0;
+            px = qn;
+            u = genUnifOpen(rand);
+        } else {
+            u -= px;
+            px = ((n - x + 1) * r * px) / (x * q);
+        }
+    }
+    return x;
+}
+
+/*
+    log x! - Stirling's approximation of it: the series
+    1/(12x) - 1/(360x^3) + 1/(1260x^5) - ..., over a common denominator
+*/
+static double _stirling_tail(double x) {
+    double x2 = x * x;
+    return (13860. - (462. - (132. - (99. - 140. / x2) / x2) / x2) / x2) / x / 166320.;
+}
+
+/*
+    log f(y) / f(m) for the binomial(n, r) pmf f and its mode
+    m = floor((n + 1) r), as in BTPE's final acceptance test: the
+    corrections of m! and (n - m)! are added, those of y! and (n - y)!
+    subtracted.
+*/
+double binomLogRatio(int n, double r, int y) {
+    double q = 1. - r, m = floor(n * r + r), xm = m + 0.5;
+    double x1 = y + 1., f1 = m + 1., z = n + 1. - m, w = n - y + 1.;
+    return xm * log(f1 / x1) + (n - m + 0.5) * log(z / w)
+           + (y - m) * log(w * r / (x1 * q))
+           + _stirling_tail(f1) + _stirling_tail(z)
+           - _stirling_tail(x1) - _stirling_tail(w);
+}
+
+static int _binom_btpe(MTRand *rand, int n, double r) {
+    double q = 1. - r, nrq = n * r * q;
+    double fm = n * r + r;
+    double m = floor(fm);
+    double p1 = floor(2.195 * sqrt(nrq) - 4.6 * q) + 0.5;
+    double xm = m + 0.5, xl = xm - p1, xr = xm + p1;
+    double c = 0.134 + 20.5 / (15.3 + m);
+    double a = (fm - xl) / (fm - xl * r);
+    double laml = a * (1. + a / 2.);
+    a = (xr - fm) / (xr * q);
+    double lamr = a * (1. + a / 2.);
+    double p2 = p1 * (1. + 2. * c), p3 = p2 + c / laml, p4 = p3 + c / lamr;
+    for (;;) {
+        double u = genUnifOpen(rand) * p4, v = genUnifOpen(rand), y;
+        if (u <= p1) {
+            // triangular centre: accepted outright
+            return (int)floor(xm - p1 * v + u);
+        } else if (u <= p2) {
+            double x = xl + (u - p1) / c;
+            v = v * c + 1. - fabs(m - x + 0.5) / p1;
+            if (v > 1.)
+                continue;
+            y = floor(x);
+        } else if (u <= p3) {
+            y = floor(xl + log(v) / laml);
+            if (y < 0.)
+                continue;
+            v = v * (u - p2) * laml;
+        } else {
+            y = floor(xr - log(v) / lamr);
+            if (y > n)
+                continue;
+            v = v * (u - p3) * lamr;
+        }
+        double k = fabs(y - m);
+        if (k <= 20. || k >= nrq / 2. - 1.) {
+            // explicit ratio f(y) / f(m)
+            double s = r / q, aa = s * (n + 1.), f = 1.;
+            if (m < y) {
+                for (double i = m + 1.; i <= y; ++i)
+                    f *= (aa / i - s);
+            } else if (m > y) {
+                for (double i = y + 1.; i <= m; ++i)
+                    f /= (aa / i - s);
+            }
+            if (v <= f)
+                return (int)y;
+            continue;
+        }
+        // squeeze on log f(y) / f(m), then the Stirling bound
+        double rho = (k / nrq) * ((k * (k / 3. + 0.625) + 1. / 6.) / nrq + 0.5);
+        double t = -k * k / (2. * nrq);
+        double lv = log(v);
+        if (lv < t - rho)
+            return (int)y;
+        if (lv > t + rho)
+            continue;
+        if (lv <= binomLogRatio(n, r, (int)y))
+            return (int)y;
+    }
+}
+
+int genBinom(MTRand *rand, int n, double p) {
+    if (n <= 0 || p <= 0.)
+        return 0;
+    if (p >= 1.)
+        return n;
+    double r = (p <= 0.5) ? p : 1. - p;
+    int x = (n * r < 30.) ? _binom_inversion(rand, n, r) : _binom_btpe(rand, n, r);
+    return (p <= 0.5) ? x : n - x;
+}
+
+
+/*
+    POISSON
+    Multiplication of uniforms for lambda < 10, PTRS (transformed
+    rejection with squeeze) above.
+*/
+int genPois(MTRand *rand, double lambda) {
+    if (lambda <= 0.)
+        return 0;
+    if (lambda < 10.) {
+        double enlam = exp(-lambda), prod = genUnifOpen(rand);
+        int x = 0;
+        while (prod > enlam) {
+            prod *= genUnifOpen(rand);
+            ++x;
+        }
+        return x;
+    }
+    double slam = sqrt(lambda), loglam = log(lambda);
+    double b = 0.931 + 2.53 * slam;
+    double a = -0.059 + 0.02483 * b;
+    double invalpha = 1.1239 + 1.1328 / (b - 3.4);
+    double vr = 0.9277 - 3.6224 / (b - 2.);
+    for (;;) {
+        double u = genUnifOpen(rand) - 0.5;
+        double v = genUnifOpen(rand);
+        double us = 0.5 - fabs(u);
+        double k = floor((2. * a / us + b) * u + lambda + 0.43);
+        if (us >= 0.07 && v <= vr)
+            return (int)k;
+        if (k < 0. || (us < 0.013 && v > us))
+            continue;
+        if (log(v) + log(invalpha) - log(a / (us * us) + b)
+                <= -lambda + k * loglam - lgamma(k + 1.))
+            return (int)k;
+    }
+}
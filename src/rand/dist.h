@@ -0,0 +1,27 @@
+#ifndef __DIST_H
+#define __DIST_H
+
+#include <stdint.h>
+#include "rand/rng.h"
+
+/*
+    NON-UNIFORM DEVIATES
+    Drawn from a Mersenne Twister stream. The normal and exponential use
+    Ziggurats (Marsaglia & Tsang 2000) whose fast path is one table
+    compare per draw; gamma is Marsaglia-Tsang (2000), binomial is BTPE
+    (Kachitvichyanukul & Schmeiser 1988) and Poisson is PTRS (Hormann
+    1993), with inversion for small means. The Ziggurat tables are built
+    on first use, so make one call from the main thread before drawing
+    from several threads. binomLogRatio is the pmf ratio behind BTPE's
+    final acceptance test.
+*/
+double genUnifOpen(MTRand *rand);
+uint64_t genRandBelow(MTRand *rand, uint64_t m);
+double genNorm(MTRand *rand);
+double genExp(MTRand *rand);
+double genGamma(MTRand *rand, double shape);
+int genBinom(MTRand *rand, int n, double p);
+double binomLogRatio(int n, double r, int y);
+int genPois(MTRand *rand, double lambda);
+
+#endif // __DIST_H
@@ -0,0 +1,92 @@
+/*
+    Philox4x32-10 counter-based random number generation
+*/
+
+#include "rand/philox.h"
+
+
+#define PHILOX_M0 0xD2511F53
+#define PHILOX_M1 0xCD9E8D57
+#define PHILOX_W0 0x9E3779B9
+#define PHILOX_W1 0xBB67AE85
+#define PHILOX_ROUNDS 10
+
+
+/*the 10-round bijection: out = f_key(ctr)*/
+void philox4x32_10(const uint32_t ctr[4], const uint32_t key[2], uint32_t out[4]) {
+    uint32_t c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+    uint32_t k0 = key[0], k1 = key[1];
+    for (int r = 0; r < PHILOX_ROUNDS; ++r) {
+        uint64_t p0 = (uint64_t)PHILOX_M0 * c0;
+        uint64_t p1 = (uint64_t)PHILOX_M1 * c2;
+        uint32_t n0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+        uint32_t n2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+        c0 = n0;
+        c1 = (uint32_t)p1;
+        c2 = n2;
+        c3 = (uint32_t)p0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    out[0] = c0; out[1] = c1; out[2] = c2; out[3] = c3;
+}
+
+static inline void _philox_block(const uint32_t key[2], uint64_t i, uint32_t out[4]) {
+    uint32_t ctr[4] = {(uint32_t)i, (uint32_t)(i >> 32), 0, 0};
+    philox4x32_10(ctr, key, out);
+}
+
+/*53-bit double in [0, 1)*/
+static inline double _philox_double(uint32_t hi, uint32_t lo) {
+    return (double)(((uint64_t)hi << 21) ^ (lo >> 11)) * 0x1p-53;
+}
+
+
+PhiloxRand seedPhilox(uint32_t seed, uint32_t stream) {
+    PhiloxRand rand = {{seed, stream}, 0, {0, 0, 0, 0}, 4};
+    return rand;
+}
+
+/*position the stream so the next double is element i*/
+void philoxSeek(PhiloxRand *rand, uint64_t i) {
+    rand->ctr = i / 2;
+    rand->index = 4;
+    if (i % 2) {
+        _philox_block(rand->key, rand->ctr++, rand->buf);
+        rand->index = 2;
+    }
+}
+
+uint32_t philoxRandLong(PhiloxRand *rand) {
+    if (rand->index >= 4) {
+        _philox_block(rand->key, rand->ctr++, rand->buf);
+        rand->index = 0;
+    }
+    return rand->buf[rand->index++];
+}
+
+/*double in [0, 1); an odd word left over from philoxRandLong is skipped*/
+double philoxRand(PhiloxRand *rand) {
+    if (rand->index % 2)
+        rand->index++;
+    uint32_t hi = philoxRandLong(rand);
+    uint32_t lo = philoxRandLong(rand);
+    return _philox_double(hi, lo);
+}
+
+/*the next n doubles; whole blocks go straight to out*/
+void philoxRands(PhiloxRand *rand, double *out, size_t n) {
+    size_t i = 0;
+    if (rand->index % 2)
+        rand->index++;
+    for (; i < n && rand->index < 4; ++i)
+        out[i] = philoxRand(rand);
+    uint32_t b[4];
+    for (; i + 2 <= n; i += 2) {
+        _philox_block(rand->key, rand->ctr++, b);
+        out[i] = _philox_double(b[0], b[1]);
+        out[i + 1] = _philox_double(b[2], b[3]);
+    }
+    if (i < n)
+        out[i] = philoxRand(rand);
+}
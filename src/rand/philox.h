@@ -0,0 +1,32 @@
+#ifndef __PHILOX_H
+#define __PHILOX_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+    PHILOX
+    Counter-based generator (Philox4x32-10, Salmon et al. 2011): output
+    block i is a pure function of (key, i), so any element of a stream
+    can be computed directly and a fill split over threads gives the
+    same values as a sequential one. The key is (seed, stream); distinct
+    streams of one seed are independent.
+    Doubles take 53 bits from two 32-bit words, so element i of a stream
+    is word pair i % 2 of block i / 2.
+*/
+typedef struct PhiloxRand {
+    uint32_t key[2];
+    uint64_t ctr;       // next block
+    uint32_t buf[4];    // current block
+    int index;          // next unused word of buf, 4 when empty
+} PhiloxRand;
+
+void philox4x32_10(const uint32_t ctr[4], const uint32_t key[2], uint32_t out[4]);
+
+PhiloxRand seedPhilox(uint32_t seed, uint32_t stream);
+void philoxSeek(PhiloxRand *rand, uint64_t i);
+uint32_t philoxRandLong(PhiloxRand *rand);
+double philoxRand(PhiloxRand *rand);
+void philoxRands(PhiloxRand *rand, double *out, size_t n);
+
+#endif // __PHILOX_H
@@ -3,6 +3,10 @@
 */
 
 #include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "rand/rng.h"
 
 
@@ -21,6 +25,7 @@
 #define LOWER_MASK		0x7fffffff
 #define TEMPERING_MASK_B	0x9d2c5680
 #define TEMPERING_MASK_C	0xefc60000
+#define MATRIX_A		0x9908b0df
 
 
 inline static void m_seedRand(MTRand* rand, uint32_t seed) {
@@ -44,31 +49,29 @@ MTRand seedRand(uint32_t seed) {
 }
 
 /**
- * Generates a pseudo-randomly generated long.
+ * Regenerates the STATE_VECTOR_LENGTH words of the state. The twist is
+ * written without the mag[] lookup so that each of the three loops is a
+ * straight-line recurrence at a fixed distance, which the compiler
+ * vectorizes.
  */
-uint32_t genRandLong(MTRand* rand) {
-
+static void m_twist(MTRand* rand) {
+  uint32_t *mt = rand->mt;
   uint32_t y;
-  static uint32_t mag[2] = {0x0, 0x9908b0df}; /* mag[x] = x * 0x9908b0df for x = 0,1 */
-  if(rand->index >= STATE_VECTOR_LENGTH || rand->index < 0) {
-    /* generate STATE_VECTOR_LENGTH words at a time */
-    int32_t kk;
-    if(rand->index >= STATE_VECTOR_LENGTH+1 || rand->index < 0) {
-      m_seedRand(rand, 4357);
-    }
-    for(kk=0; kk<STATE_VECTOR_LENGTH-STATE_VECTOR_M; kk++) {
-      y = (rand->mt[kk] & UPPER_MASK) | (rand->mt[kk+1] & LOWER_MASK);
-      rand->mt[kk] = rand->mt[kk+STATE_VECTOR_M] ^ (y >> 1) ^ mag[y & 0x1];
-    }
-    for(; kk<STATE_VECTOR_LENGTH-1; kk++) {
-      y = (rand->mt[kk] & UPPER_MASK) | (rand->mt[kk+1] & LOWER_MASK);
-      rand->mt[kk] = rand->mt[kk+(STATE_VECTOR_M-STATE_VECTOR_LENGTH)] ^ (y >> 1) ^ mag[y & 0x1];
-    }
-    y = (rand->mt[STATE_VECTOR_LENGTH-1] & UPPER_MASK) | (rand->mt[0] & LOWER_MASK);
-    rand->mt[STATE_VECTOR_LENGTH-1] = rand->mt[STATE_VECTOR_M-1] ^ (y >> 1) ^ mag[y & 0x1];
-    rand->index = 0;
+  int32_t kk;
+  for(kk=0; kk<STATE_VECTOR_LENGTH-STATE_VECTOR_M; kk++) {
+    y = (mt[kk] & UPPER_MASK) | (mt[kk+1] & LOWER_MASK);
+    mt[kk] = mt[kk+STATE_VECTOR_M] ^ (y >> 1) ^ (-(y & 0x1) & MATRIX_A);
+  }
+  for(; kk<STATE_VECTOR_LENGTH-1; kk++) {
+    y = (mt[kk] & UPPER_MASK) | (mt[kk+1] & LOWER_MASK);
+    mt[kk] = mt[kk+(STATE_VECTOR_M-STATE_VECTOR_LENGTH)] ^ (y >> 1) ^ (-(y & 0x1) & MATRIX_A);
   }
-  y = rand->mt[rand->index++];
+  y = (mt[STATE_VECTOR_LENGTH-1] & UPPER_MASK) | (mt[0] & LOWER_MASK);
+  mt[STATE_VECTOR_LENGTH-1] = mt[STATE_VECTOR_M-1] ^ (y >> 1) ^ (-(y & 0x1) & MATRIX_A);
+  rand->index = 0;
+}
+
+inline static uint32_t m_temper(uint32_t y) {
   y ^= (y >> 11);
   y ^= (y << 7) & TEMPERING_MASK_B;
   y ^= (y << 15) & TEMPERING_MASK_C;
@@ -76,6 +79,23 @@ uint32_t genRandLong(MTRand* rand) {
   return y;
 }
 
+inline static void m_refill(MTRand* rand) {
+  if(rand->index >= STATE_VECTOR_LENGTH+1 || rand->index < 0) {
+    m_seedRand(rand, 4357);
+  }
+  m_twist(rand);
+}
+
+/**
+ * Generates a pseudo-randomly generated long.
+ */
+uint32_t genRandLong(MTRand* rand) {
+  if(rand->index >= STATE_VECTOR_LENGTH || rand->index < 0) {
+    m_refill(rand);
+  }
+  return m_temper(rand->mt[rand->index++]);
+}
+
 /**
  * Generates a pseudo-randomly generated double in the range [0..1].
  */
@@ -83,5 +103,227 @@ double genRand(MTRand* rand) {
   return((double)genRandLong(rand) / (uint32_t)0xffffffff);
 }
 
+/**
+ * Fills out[0..n) with the next n longs, a whole state vector at a time.
+ * The output is the same sequence n calls to genRandLong would give.
+ */
+void genRandLongs(MTRand* rand, uint32_t* out, size_t n) {
+  size_t i = 0;
+  while(i < n) {
+    if(rand->index >= STATE_VECTOR_LENGTH || rand->index < 0) {
+      m_refill(rand);
+    }
+    size_t m = STATE_VECTOR_LENGTH - rand->index;
+    if(m > n - i) m = n - i;
+    const uint32_t *mt = rand->mt + rand->index;
+    for(size_t k=0; k<m; k++) {
+      out[i+k] = m_temper(mt[k]);
+    }
+    rand->index += (int32_t)m;
+    i += m;
+  }
+}
+
+/**
+ * Fills out[0..n) with the next n doubles in [0..1], matching n calls to
+ * genRand.
+ */
+void genRands(MTRand* rand, double* out, size_t n) {
+  size_t i = 0;
+  while(i < n) {
+    if(rand->index >= STATE_VECTOR_LENGTH || rand->index < 0) {
+      m_refill(rand);
+    }
+    size_t m = STATE_VECTOR_LENGTH - rand->index;
+    if(m > n - i) m = n - i;
+    const uint32_t *mt = rand->mt + rand->index;
+    for(size_t k=0; k<m; k++) {
+      out[i+k] = (double)m_temper(mt[k]) / (uint32_t)0xffffffff;
+    }
+    rand->index += (int32_t)m;
+    i += m;
+  }
+}
+
+
+/*
+ * JUMP AHEAD
+ * The twist is linear over GF(2), so advancing by J words is the
+ * polynomial x^J reduced modulo the characteristic polynomial phi of the
+ * recurrence, evaluated at the one-step map (Haramoto et al., "Efficient
+ * jump ahead for F2-linear random number generators", 2008). phi is found
+ * once by Berlekamp-Massey on the generator's own output bits.
+ *
+ * In sequence form the state at position m is the window x_m..x_{m+623}
+ * of untwisted words, only the top bit of x_m being significant; an
+ * MTRand holds the window of its current batch in mt[] and the offset of
+ * the next output in index.
+ */
+#define MT_DEGREE 19937
+#define POLY_WORDS ((MT_DEGREE + 64) / 64)
+
+static uint64_t mt_phi[POLY_WORDS];  /* coefficient i in bit i, degree MT_DEGREE */
+static int mt_phi_ready = 0;
+
+inline static int m_bit(const uint64_t* p, size_t i) {
+  return (p[i / 64] >> (i % 64)) & 1;
+}
+
+/* 64 bits of p starting at bit i (bits past nbits read as 0) */
+inline static uint64_t m_bits64(const uint64_t* p, size_t i, size_t nwords) {
+  size_t w = i / 64, s = i % 64;
+  uint64_t lo = (w < nwords) ? p[w] >> s : 0;
+  uint64_t hi = (s && w + 1 < nwords) ? p[w + 1] << (64 - s) : 0;
+  return lo | hi;
+}
+
+/* dst ^= src << shift, for src of srcwords words */
+static void m_xor_shifted(uint64_t* dst, size_t dstwords, const uint64_t* src,
+                          size_t srcwords, size_t shift) {
+  size_t w = shift / 64, s = shift % 64;
+  for(size_t k=0; k<srcwords && k + w < dstwords; k++) {
+    dst[k + w] ^= src[k] << s;
+    if(s && k + w + 1 < dstwords) dst[k + w + 1] ^= src[k] >> (64 - s);
+  }
+}
+
+/* one step of the recurrence on a ring window starting at *head */
+inline static void m_step(uint32_t* w, int* head) {
+  int h = *head;
+  uint32_t y = (w[h] & UPPER_MASK) | (w[(h + 1) % STATE_VECTOR_LENGTH] & LOWER_MASK);
+  w[h] = w[(h + STATE_VECTOR_M) % STATE_VECTOR_LENGTH] ^ (y >> 1) ^ (-(y & 0x1) & MATRIX_A);
+  *head = (h + 1) % STATE_VECTOR_LENGTH;
+}
+
+static void m_init_phi(void) {
+  enum { N = 2 * MT_DEGREE, NW = (N + 63) / 64 };
+  static uint64_t rev[NW], c[NW], b[NW], t[NW];
+  /* top bits of the sequence, stored reversed: bit N-1-n holds s_n */
+  MTRand r = seedRand(5489);
+  int head = 0;
+  for(int n=0; n<N; n++) {
+    m_step(r.mt, &head);
+    uint32_t x = r.mt[(head + STATE_VECTOR_LENGTH - 1) % STATE_VECTOR_LENGTH];
+    if(x >> 31) rev[(N - 1 - n) / 64] |= (uint64_t)1 << ((N - 1 - n) % 64);
+  }
+  /* Berlekamp-Massey over GF(2): sum_{i<=L} c_i s_{n-i} = 0 */
+  c[0] = b[0] = 1;
+  size_t L = 0, m = 1;
+  for(size_t n=0; n<N; n++) {
+    uint64_t d = 0;
+    for(size_t i=0; i<=L; i+=64)
+      d ^= c[i / 64] & m_bits64(rev, N - 1 - n + i, NW);
+    if(!__builtin_parityll(d)) {
+      m++;
+    } else if(2 * L <= n) {
+      memcpy(t, c, sizeof(c));
+      m_xor_shifted(c, NW, b, NW - m / 64, m);
+      L = n + 1 - L;
+      memcpy(b, t, sizeof(c));
+      m = 1;
+    } else {
+      m_xor_shifted(c, NW, b, NW - m / 64, m);
+      m++;
+    }
+  }
+  if(L != MT_DEGREE) {
+    fprintf(stderr, "jumpRand: unexpected recurrence degree %zu\n", L);
+    exit(1);
+  }
+  /* phi is the reciprocal of the connection polynomial */
+  for(size_t i=0; i<=L; i++) {
+    if(m_bit(c, i)) mt_phi[(L - i) / 64] |= (uint64_t)1 << ((L - i) % 64);
+  }
+  mt_phi_ready = 1;
+}
+
+/* p <- p^2 mod phi */
+static void m_sqr_mod(uint64_t* p) {
+  uint64_t sq[2 * POLY_WORDS] = {0};
+  for(size_t i=0; i<(size_t)MT_DEGREE; i++) {
+    if(m_bit(p, i)) sq[(2 * i) / 64] |= (uint64_t)1 << ((2 * i) % 64);
+  }
+  for(size_t i=2 * (MT_DEGREE - 1); i>=MT_DEGREE; i--) {
+    if(m_bit(sq, i)) m_xor_shifted(sq, 2 * POLY_WORDS, mt_phi, POLY_WORDS, i - MT_DEGREE);
+  }
+  memcpy(p, sq, POLY_WORDS * sizeof(uint64_t));
+}
+
+/* p <- x p mod phi */
+static void m_shift_mod(uint64_t* p) {
+  for(size_t k=POLY_WORDS - 1; k>0; k--)
+    p[k] = (p[k] << 1) | (p[k - 1] >> 63);
+  p[0] <<= 1;
+  if(m_bit(p, MT_DEGREE))
+    for(size_t k=0; k<POLY_WORDS; k++) p[k] ^= mt_phi[k];
+}
+
+/* window mt advanced by the polynomial p, by Horner's rule */
+static void m_apply_poly(uint32_t* mt, const uint64_t* p) {
+  uint32_t r[STATE_VECTOR_LENGTH] = {0};
+  int head = 0;
+  for(size_t i=MT_DEGREE; i-->0; ) {
+    m_step(r, &head);
+    if(m_bit(p, i)) {
+      for(int j=0; j<STATE_VECTOR_LENGTH; j++)
+        r[(head + j) % STATE_VECTOR_LENGTH] ^= mt[j];
+    }
+  }
+  for(int j=0; j<STATE_VECTOR_LENGTH; j++)
+    mt[j] = r[(head + j) % STATE_VECTOR_LENGTH];
+}
+
+/**
+ * Builds the jump tables. jumpRand does this on first use; call it from
+ * the main thread before jumping generators from several threads.
+ */
+void initJumpRand(void) {
+  if(!mt_phi_ready) m_init_phi();
+}
 
+/**
+ * Advances the generator by n outputs, as if genRandLong had been called
+ * n times, in O(log n) polynomial squarings instead of n steps.
+ */
+void jumpRand(MTRand* rand, uint64_t n) {
+  if(rand->index >= STATE_VECTOR_LENGTH+1 || rand->index < 0) {
+    m_seedRand(rand, 4357);
+  }
+  uint64_t t = (uint64_t)rand->index + n;
+  uint64_t q = t / STATE_VECTOR_LENGTH;
+  if(n < JUMP_MIN) {
+    /* below ~2^27 outputs, twisting whole batches is cheaper */
+    for(; t > STATE_VECTOR_LENGTH; t -= STATE_VECTOR_LENGTH) m_twist(rand);
+    rand->index = (int32_t)t;
+    return;
+  }
+  initJumpRand();
+  /* move the batch window from position b to b' - 1, b' = b + 624 q, then
+   * take one more step so every word of the new batch is exact */
+  uint64_t j = STATE_VECTOR_LENGTH * q - 1;
+  uint64_t p[POLY_WORDS] = {1};
+  for(int k=63 - __builtin_clzll(j); k>=0; k--) {
+    m_sqr_mod(p);
+    if((j >> k) & 1) m_shift_mod(p);
+  }
+  m_apply_poly(rand->mt, p);
+  int head = 0;
+  m_step(rand->mt, &head);
+  uint32_t w[STATE_VECTOR_LENGTH];
+  for(int k=0; k<STATE_VECTOR_LENGTH; k++)
+    w[k] = rand->mt[(head + k) % STATE_VECTOR_LENGTH];
+  memcpy(rand->mt, w, sizeof(w));
+  rand->index = (int32_t)(t % STATE_VECTOR_LENGTH);
+}
 
+/**
+ * Fills out[0..nsplit) with copies of rand advanced by 0, stride,
+ * 2 stride, ... outputs: nsplit non-overlapping substreams of one
+ * sequence when each draws at most stride values.
+ */
+void splitRand(const MTRand* rand, int nsplit, uint64_t stride, MTRand* out) {
+  for(int i=0; i<nsplit; i++) {
+    out[i] = (i == 0) ? *rand : out[i - 1];
+    if(i > 0) jumpRand(&out[i], stride);
+  }
+}
@@ -2,9 +2,11 @@
 #define __RNG_H
 
 #include <stdint.h>
+#include <stddef.h>
 
 #define STATE_VECTOR_LENGTH 624
 #define STATE_VECTOR_M      397 /* changes to STATE_VECTOR_LENGTH also require changes to this */
+#define JUMP_MIN ((uint64_t)1 << 27) /* shorter jumps twist batch by batch */
 
 typedef struct tagMTRand {
   uint32_t mt[STATE_VECTOR_LENGTH];
@@ -14,5 +16,10 @@ typedef struct tagMTRand {
 MTRand seedRand(uint32_t seed);
 uint32_t genRandLong(MTRand* rand);
 double genRand(MTRand* rand);
+void genRandLongs(MTRand* rand, uint32_t* out, size_t n);
+void genRands(MTRand* rand, double* out, size_t n);
+void initJumpRand(void);
+void jumpRand(MTRand* rand, uint64_t n);
+void splitRand(const MTRand* rand, int nsplit, uint64_t stride, MTRand* out);
 
 #endif /* #ifndef __RNG_H */
\ No newline at end of file
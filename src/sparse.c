@@ -0,0 +1,420 @@
+#include "sparse.h"
+#include "array.h"
+#include "memory.h"
+#include "parallel.h"
+#include "global.h"
+
+#include <stdio.h>
+#include <string.h> // memcpy
+#include <math.h> // sqrt
+
+
+
+/*
+    SPARSE ARRAYS
+*/
+
+int is_sparse(ARRP v) {
+    return arrtype(v) == CSR_ARR || arrtype(v) == CSC_ARR;
+}
+
+static void _check_sparse(ARRP s, const char *caller) {
+    if (!is_sparse(s)) {
+        fprintf(stderr, "%s: expected CSR_ARR or CSC_ARR, got %s\n",
+                caller, arrtype_str(arrtype(s)));
+        exit(1);
+    }
+}
+
+/*number of rows (CSR) or columns (CSC)*/
+static size_t _nmajor(const ArrayStruct *ar) {
+    return (ar->type == CSR_ARR) ? ar->dims[0] : ar->dims[1];
+}
+
+/*
+    room for nnz stored values; ptr is all zero, so the caller fills ptr,
+    idx and reals
+*/
+ARRP alloc_sparse(arrtype_t type, size_t dim0, size_t dim1, size_t nnz) {
+    if (type != CSR_ARR && type != CSC_ARR) {
+        fprintf(stderr, "alloc_sparse: type must be CSR_ARR or CSC_ARR\n");
+        exit(1);
+    }
+    ARRP s = alloc_array(type, dim0, dim1);
+    ArrayStruct *ar = s.node->arr;
+    ar->data = chk_malloc(nnz * sizeof(double));
+    ar->reals = (double*)ar->data;
+    ar->idx = chk_malloc(nnz * sizeof(size_t));
+    ar->capacity = nnz;
+    ar->nalloc = nnz;
+    return s;
+}
+
+size_t nnz(ARRP s) {
+    _check_sparse(s, "nnz");
+    return s.node->arr->ptr[_nmajor(s.node->arr)];
+}
+
+ARRP copy_sparse(ARRP s) {
+    _check_sparse(s, "copy_sparse");
+    const ArrayStruct *a = s.node->arr;
+    size_t nz = nnz(s);
+    ARRP out = alloc_sparse(a->type, a->dims[0], a->dims[1], nz);
+    ArrayStruct *o = out.node->arr;
+    memcpy(o->ptr, a->ptr, (_nmajor(a) + 1) * sizeof(size_t));
+    if (nz > 0) {
+        memcpy(o->idx, a->idx, nz * sizeof(size_t));
+        memcpy(o->reals, a->reals, nz * sizeof(double));
+    }
+    return out;
+}
+
+/*binary search within the row (CSR) or column (CSC)*/
+double sparse_elt(ARRP s, size_t dim0, size_t dim1) {
+    _check_sparse(s, "sparse_elt");
+    const ArrayStruct *a = s.node->arr;
+    if (dim0 >= a->dims[0] || dim1 >= a->dims[1]) {
+        fprintf(stderr, "sparse_elt: index out of bounds\n");
+        exit(1);
+    }
+    size_t major = (a->type == CSR_ARR) ? dim0 : dim1;
+    size_t minor = (a->type == CSR_ARR) ? dim1 : dim0;
+    size_t lo = a->ptr[major], hi = a->ptr[major + 1];
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (a->idx[mid] < minor)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return (lo < a->ptr[major + 1] && a->idx[lo] == minor) ? a->reals[lo] : 0.;
+}
+
+/*
+    CSR <-> CSC by a counting sort on the minor index; walking the majors in
+    order keeps each new major's indices sorted
+*/
+static ARRP _sparse_transpose_storage(ARRP s) {
+    const ArrayStruct *a = s.node->arr;
+    arrtype_t to = (a->type == CSR_ARR) ? CSC_ARR : CSR_ARR;
+    size_t nz = nnz(s), nmaj = _nmajor(a);
+    ARRP out = alloc_sparse(to, a->dims[0], a->dims[1], nz);
+    ArrayStruct *o = out.node->arr;
+    size_t nmin = _nmajor(o);
+    for (size_t k = 0; k < nz; ++k)
+        o->ptr[a->idx[k] + 1]++;
+    for (size_t m = 0; m < nmin; ++m)
+        o->ptr[m + 1] += o->ptr[m];
+    size_t *next = chk_malloc((nmin + 1) * sizeof(size_t));
+    memcpy(next, o->ptr, (nmin + 1) * sizeof(size_t));
+    for (size_t m = 0; m < nmaj; ++m) {
+        for (size_t k = a->ptr[m]; k < a->ptr[m + 1]; ++k) {
+            size_t pos = next[a->idx[k]]++;
+            o->idx[pos] = m;
+            o->reals[pos] = a->reals[k];
+        }
+    }
+    chk_free(next);
+    return out;
+}
+
+/*dense (INTS_ARR / REALS_ARR) to sparse, or between CSR and CSC*/
+ARRP as_sparse(ARRP x, arrtype_t type) {
+    if (type != CSR_ARR && type != CSC_ARR) {
+        fprintf(stderr, "as_sparse: type must be CSR_ARR or CSC_ARR\n");
+        exit(1);
+    }
+    if (is_sparse(x))
+        return (arrtype(x) == type) ? copy_sparse(x) : _sparse_transpose_storage(x);
+    if (arrtype(x) != INTS_ARR && arrtype(x) != REALS_ARR) {
+        fprintf(stderr, "as_sparse: unsupported type %s\n", arrtype_str(arrtype(x)));
+        exit(1);
+    }
+    // walk the view major by major: transposed for CSC
+    ARRV w = view(x);
+    if (type == CSC_ARR)
+        w = transpose_view(w);
+    size_t nmaj = w.dims[0], nmin = w.dims[1], nz = 0;
+    const int *xi = w.arr->ints + w.offset;
+    const double *xr = w.arr->reals + w.offset;
+#define DENSE_AT(i, j) ((w.arr->type == REALS_ARR) \
+        ? xr[(i) * w.strides[0] + (j) * w.strides[1]] \
+        : (double)xi[(i) * w.strides[0] + (j) * w.strides[1]])
+    for (size_t i = 0; i < nmaj; ++i) {
+        for (size_t j = 0; j < nmin; ++j)
+            nz += (DENSE_AT(i, j) != 0);
+    }
+    ARRP s = alloc_sparse(type, dims(x)[0], dims(x)[1], nz);
+    ArrayStruct *a = s.node->arr;
+    size_t k = 0;
+    for (size_t i = 0; i < nmaj; ++i) {
+        a->ptr[i] = k;
+        for (size_t j = 0; j < nmin; ++j) {
+            double v = DENSE_AT(i, j);
+            if (v != 0) {
+                a->idx[k] = j;
+                a->reals[k++] = v;
+            }
+        }
+    }
+    a->ptr[nmaj] = k;
+#undef DENSE_AT
+    return s;
+}
+
+ARRP as_dense(ARRP s) {
+    _check_sparse(s, "as_dense");
+    const ArrayStruct *a = s.node->arr;
+    ARRP out = alloc_array(REALS_ARR, a->dims[0], a->dims[1]);
+    double *o = real(out);
+    size_t ncol = a->dims[1];
+    for (size_t m = 0; m < _nmajor(a); ++m) {
+        for (size_t k = a->ptr[m]; k < a->ptr[m + 1]; ++k) {
+            if (a->type == CSR_ARR)
+                o[m * ncol + a->idx[k]] = a->reals[k];
+            else
+                o[a->idx[k] * ncol + m] = a->reals[k];
+        }
+    }
+    return out;
+}
+
+/*
+    (row, col, value) triplets in any order; duplicates are summed. Bucket
+    by major index, then sort each (short) bucket by minor index.
+*/
+ARRP sparse_from_triplets(arrtype_t type, size_t dim0, size_t dim1, size_t n,
+                          const size_t *rows, const size_t *cols, const double *vals) {
+    ARRP s = alloc_sparse(type, dim0, dim1, n);
+    ArrayStruct *a = s.node->arr;
+    const size_t *maj = (type == CSR_ARR) ? rows : cols;
+    const size_t *min = (type == CSR_ARR) ? cols : rows;
+    size_t nmaj = _nmajor(a);
+    for (size_t k = 0; k < n; ++k) {
+        if (rows[k] >= dim0 || cols[k] >= dim1) {
+            fprintf(stderr, "sparse_from_triplets: index out of bounds\n");
+            exit(1);
+        }
+        a->ptr[maj[k] + 1]++;
+    }
+    for (size_t m = 0; m < nmaj; ++m)
+        a->ptr[m + 1] += a->ptr[m];
+    size_t *next = chk_malloc((nmaj + 1) * sizeof(size_t));
+    memcpy(next, a->ptr, (nmaj + 1) * sizeof(size_t));
+    for (size_t k = 0; k < n; ++k) {
+        size_t pos = next[maj[k]]++;
+        a->idx[pos] = min[k];
+        a->reals[pos] = vals[k];
+    }
+    chk_free(next);
+    // sort each bucket and merge duplicates, compacting as we go
+    size_t w = 0;
+    for (size_t m = 0; m < nmaj; ++m) {
+        size_t lo = a->ptr[m], hi = a->ptr[m + 1];
+        for (size_t k = lo + 1; k < hi; ++k) {
+            size_t ik = a->idx[k];
+            double vk = a->reals[k];
+            size_t j = k;
+            while (j > lo && a->idx[j - 1] > ik) {
+                a->idx[j] = a->idx[j - 1];
+                a->reals[j] = a->reals[j - 1];
+                --j;
+            }
+            a->idx[j] = ik;
+            a->reals[j] = vk;
+        }
+        a->ptr[m] = w;
+        for (size_t k = lo; k < hi; ++k) {
+            if (w > a->ptr[m] && a->idx[w - 1] == a->idx[k]) {
+                a->reals[w - 1] += a->reals[k];
+            } else {
+                a->idx[w] = a->idx[k];
+                a->reals[w++] = a->reals[k];
+            }
+        }
+    }
+    a->ptr[nmaj] = w;
+    a->nalloc = w;
+    return s;
+}
+
+
+
+/*
+    SPARSE PRODUCTS
+*/
+
+typedef struct _spmm_job {
+    const ArrayStruct *s;
+    double alpha;
+    ARRV b, c;
+} _spmm_job;
+
+/*
+    Majors of S are rows of op(S): C[i, :] += v * B[j, :] for each stored
+    (i, j, v). Threads own disjoint rows of C.
+*/
+static void _spmm_gather(void *arg, size_t start, size_t end, int tid) {
+    _spmm_job *job = (_spmm_job*)arg;
+    const ArrayStruct *s = job->s;
+    const double *B = job->b.arr->reals + job->b.offset;
+    double *C = job->c.arr->reals + job->c.offset;
+    size_t n = job->c.dims[1];
+    size_t bs0 = job->b.strides[0], bs1 = job->b.strides[1];
+    size_t cs0 = job->c.strides[0], cs1 = job->c.strides[1];
+    for (size_t i = start; i < end; ++i) {
+        double *ci = C + i * cs0;
+        for (size_t k = s->ptr[i]; k < s->ptr[i + 1]; ++k) {
+            double v = job->alpha * s->reals[k];
+            const double *bj = B + s->idx[k] * bs0;
+            for (size_t c = 0; c < n; ++c)
+                ci[c * cs1] += v * bj[c * bs1];
+        }
+    }
+}
+
+/*
+    Majors of S are columns of op(S): C[i, :] += v * B[k, :] for each stored
+    (i, k, v) of major k. Rows of C get hit by many majors, so threads own
+    disjoint columns of C instead.
+*/
+static void _spmm_scatter(void *arg, size_t start, size_t end, int tid) {
+    _spmm_job *job = (_spmm_job*)arg;
+    const ArrayStruct *s = job->s;
+    const double *B = job->b.arr->reals + job->b.offset;
+    double *C = job->c.arr->reals + job->c.offset;
+    size_t bs0 = job->b.strides[0], bs1 = job->b.strides[1];
+    size_t cs0 = job->c.strides[0], cs1 = job->c.strides[1];
+    for (size_t k = 0; k < _nmajor(s); ++k) {
+        const double *bk = B + k * bs0;
+        for (size_t e = s->ptr[k]; e < s->ptr[k + 1]; ++e) {
+            double v = job->alpha * s->reals[e];
+            double *ci = C + s->idx[e] * cs0;
+            for (size_t c = start; c < end; ++c)
+                ci[c * cs1] += v * bk[c * bs1];
+        }
+    }
+}
+
+void spmm_view(double alpha, ARRP s, int trans, ARRV b, double beta, ARRV c) {
+    _check_sparse(s, "spmm");
+    const ArrayStruct *a = s.node->arr;
+    size_t m = a->dims[trans ? 1 : 0], p = a->dims[trans ? 0 : 1];
+    if (b.arr->type != REALS_ARR || c.arr->type != REALS_ARR) {
+        fprintf(stderr, "spmm: dense operands must be REALS_ARR\n");
+        exit(1);
+    }
+    if (b.dims[0] != p || c.dims[0] != m || c.dims[1] != b.dims[1]) {
+        fprintf(stderr, "spmm: dimensions are not compatible\n");
+        exit(1);
+    }
+    double *C = c.arr->reals + c.offset;
+    for (size_t i = 0; i < m; ++i) {
+        for (size_t j = 0; j < c.dims[1]; ++j)
+            C[i*c.strides[0] + j*c.strides[1]] =
+                (beta == 0) ? 0 : beta * C[i*c.strides[0] + j*c.strides[1]];
+    }
+    _spmm_job job = {a, alpha, b, c};
+    int gather = (a->type == CSR_ARR) != (trans != 0);
+    if (gather)
+        parallel_for(m, parallel_nthreads(m), _spmm_gather, &job);
+    else
+        parallel_for(c.dims[1], parallel_nthreads(c.dims[1]), _spmm_scatter, &job);
+}
+
+/*
+    op(a) op(b) with a or b sparse. A sparse right operand is handled as
+    C' = op(b)' op(a)', writing through a transposed view of C. The result
+    is row-major for a sparse left operand and column-major for a sparse
+    right one, so the kernels' inner loops write contiguously.
+*/
+ARRP sparse_matmul(ARRP a, int trans_a, ARRP b, int trans_b) {
+    if (is_sparse(a) && is_sparse(b)) {
+        fprintf(stderr, "sparse_matmul: sparse x sparse products are not "
+                        "supported, convert one side with as_dense\n");
+        exit(1);
+    }
+    size_t m = dims(a)[trans_a ? 1 : 0], ka = dims(a)[trans_a ? 0 : 1];
+    size_t kb = dims(b)[trans_b ? 1 : 0], n = dims(b)[trans_b ? 0 : 1];
+    if (ka != kb) {
+        fprintf(stderr, "sparse_matmul: dimensions are not compatible\n");
+        exit(1);
+    }
+    if (is_sparse(a)) {
+        ARRP out = alloc_array_layout(REALS_ARR, m, n, ROW_MAJOR);
+        ARRV bv = trans_b ? transpose_view(view(b)) : view(b);
+        spmm_view(1.0, a, trans_a, bv, 0.0, view(out));
+        return out;
+    }
+    ARRP out = alloc_array_layout(REALS_ARR, m, n, COL_MAJOR);
+    ARRV at = trans_a ? view(a) : transpose_view(view(a));
+    spmm_view(1.0, b, !trans_b, at, 0.0, transpose_view(view(out)));
+    return out;
+}
+
+typedef struct _gram_job {
+    const ArrayStruct *s;
+    size_t *bounds;   // output rows [bounds[t], bounds[t + 1]) go to task t
+    double *out;
+    size_t p;
+} _gram_job;
+
+/*
+    Upper triangle of sum over majors of outer(entries, entries), for the
+    output rows of each task. Indices within a major are sorted, so the
+    entries landing in rows [lo, hi) are found by binary search.
+*/
+static void _gram_worker(void *arg, size_t start, size_t end, int tid) {
+    _gram_job *job = (_gram_job*)arg;
+    const ArrayStruct *s = job->s;
+    for (size_t t = start; t < end; ++t) {
+        size_t lo = job->bounds[t], hi = job->bounds[t + 1];
+        for (size_t m = 0; m < _nmajor(s); ++m) {
+            size_t e0 = s->ptr[m], e1 = s->ptr[m + 1];
+            size_t a = e0, b = e1;
+            while (a < b) {
+                size_t mid = a + (b - a) / 2;
+                if (s->idx[mid] < lo) a = mid + 1; else b = mid;
+            }
+            for (size_t e = a; e < e1 && s->idx[e] < hi; ++e) {
+                double *orow = job->out + s->idx[e] * job->p;
+                double v = s->reals[e];
+                for (size_t f = e; f < e1; ++f)
+                    orow[s->idx[f]] += v * s->reals[f];
+            }
+        }
+    }
+}
+
+/*
+    S'S from the rows of a CSR matrix (SS' from the columns of a CSC one),
+    converting the storage first if needed. Cost is the sum of squared
+    row lengths, tiny for dummy-coded designs. Output rows are split so
+    each task gets about the same share of the upper triangle.
+*/
+ARRP sparse_gram(ARRP s, int trans) {
+    _check_sparse(s, "sparse_gram");
+    arrtype_t want = trans ? CSC_ARR : CSR_ARR;
+    ARRP tmp = (arrtype(s) == want) ? s : as_sparse(s, want);
+    const ArrayStruct *a = tmp.node->arr;
+    size_t p = a->dims[trans ? 0 : 1];
+    ARRP out = alloc_array(REALS_ARR, p, p);
+
+    int nt = parallel_nthreads(p);
+    _gram_job job = {a, NULL, real(out), p};
+    job.bounds = chk_malloc((nt + 1) * sizeof(size_t));
+    for (int t = 0; t <= nt; ++t)
+        job.bounds[t] = (size_t)((double)p * (1. - sqrt(1. - (double)t / nt)));
+    job.bounds[nt] = p;
+    parallel_for(nt, nt, _gram_worker, &job);
+    chk_free(job.bounds);
+
+    double *o = real(out);
+    for (size_t i = 0; i < p; ++i) {
+        for (size_t j = i + 1; j < p; ++j)
+            o[j * p + i] = o[i * p + j];
+    }
+    if (tmp.node != s.node)
+        free_array(&tmp);
+    return out;
+}
@@ -0,0 +1,36 @@
+#ifndef __SPARSE_H
+#define __SPARSE_H
+
+#include "array.h"
+
+
+/*
+    SPARSE ARRAYS
+    CSR_ARR / CSC_ARR store only the nonzero values of a real matrix. For
+    CSR the values of row i are reals[ptr[i] .. ptr[i + 1]), in increasing
+    column order, with their columns in idx; CSC is the same by column.
+    length() of a sparse array is its number of stored values.
+*/
+int is_sparse(ARRP v);
+ARRP alloc_sparse(arrtype_t type, size_t dim0, size_t dim1, size_t nnz);
+ARRP sparse_from_triplets(arrtype_t type, size_t dim0, size_t dim1, size_t n,
+                          const size_t *rows, const size_t *cols, const double *vals);
+ARRP as_sparse(ARRP x, arrtype_t type);
+ARRP as_dense(ARRP s);
+ARRP copy_sparse(ARRP s);
+size_t nnz(ARRP s);
+double sparse_elt(ARRP s, size_t dim0, size_t dim1);
+
+/*
+    SPARSE PRODUCTS
+    spmm_view: C = alpha * op(S) B + beta * C for dense REALS_ARR views B, C,
+    op(S) = S' if trans. sparse_matmul computes op(a) op(b) (dense result)
+    when at least one of a, b is sparse; matmul / crossprod / tcrossprod
+    dispatch to it. sparse_gram returns the dense S'S (or SS' if trans).
+*/
+void spmm_view(double alpha, ARRP s, int trans, ARRV b, double beta, ARRV c);
+ARRP sparse_matmul(ARRP a, int trans_a, ARRP b, int trans_b);
+ARRP sparse_gram(ARRP s, int trans);
+
+
+#endif // __SPARSE_H
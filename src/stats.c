@@ -0,0 +1,1687 @@
+#include "stats.h"
+#include "array.h"
+#include "memory.h"
+#include "parallel.h"
+#include "linalg.h"
+#include "global.h"
+#include "rand/philox.h"
+#include "rand/dist.h"
+#include "bitmap.h"
+#include "dataframe.h"
+
+#include <stdio.h>
+#include <stddef.h> // ptrdiff_t
+#include <math.h> // sqrt, NAN
+#include <string.h> // memset
+
+
+
+/*
+    STREAMING MOMENTS
+*/
+
+moments_t moments_init(void) {
+    moments_t m = {0, 0., 0., 0., 0.};
+    return m;
+}
+
+
+/*
+    Combine the moments of two disjoint samples (Pebay, 2008, eqs. 2.1-2.4).
+*/
+void moments_merge(moments_t *m, const moments_t *other) {
+    if (other->n == 0)
+        return;
+    if (m->n == 0) {
+        *m = *other;
+        return;
+    }
+    double na = (double)m->n, nb = (double)other->n;
+    double n = na + nb;
+    double d = other->mean - m->mean;
+    double d_n = d / n;
+    double d2 = d * d;
+    double m2 = m->m2 + other->m2 + d2 * na * nb / n;
+    double m3 = m->m3 + other->m3
+              + d2 * d_n * na * nb * (na - nb) / n
+              + 3. * d_n * (na * other->m2 - nb * m->m2);
+    double m4 = m->m4 + other->m4
+              + d2 * d_n * d_n * na * nb * (na * na - na * nb + nb * nb) / n
+              + 6. * d_n * d_n * (na * na * other->m2 + nb * nb * m->m2)
+              + 4. * d_n * (na * other->m3 - nb * m->m3);
+    m->n += other->n;
+    m->mean += d * nb / n;
+    m->m2 = m2;
+    m->m3 = m3;
+    m->m4 = m4;
+}
+
+
+/*
+    Each chunk is streamed through a small buffer. Per block, the mean and
+    then the central power sums are computed with plain loops over the
+    (cache-resident) buffer, which vectorize; the block is then merged into
+    the running state. Memory is read once.
+*/
+#define MOMENTS_BLOCK 256
+void moments_update_view(moments_t *m, ARRV w) {
+    double buf[MOMENTS_BLOCK];
+    size_t n = view_length(w);
+    for (size_t start = 0; start < n; start += MOMENTS_BLOCK) {
+        size_t nb = (n - start < MOMENTS_BLOCK) ? n - start : MOMENTS_BLOCK;
+        view_gather_reals(w, start, nb, buf);
+        double s[4] = {0., 0., 0., 0.};
+        size_t i;
+        for (i = 0; i + 4 <= nb; i += 4) {
+            s[0] += buf[i];   s[1] += buf[i+1];
+            s[2] += buf[i+2]; s[3] += buf[i+3];
+        }
+        for (; i < nb; ++i)
+            s[0] += buf[i];
+        double mu = ((s[0] + s[1]) + (s[2] + s[3])) / nb;
+        double m2 = 0., m3 = 0., m4 = 0.;
+        for (i = 0; i < nb; ++i) {
+            double d = buf[i] - mu;
+            double dd = d * d;
+            m2 += dd;
+            m3 += dd * d;
+            m4 += dd * dd;
+        }
+        moments_t block = {nb, mu, m2, m3, m4};
+        moments_merge(m, &block);
+    }
+}
+
+void moments_update(moments_t *m, ARRP v) {
+    moments_update_view(m, view(v));
+}
+
+
+double moments_mean(const moments_t *m) {
+    return (m->n > 0) ? m->mean : NAN;
+}
+
+/*sample variance (n - 1 denominator)*/
+double moments_var(const moments_t *m) {
+    return (m->n > 1) ? m->m2 / (m->n - 1) : NAN;
+}
+
+double moments_sd(const moments_t *m) {
+    return sqrt(moments_var(m));
+}
+
+/*g1 = sqrt(n) m3 / m2^(3/2)*/
+double moments_skew(const moments_t *m) {
+    if (m->n < 2 || m->m2 == 0)
+        return NAN;
+    return sqrt((double)m->n) * m->m3 / pow(m->m2, 1.5);
+}
+
+/*excess kurtosis, g2 = n m4 / m2^2 - 3*/
+double moments_kurt(const moments_t *m) {
+    if (m->n < 2 || m->m2 == 0)
+        return NAN;
+    return (double)m->n * m->m4 / (m->m2 * m->m2) - 3.;
+}
+
+
+
+
+/*
+    COVARIANCE / CORRELATION
+
+    The upper triangle of the p x p result is cut into COV_TILE x COV_TILE
+    tiles, and threads own whole tiles: a thread streams all the rows in
+    blocks of COV_BLOCK, gathering only the two column panels of its tile
+    (column-major, shifted by a data value from each column, which keeps
+    the cross products well conditioned without a separate pass for the
+    means) and accumulates straight into that tile. Scratch is therefore
+    per thread and independent of p, and the only array allocated is the
+    result. When there are fewer tiles than threads (narrow data), each
+    tile's rows are also split into segments whose partial sums are added
+    up at the end.
+
+    With USE_PAIRWISE missing values are zeroed and tracked by a 0/1 mask M,
+    and the per-pair quantities are all cross products:
+        N = M'M,  S = X'M,  P = X'X,  Q = (X*X)'M
+    so cov(j,k) = (P[j,k] - S[j,k] S[k,j] / N[j,k]) / (N[j,k] - 1).
+*/
+#define COV_BLOCK 256
+#define COV_TILE 128
+#define COV_SUBTILE 16
+
+typedef struct _cov_job {
+    ARRV x;
+    size_t p;
+    int pairwise, correlation;
+    const double *shift;
+    size_t *tiles;      // (row tile, col tile) pairs, upper triangle only
+    size_t nseg;        // row segments per tile
+    size_t nblocks;     // blocks of COV_BLOCK rows
+    double **buf;       // per thread, 4 panels of tile width x COV_BLOCK
+    double **acc;       // per thread (nseg == 1) or per task, _cov_acc_len
+    double *out;
+} _cov_job;
+
+/*
+    accumulator layout for an nj x nk tile, each quantity indexed [a * nk + b]
+    for columns j = j0 + a, k = k0 + b:
+        P = x_j x_k,  S = x_j m_k,  St = x_k m_j,  N = m_j m_k,
+        Q = x_j^2 m_k,  Qt = x_k^2 m_j
+    Without missing values only P is kept, followed by the column sums of
+    the two panels: S of length nj and St of length nk.
+*/
+enum { _COV_P = 0, _COV_S, _COV_ST, _COV_N, _COV_Q, _COV_QT, _COV_NQ };
+
+static size_t _cov_acc_len(int pairwise, size_t nj, size_t nk) {
+    return pairwise ? _COV_NQ * nj * nk : nj * nk + nj + nk;
+}
+
+/*point q[] at the quantities of acc; unused ones are NULL*/
+static void _cov_acc_split(double *acc, int pairwise, size_t nj, size_t nk, double **q) {
+    for (int i = 0; i < _COV_NQ; ++i)
+        q[i] = pairwise ? acc + i * nj * nk : NULL;
+    if (!pairwise) {
+        q[_COV_P] = acc;
+        q[_COV_S] = acc + nj * nk;
+        q[_COV_ST] = acc + nj * nk + nj;
+    }
+}
+
+/*widest tile, so narrow data gets small scratch*/
+static size_t _cov_tile_width(size_t p) {
+    return (p < COV_TILE) ? p : COV_TILE;
+}
+
+/*first columns and extents of a tile*/
+static void _cov_tile_dims(const _cov_job *job, size_t tile, size_t *j0, size_t *k0,
+                           size_t *nj, size_t *nk) {
+    size_t p = job->p;
+    *j0 = job->tiles[2*tile] * COV_TILE;
+    *k0 = job->tiles[2*tile + 1] * COV_TILE;
+    *nj = (p - *j0 < COV_TILE) ? p - *j0 : COV_TILE;
+    *nk = (p - *k0 < COV_TILE) ? p - *k0 : COV_TILE;
+}
+
+static double _dot(const double *a, const double *b, size_t n) {
+    double r[4] = {0., 0., 0., 0.};
+    size_t i;
+    for (i = 0; i + 4 <= n; i += 4) {
+        r[0] += a[i] * b[i];     r[1] += a[i+1] * b[i+1];
+        r[2] += a[i+2] * b[i+2]; r[3] += a[i+3] * b[i+3];
+    }
+    for (; i < n; ++i)
+        r[0] += a[i] * b[i];
+    return (r[0] + r[1]) + (r[2] + r[3]);
+}
+
+static double _dot3(const double *a, const double *b, const double *c, size_t n) {
+    double r[4] = {0., 0., 0., 0.};
+    size_t i;
+    for (i = 0; i + 4 <= n; i += 4) {
+        r[0] += a[i] * b[i] * c[i];       r[1] += a[i+1] * b[i+1] * c[i+1];
+        r[2] += a[i+2] * b[i+2] * c[i+2]; r[3] += a[i+3] * b[i+3] * c[i+3];
+    }
+    for (; i < n; ++i)
+        r[0] += a[i] * b[i] * c[i];
+    return (r[0] + r[1]) + (r[2] + r[3]);
+}
+
+static double _cov_colsum(const double *x, size_t n) {
+    double s = 0.;
+    for (size_t i = 0; i < n; ++i)
+        s += x[i];
+    return s;
+}
+
+/*column-major panel: x[a * nb + i] = X[row + i, j0 + a] - shift[j0 + a]*/
+static void _cov_panel(_cov_job *job, size_t row, size_t nb, size_t j0, size_t nj,
+                       double *x, double *m) {
+    view_gather_reals(transpose_view(subview(job->x, row, j0, nb, nj)), 0, nb * nj, x);
+    for (size_t a = 0; a < nj; ++a) {
+        double *xa = x + a * nb;
+        for (size_t i = 0; i < nb; ++i)
+            xa[i] -= job->shift[j0 + a];
+        if (m) {
+            double *ma = m + a * nb;
+            for (size_t i = 0; i < nb; ++i) {
+                ma[i] = (xa[i] == xa[i]);
+                xa[i] = ma[i] ? xa[i] : 0.;
+            }
+        }
+    }
+}
+
+static void _cov_block(_cov_job *job, size_t row, size_t nb, size_t tile,
+                       double *buf, double *acc) {
+    size_t pan = _cov_tile_width(job->p) * COV_BLOCK, j0, k0, nj, nk;
+    _cov_tile_dims(job, tile, &j0, &k0, &nj, &nk);
+    int diag = (j0 == k0), pw = job->pairwise;
+    double *xj = buf, *mj = pw ? buf + 2 * pan : NULL;
+    double *xk = diag ? xj : buf + pan, *mk = diag ? mj : (pw ? buf + 3 * pan : NULL);
+    _cov_panel(job, row, nb, j0, nj, xj, mj);
+    if (!diag)
+        _cov_panel(job, row, nb, k0, nk, xk, mk);
+    double *q[_COV_NQ];
+    _cov_acc_split(acc, pw, nj, nk, q);
+    double *P = q[_COV_P], *S = q[_COV_S], *St = q[_COV_ST];
+    double *N = q[_COV_N], *Q = q[_COV_Q], *Qt = q[_COV_QT];
+    // subtiles, so both stay in cache while they are combined
+    for (size_t a0 = 0; a0 < nj; a0 += COV_SUBTILE) {
+        size_t a1 = (a0 + COV_SUBTILE < nj) ? a0 + COV_SUBTILE : nj;
+        for (size_t b0 = diag ? a0 : 0; b0 < nk; b0 += COV_SUBTILE) {
+            size_t b1 = (b0 + COV_SUBTILE < nk) ? b0 + COV_SUBTILE : nk;
+            for (size_t a = a0; a < a1; ++a) {
+                const double *xa = xj + a * nb;
+                for (size_t b = (diag && a > b0) ? a : b0; b < b1; ++b) {
+                    const double *xb = xk + b * nb;
+                    size_t ab = a * nk + b;
+                    P[ab] += _dot(xa, xb, nb);
+                    if (!pw)
+                        continue;
+                    const double *ma = mj + a * nb, *mb = mk + b * nb;
+                    N[ab] += _dot(ma, mb, nb);
+                    S[ab] += _dot(xa, mb, nb);
+                    St[ab] += _dot(xb, ma, nb);
+                    Q[ab] += _dot3(xa, xa, mb, nb);
+                    Qt[ab] += _dot3(xb, xb, ma, nb);
+                }
+            }
+        }
+    }
+    if (!pw) {
+        for (size_t a = 0; a < nj; ++a)
+            S[a] += _cov_colsum(xj + a * nb, nb);
+        for (size_t b = 0; b < nk; ++b)
+            St[b] += _cov_colsum(xk + b * nb, nb);
+    }
+}
+/*write the tile's covariances (correlations, if pairwise) into both triangles*/
+static void _cov_tile_finish(_cov_job *job, size_t tile, double *acc) {
+    size_t p = job->p, n = job->x.dims[0], j0, k0, nj, nk;
+    _cov_tile_dims(job, tile, &j0, &k0, &nj, &nk);
+    double *q[_COV_NQ];
+    _cov_acc_split(acc, job->pairwise, nj, nk, q);
+    const double *P = q[_COV_P], *S = q[_COV_S], *St = q[_COV_ST];
+    const double *N = q[_COV_N], *Q = q[_COV_Q], *Qt = q[_COV_QT];
+    for (size_t a = 0; a < nj; ++a) {
+        for (size_t b = (j0 == k0) ? a : 0; b < nk; ++b) {
+            size_t j = j0 + a, k = k0 + b, ab = a * nk + b;
+            double njk, cjk;
+            if (job->pairwise) {
+                njk = N[ab];
+                cjk = (P[ab] - S[ab] * St[ab] / njk) / (njk - 1);
+                if (job->correlation) {
+                    double vj = (Q[ab] - S[ab] * S[ab] / njk) / (njk - 1);
+                    double vk = (Qt[ab] - St[ab] * St[ab] / njk) / (njk - 1);
+                    cjk = (j == k && cjk == cjk) ? 1. : cjk / sqrt(vj * vk);
+                }
+            } else {
+                njk = (double)n;
+                cjk = (P[ab] - S[a] * St[b] / njk) / (njk - 1);
+            }
+            if (njk < 2)
+                cjk = NAN;
+            job->out[j * p + k] = cjk;
+            job->out[k * p + j] = cjk;
+        }
+    }
+}
+
+/*task t is row segment t % nseg of tile t / nseg*/
+static void _cov_worker(void *arg, size_t start, size_t end, int tid) {
+    _cov_job *job = (_cov_job*)arg;
+    size_t nrow = job->x.dims[0];
+    for (size_t t = start; t < end; ++t) {
+        size_t tile = t / job->nseg, seg = t % job->nseg;
+        double *acc = job->acc[(job->nseg == 1) ? (size_t)tid : t];
+        size_t j0, k0, nj, nk;
+        _cov_tile_dims(job, tile, &j0, &k0, &nj, &nk);
+        memset(acc, 0, _cov_acc_len(job->pairwise, nj, nk) * sizeof(double));
+        size_t b0 = seg * job->nblocks / job->nseg, b1 = (seg + 1) * job->nblocks / job->nseg;
+        for (size_t row = b0 * COV_BLOCK; row < b1 * COV_BLOCK && row < nrow; row += COV_BLOCK) {
+            size_t nb = (nrow - row < COV_BLOCK) ? nrow - row : COV_BLOCK;
+            _cov_block(job, row, nb, tile, job->buf[tid], acc);
+        }
+        if (job->nseg == 1)
+            _cov_tile_finish(job, tile, acc);
+    }
+}
+
+static ARRP _cov_engine(ARRV x, cov_use_t use, int correlation) {
+    if (!is_numeric_type(x.arr->type)) {
+        fprintf(stderr, "cov: unsupported type: %s\n", arrtype_str(x.arr->type));
+        exit(1);
+    }
+    size_t n = x.dims[0], p = x.dims[1];
+    int pairwise = (use == USE_PAIRWISE);
+    // shift each column by its first present value
+    double *shift = chk_calloc(p ? p : 1, sizeof(double));
+    for (size_t j = 0; j < p; ++j) {
+        for (size_t i = 0; i < n; ++i) {
+            double v = view_elt(x, i, j);
+            if (v == v) {
+                shift[j] = v;
+                break;
+            }
+        }
+    }
+    ARRP out = alloc_array(REALS_ARR, p, p);
+    _cov_job job = {x, p, pairwise, correlation, shift, NULL, 1, 0, NULL, NULL, real(out)};
+    size_t ntp = (p + COV_TILE - 1) / COV_TILE, ntile = 0;
+    job.tiles = chk_malloc((ntp * (ntp + 1) + 2) * sizeof(size_t));
+    for (size_t j = 0; j < ntp; ++j) {
+        for (size_t k = j; k < ntp; ++k) {
+            job.tiles[2*ntile] = j;
+            job.tiles[2*ntile + 1] = k;
+            ntile++;
+        }
+    }
+    // with fewer tiles than threads, split each tile's rows as well
+    job.nblocks = (n + COV_BLOCK - 1) / COV_BLOCK;
+    size_t want = (size_t)get_num_threads();
+    if (ntile > 0 && ntile < want) {
+        job.nseg = (want + ntile - 1) / ntile;
+        if (job.nseg > job.nblocks)
+            job.nseg = job.nblocks ? job.nblocks : 1;
+    }
+    size_t ntask = ntile * job.nseg;
+    int nt = parallel_nthreads(ntask);
+    size_t nacc = (job.nseg == 1) ? (size_t)nt : ntask;
+    size_t tw = _cov_tile_width(p), lacc = _cov_acc_len(pairwise, tw, tw);
+    size_t nbuf = (pairwise ? 4 : 2) * tw * COV_BLOCK;
+    job.buf = chk_malloc(nt * sizeof(double*));
+    job.acc = chk_malloc((nacc ? nacc : 1) * sizeof(double*));
+    for (int t = 0; t < nt; ++t)
+        job.buf[t] = chk_malloc((nbuf ? nbuf : 1) * sizeof(double));
+    for (size_t t = 0; t < nacc; ++t)
+        job.acc[t] = chk_malloc((lacc ? lacc : 1) * sizeof(double));
+    parallel_for(ntask, nt, _cov_worker, &job);
+    if (job.nseg > 1) {
+        for (size_t tile = 0; tile < ntile; ++tile) {
+            double *acc = job.acc[tile * job.nseg];
+            size_t j0, k0, nj, nk;
+            _cov_tile_dims(&job, tile, &j0, &k0, &nj, &nk);
+            size_t len = _cov_acc_len(pairwise, nj, nk);
+            for (size_t s = 1; s < job.nseg; ++s) {
+                const double *part = job.acc[tile * job.nseg + s];
+                for (size_t i = 0; i < len; ++i)
+                    acc[i] += part[i];
+            }
+            _cov_tile_finish(&job, tile, acc);
+        }
+    }
+    // complete data: scale by the variances on the diagonal
+    if (correlation && !pairwise) {
+        double *c = real(out);
+        for (size_t j = 0; j < p; ++j)
+            shift[j] = c[j * p + j];
+        for (size_t j = 0; j < p; ++j) {
+            for (size_t k = j; k < p; ++k) {
+                double cjk = c[j * p + k];
+                cjk = (j == k && cjk == cjk) ? 1. : cjk / sqrt(shift[j] * shift[k]);
+                c[j * p + k] = cjk;
+                c[k * p + j] = cjk;
+            }
+        }
+    }
+    for (int t = 0; t < nt; ++t)
+        chk_free(job.buf[t]);
+    for (size_t t = 0; t < nacc; ++t)
+        chk_free(job.acc[t]);
+    chk_free(job.buf);
+    chk_free(job.acc);
+    chk_free(job.tiles);
+    chk_free(shift);
+    return out;
+}
+
+ARRP cov_view(ARRV x, cov_use_t use) {
+    return _cov_engine(x, use, 0);
+}
+
+ARRP cor_view(ARRV x, cov_use_t use) {
+    return _cov_engine(x, use, 1);
+}
+
+ARRP cov(ARRP x, cov_use_t use) {
+    return _cov_engine(view(x), use, 0);
+}
+
+ARRP cor(ARRP x, cov_use_t use) {
+    return _cov_engine(view(x), use, 1);
+}
+
+/*the numeric columns of df side by side as an n x q REALS_ARR, NA as NaN*/
+static ARRP _df_numeric(const data_frame *df) {
+    size_t q = 0;
+    for (size_t j = 0; j < df->ncol; ++j)
+        q += is_numeric_type(arrtype(df->cols[j]));
+    ARRP x = alloc_array_layout(REALS_ARR, df->nrow, q, COL_MAJOR);
+    q = 0;
+    for (size_t j = 0; j < df->ncol; ++j) {
+        if (is_numeric_type(arrtype(df->cols[j])))
+            view_gather_reals(view(df->cols[j]), 0, df->nrow, real(x) + df->nrow * q++);
+    }
+    return x;
+}
+
+static ARRP _cov_df(const data_frame *df, cov_use_t use, int correlation) {
+    ARRP x = _df_numeric(df);
+    ARRP out = _cov_engine(view(x), use, correlation);
+    free_array(&x);
+    return out;
+}
+
+ARRP cov_df(const data_frame *df, cov_use_t use) {
+    return _cov_df(df, use, 0);
+}
+
+ARRP cor_df(const data_frame *df, cov_use_t use) {
+    return _cov_df(df, use, 1);
+}
+
+
+
+
+/*
+    BOOTSTRAP
+
+    Replicates are handed to threads in contiguous ranges. Row numbers
+    are drawn BOOT_BLOCK at a time before any row is read: the gather is
+    bound by cache misses on large inputs, and independent loads let
+    them overlap (about 3x over drawing and loading row by row).
+*/
+#define BOOT_BLOCK 256
+
+typedef struct _boot_job {
+    ARRV x;
+    size_t nstat;
+    boot_stat_fn stat;
+    void *arg;
+    uint32_t seed;
+    ARRP *buf;          // per thread, n x p
+    double *out;        // R x nstat, row-major
+} _boot_job;
+
+static void _boot_worker(void *arg, size_t start, size_t end, int tid) {
+    _boot_job *job = (_boot_job*)arg;
+    ARRV x = job->x;
+    size_t n = x.dims[0], p = x.dims[1];
+    double *s = real(job->buf[tid]);
+    for (size_t b = start; b < end; ++b) {
+        PhiloxRand r = seedPhilox(job->seed, (uint32_t)b);
+        for (size_t i0 = 0; i0 < n; i0 += BOOT_BLOCK) {
+            // draw a block of row numbers first so the loads can overlap
+            size_t nb = (n - i0 < BOOT_BLOCK) ? n - i0 : BOOT_BLOCK;
+            double u[BOOT_BLOCK];
+            size_t rows[BOOT_BLOCK];
+            philoxRands(&r, u, nb);
+            for (size_t i = 0; i < nb; ++i)
+                rows[i] = (size_t)(u[i] * n);
+            double *si = s + i0 * p;
+            if (x.arr->type == REALS_ARR && !x.arr->valid) {
+                const double *x0 = x.arr->reals + x.offset;
+                for (size_t i = 0; i < nb; ++i, si += p) {
+                    const double *xk = x0 + rows[i] * x.strides[0];
+                    for (size_t j = 0; j < p; ++j)
+                        si[j] = xk[j * x.strides[1]];
+                }
+            } else {
+                // other types, or missing values (read as NaN)
+                for (size_t i = 0; i < nb; ++i, si += p)
+                    view_gather_reals(subview(x, rows[i], 0, 1, p), 0, p, si);
+            }
+        }
+        job->stat(view(job->buf[tid]), job->out + b * job->nstat, job->arg);
+    }
+}
+
+ARRP bootstrap_view(ARRV x, size_t R, size_t nstat, boot_stat_fn stat, void *arg,
+                    uint32_t seed) {
+    if (!is_numeric_type(x.arr->type)) {
+        fprintf(stderr, "bootstrap: unsupported type: %s\n", arrtype_str(x.arr->type));
+        exit(1);
+    }
+    if (R == 0 || nstat == 0 || R > UINT32_MAX) {
+        fprintf(stderr, "bootstrap: need 0 < R <= 2^32 - 1 and nstat > 0\n");
+        exit(1);
+    }
+    int nt = parallel_nthreads(R);
+    ARRP out = alloc_array_layout(REALS_ARR, R, nstat, ROW_MAJOR);
+    _boot_job job = {x, nstat, stat, arg, seed, NULL, real(out)};
+    job.buf = chk_malloc(nt * sizeof(ARRP));
+    for (int t = 0; t < nt; ++t)
+        job.buf[t] = alloc_array_layout(REALS_ARR, x.dims[0], x.dims[1], ROW_MAJOR);
+    parallel_for(R, nt, _boot_worker, &job);
+    for (int t = 0; t < nt; ++t)
+        free_array(&job.buf[t]);
+    chk_free(job.buf);
+    return out;
+}
+
+ARRP bootstrap(ARRP x, size_t R, size_t nstat, boot_stat_fn stat, void *arg,
+               uint32_t seed) {
+    return bootstrap_view(view(x), R, nstat, stat, arg, seed);
+}
+
+
+
+/*
+    SAMPLING
+*/
+
+/*Floyd's algorithm marks size distinct rows in a bitmap, then a shuffle*/
+static void _sample_norep(MTRand *r, size_t n, size_t size, int64_t *out) {
+    uint64_t *taken = bitmap_alloc(n, 0);
+    size_t m = 0;
+    for (size_t j = n - size; j < n; ++j) {
+        size_t t = (size_t)genRandBelow(r, j + 1);
+        if (bitmap_get(taken, t))
+            t = j;
+        bitmap_set(taken, t);
+        out[m++] = (int64_t)t;
+    }
+    chk_free(taken);
+    for (size_t i = size; i > 1; --i) {
+        size_t j = (size_t)genRandBelow(r, i);
+        int64_t tmp = out[i - 1];
+        out[i - 1] = out[j];
+        out[j] = tmp;
+    }
+}
+
+ARRP sample(size_t n, size_t size, int replace, uint32_t seed) {
+    if (!replace && size > n) {
+        fprintf(stderr, "sample: cannot take %zu rows of %zu without replacement\n", size, n);
+        exit(1);
+    }
+    if (replace && n == 0 && size > 0) {
+        fprintf(stderr, "sample: nothing to sample from\n");
+        exit(1);
+    }
+    ARRP out = alloc_array(LONGS_ARR, size, 1);
+    int64_t *o = int64(out);
+    MTRand r = seedRand(seed);
+    if (replace) {
+        for (size_t i = 0; i < size; ++i)
+            o[i] = (int64_t)genRandBelow(&r, n);
+    } else {
+        _sample_norep(&r, n, size, o);
+    }
+    return out;
+}
+
+/*weights as doubles; all finite and >= 0 with a positive sum*/
+static double *_sample_weights(ARRP weights, size_t *npos) {
+    size_t n = length(weights);
+    double *w = chk_malloc(n * sizeof(double));
+    double total = 0.;
+    *npos = 0;
+    for (size_t i = 0; i < n; ++i) {
+        w[i] = as_real(weights, i / dims(weights)[1], i % dims(weights)[1]);
+        if (!(w[i] >= 0.) || isinf(w[i])) {
+            fprintf(stderr, "sample_weighted: weights must be finite and non-negative\n");
+            exit(1);
+        }
+        total += w[i];
+        *npos += (w[i] > 0.);
+    }
+    if (!(total > 0.)) {
+        fprintf(stderr, "sample_weighted: weights sum to zero\n");
+        exit(1);
+    }
+    return w;
+}
+
+/*Vose's construction of Walker's alias table*/
+static void _alias_draws(MTRand *r, const double *w, size_t n, size_t size, int64_t *out) {
+    double *prob = chk_malloc(n * sizeof(double));
+    size_t *alias = chk_malloc(n * sizeof(size_t));
+    size_t *small = chk_malloc(n * sizeof(size_t));
+    size_t *large = chk_malloc(n * sizeof(size_t));
+    size_t ns = 0, nl = 0;
+    double total = 0.;
+    for (size_t i = 0; i < n; ++i)
+        total += w[i];
+    for (size_t i = 0; i < n; ++i) {
+        prob[i] = w[i] * n / total;
+        alias[i] = i;
+        if (prob[i] < 1.)
+            small[ns++] = i;
+        else
+            large[nl++] = i;
+    }
+    while (ns > 0 && nl > 0) {
+        size_t s = small[--ns], l = large[nl - 1];
+        alias[s] = l;
+        prob[l] = (prob[l] + prob[s]) - 1.;
+        if (prob[l] < 1.) {
+            --nl;
+            small[ns++] = l;
+        }
+    }
+    // leftovers are 1 up to rounding
+    while (nl > 0)
+        prob[large[--nl]] = 1.;
+    while (ns > 0)
+        prob[small[--ns]] = 1.;
+    for (size_t i = 0; i < size; ++i) {
+        size_t k = (size_t)genRandBelow(r, n);
+        out[i] = (int64_t)((genRand(r) < prob[k]) ? k : alias[k]);
+    }
+    chk_free(prob); chk_free(alias); chk_free(small); chk_free(large);
+}
+
+/*min-heap on keys, carrying row numbers along*/
+static void _heap_sift(double *key, int64_t *row, size_t n, size_t i) {
+    for (;;) {
+        size_t c = 2 * i + 1;
+        if (c >= n)
+            return;
+        if (c + 1 < n && key[c + 1] < key[c])
+            ++c;
+        if (key[i] <= key[c])
+            return;
+        double tk = key[i]; key[i] = key[c]; key[c] = tk;
+        int64_t tr = row[i]; row[i] = row[c]; row[c] = tr;
+        i = c;
+    }
+}
+
+/*
+    Efraimidis-Spirakis: the size largest keys log(u) / w, kept in a heap;
+    listing them by decreasing key gives the order of successive draws.
+*/
+static void _es_draws(MTRand *r, const double *w, size_t n, size_t size, int64_t *out) {
+    double *key = chk_malloc(size * sizeof(double));
+    size_t m = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (w[i] <= 0.)
+            continue;
+        double k = log(genUnifOpen(r)) / w[i];
+        if (m < size) {
+            key[m] = k;
+            out[m] = (int64_t)i;
+            if (++m == size) {
+                for (size_t j = size / 2; j-- > 0; )
+                    _heap_sift(key, out, size, j);
+            }
+        } else if (k > key[0]) {
+            key[0] = k;
+            out[0] = (int64_t)i;
+            _heap_sift(key, out, size, 0);
+        }
+    }
+    // heapsort: popping the minimum to the back leaves keys descending
+    for (size_t end = size; end > 1; --end) {
+        double tk = key[0]; key[0] = key[end - 1]; key[end - 1] = tk;
+        int64_t tr = out[0]; out[0] = out[end - 1]; out[end - 1] = tr;
+        _heap_sift(key, out, end - 1, 0);
+    }
+    chk_free(key);
+}
+
+ARRP sample_weighted(ARRP weights, size_t size, int replace, uint32_t seed) {
+    if (!is_numeric_type(arrtype(weights))) {
+        fprintf(stderr, "sample_weighted: unsupported type: %s\n", arrtype_str(arrtype(weights)));
+        exit(1);
+    }
+    size_t n = length(weights), npos;
+    double *w = _sample_weights(weights, &npos);
+    if (!replace && size > npos) {
+        fprintf(stderr, "sample_weighted: cannot take %zu rows of %zu with positive weight "
+                "without replacement\n", size, npos);
+        exit(1);
+    }
+    ARRP out = alloc_array(LONGS_ARR, size, 1);
+    MTRand r = seedRand(seed);
+    if (size > 0) {
+        if (replace)
+            _alias_draws(&r, w, n, size, int64(out));
+        else
+            _es_draws(&r, w, n, size, int64(out));
+    }
+    chk_free(w);
+    return out;
+}
+
+
+/*
+    RESERVOIR
+*/
+
+/*gap to the next kept row: floor(log(u) / log(1 - w)) + 1*/
+static size_t _reservoir_gap(reservoir_t *r) {
+    double g = floor(log(genUnifOpen(&r->rng)) / log1p(-r->w)) + 1.;
+    return (g < 1e18) ? (size_t)g : (size_t)1e18;
+}
+
+reservoir_t reservoir_init(size_t k, size_t p, uint32_t seed) {
+    if (k == 0 || p == 0) {
+        fprintf(stderr, "reservoir_init: k and p must be positive\n");
+        exit(1);
+    }
+    reservoir_t r;
+    r.k = k;
+    r.p = p;
+    r.seen = 0;
+    r.next = k;
+    r.w = 0.;
+    r.rows = alloc_array_layout(REALS_ARR, k, p, ROW_MAJOR);
+    r.index = alloc_array(LONGS_ARR, k, 1);
+    r.rng = seedRand(seed);
+    return r;
+}
+
+/*missing values stay NA (and read as NaN) in the reservoir*/
+static void _reservoir_keep(reservoir_t *r, size_t slot, ARRV chunk, size_t i) {
+    for (size_t j = 0; j < r->p; ++j) {
+        if (view_is_na(chunk, i, j))
+            set_na(r->rows, slot, j);
+        else
+            set_reals_elt(r->rows, slot, j, view_elt(chunk, i, j));
+    }
+    int64(r->index)[slot] = (int64_t)(r->seen + i);
+}
+
+void reservoir_update_view(reservoir_t *r, ARRV chunk) {
+    if (chunk.dims[1] != r->p) {
+        fprintf(stderr, "reservoir_update: chunk has %zu columns, expected %zu\n",
+                chunk.dims[1], r->p);
+        exit(1);
+    }
+    size_t m = chunk.dims[0], i = 0;
+    // fill the reservoir first
+    for (; i < m && r->seen + i < r->k; ++i)
+        _reservoir_keep(r, r->seen + i, chunk, i);
+    if (r->seen + i == r->k && r->w == 0.) {
+        r->w = exp(log(genUnifOpen(&r->rng)) / r->k);
+        r->next = r->k - 1 + _reservoir_gap(r);
+    }
+    // then jump from kept row to kept row
+    while (r->w > 0. && r->next < r->seen + m) {
+        size_t slot = (size_t)genRandBelow(&r->rng, r->k);
+        _reservoir_keep(r, slot, chunk, r->next - r->seen);
+        r->w *= exp(log(genUnifOpen(&r->rng)) / r->k);
+        r->next += _reservoir_gap(r);
+    }
+    r->seen += m;
+}
+
+void reservoir_update(reservoir_t *r, ARRP chunk) {
+    reservoir_update_view(r, view(chunk));
+}
+
+/*the sampled rows so far*/
+ARRV reservoir_view(const reservoir_t *r) {
+    if (r->seen == 0) {
+        fprintf(stderr, "reservoir_view: no rows seen yet\n");
+        exit(1);
+    }
+    size_t n = (r->seen < r->k) ? r->seen : r->k;
+    return subview(view(r->rows), 0, 0, n, r->p);
+}
+
+void free_reservoir(reservoir_t *r) {
+    free_array(&r->rows);
+    free_array(&r->index);
+}
+
+
+
+/*
+    HISTOGRAMS
+*/
+#define HIST_BLOCK 1024
+
+hist_t hist_init(ARRP breaks) {
+    size_t nb = length(breaks);
+    if (nb < 2) {
+        fprintf(stderr, "hist_init: need at least 2 breaks\n");
+        exit(1);
+    }
+    hist_t h;
+    h.nbin = nb - 1;
+    h.breaks = alloc_array(REALS_ARR, nb, 1);
+    for (size_t i = 0; i < nb; ++i) {
+        double b = as_real(breaks, i / dims(breaks)[1], i % dims(breaks)[1]);
+        if (!isfinite(b) || (i > 0 && b < real(h.breaks)[i - 1])) {
+            fprintf(stderr, "hist_init: breaks must be finite and non-decreasing\n");
+            exit(1);
+        }
+        real(h.breaks)[i] = b;
+    }
+    h.counts = alloc_array(LONGS_ARR, h.nbin, 1);
+    set_fill_num(h.counts, 0, 0);
+    h.n = h.below = h.above = h.na = 0;
+    h.uniform = 0;
+    return h;
+}
+
+hist_t hist_fixed(double lo, double hi, size_t nbin) {
+    if (nbin == 0 || !(hi > lo) || !isfinite(lo) || !isfinite(hi)) {
+        fprintf(stderr, "hist_fixed: need nbin > 0 and finite lo < hi\n");
+        exit(1);
+    }
+    ARRP b = alloc_array(REALS_ARR, nbin + 1, 1);
+    for (size_t i = 0; i <= nbin; ++i)
+        real(b)[i] = lo + (hi - lo) * i / nbin;
+    hist_t h = hist_init(b);
+    h.uniform = 1;
+    free_array(&b);
+    return h;
+}
+
+/*breaks at the t-digest quantiles of x (exact min and max), then binned*/
+hist_t hist_quantile(ARRP x, size_t nbin) {
+    if (nbin == 0) {
+        fprintf(stderr, "hist_quantile: need nbin > 0\n");
+        exit(1);
+    }
+    tdigest_t t = tdigest_init(200);
+    tdigest_update(&t, x);
+    if (t.total == 0) {
+        fprintf(stderr, "hist_quantile: no values\n");
+        exit(1);
+    }
+    ARRP b = alloc_array(REALS_ARR, nbin + 1, 1);
+    for (size_t i = 0; i <= nbin; ++i) {
+        double q = tdigest_quantile(&t, (double)i / nbin);
+        real(b)[i] = (i > 0 && q < real(b)[i - 1]) ? real(b)[i - 1] : q;
+    }
+    free_tdigest(&t);
+    hist_t h = hist_init(b);
+    free_array(&b);
+    hist_update(&h, x);
+    return h;
+}
+
+/*bin of x, or -1 / nbin for below / above*/
+static long _hist_bin(const hist_t *h, const double *br, double x) {
+    size_t nbin = h->nbin;
+    if (x < br[0])
+        return -1;
+    if (x > br[nbin])
+        return (long)nbin;
+    size_t k;
+    if (h->uniform) {
+        k = (size_t)((x - br[0]) / (br[nbin] - br[0]) * nbin);
+        if (k >= nbin)
+            k = nbin - 1;
+        // correct rounding at the edges
+        if (x < br[k])
+            --k;
+        else if (k + 1 < nbin && x >= br[k + 1])
+            ++k;
+        return (long)k;
+    }
+    size_t lo = 0, hi = nbin; // br[lo] <= x, last bin closed
+    while (hi - lo > 1) {
+        size_t mid = (lo + hi) / 2;
+        if (x >= br[mid])
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return (long)lo;
+}
+
+typedef struct _hist_job {
+    ARRV w;
+    const hist_t *h;
+    double **buf;       // per thread, HIST_BLOCK
+    size_t **counts;    // per thread, nbin + 3: bins, below, above, na
+} _hist_job;
+
+static void _hist_worker(void *arg, size_t start, size_t end, int tid) {
+    _hist_job *job = (_hist_job*)arg;
+    size_t nbin = job->h->nbin, len = view_length(job->w);
+    const double *br = job->h->breaks.node->arr->reals;
+    double *buf = job->buf[tid];
+    size_t *c = job->counts[tid];
+    for (size_t b = start; b < end; ++b) {
+        size_t i0 = b * HIST_BLOCK;
+        size_t nb = (len - i0 < HIST_BLOCK) ? len - i0 : HIST_BLOCK;
+        view_gather_reals(job->w, i0, nb, buf);
+        for (size_t i = 0; i < nb; ++i) {
+            if (buf[i] != buf[i]) {
+                c[nbin + 2]++;
+                continue;
+            }
+            long k = _hist_bin(job->h, br, buf[i]);
+            c[(k < 0) ? nbin : ((size_t)k == nbin) ? nbin + 1 : (size_t)k]++;
+        }
+    }
+}
+
+void hist_update_view(hist_t *h, ARRV w) {
+    if (!is_numeric_type(w.arr->type)) {
+        fprintf(stderr, "hist_update: unsupported type: %s\n", arrtype_str(w.arr->type));
+        exit(1);
+    }
+    size_t nblocks = (view_length(w) + HIST_BLOCK - 1) / HIST_BLOCK;
+    if (nblocks == 0)
+        return;
+    int nt = parallel_nthreads(nblocks);
+    _hist_job job = {w, h, NULL, NULL};
+    job.buf = chk_malloc(nt * sizeof(double*));
+    job.counts = chk_malloc(nt * sizeof(size_t*));
+    for (int t = 0; t < nt; ++t) {
+        job.buf[t] = chk_malloc(HIST_BLOCK * sizeof(double));
+        job.counts[t] = chk_calloc(h->nbin + 3, sizeof(size_t));
+    }
+    parallel_for(nblocks, nt, _hist_worker, &job);
+    int64_t *counts = int64(h->counts);
+    for (int t = 0; t < nt; ++t) {
+        size_t *c = job.counts[t];
+        for (size_t k = 0; k < h->nbin; ++k) {
+            counts[k] += (int64_t)c[k];
+            h->n += c[k];
+        }
+        h->below += c[h->nbin];
+        h->above += c[h->nbin + 1];
+        h->na += c[h->nbin + 2];
+        chk_free(job.buf[t]);
+        chk_free(job.counts[t]);
+    }
+    chk_free(job.buf);
+    chk_free(job.counts);
+}
+
+void hist_update(hist_t *h, ARRP x) {
+    hist_update_view(h, view(x));
+}
+
+/*add the counts of a histogram over the same breaks*/
+void hist_merge(hist_t *h, const hist_t *other) {
+    int same = (other->nbin == h->nbin);
+    for (size_t i = 0; same && i <= h->nbin; ++i)
+        same = (real(h->breaks)[i] == real(other->breaks)[i]);
+    if (!same) {
+        fprintf(stderr, "hist_merge: histograms have different breaks\n");
+        exit(1);
+    }
+    for (size_t k = 0; k < h->nbin; ++k)
+        int64(h->counts)[k] += int64(other->counts)[k];
+    h->n += other->n;
+    h->below += other->below;
+    h->above += other->above;
+    h->na += other->na;
+}
+
+void hist_write(const hist_t *h, const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "hist_write: can't open %s\n", path);
+        exit(1);
+    }
+    for (size_t k = 0; k < h->nbin; ++k)
+        fprintf(f, "%.15g %.15g %lld\n", real(h->breaks)[k], real(h->breaks)[k + 1],
+                (long long)int64(h->counts)[k]);
+    fclose(f);
+}
+
+void free_hist(hist_t *h) {
+    free_array(&h->breaks);
+    free_array(&h->counts);
+}
+
+
+/*
+    QUANTILE SKETCH
+
+    Centroid sizes follow the k2 scale function
+        k(q) = d / Z * log(q / (1 - q)),  Z = 4 log(n / d) + 24:
+    a centroid may only span one unit of k, so centroids grow
+    geometrically away from the extremes, which stay single points.
+    Buffered pairs are sorted with the centroids and swept once, greedily
+    merging while the limit allows.
+*/
+static double _td_k(double q, double d, double z) {
+    return d / z * log(q / (1. - q));
+}
+
+static double _td_kinv(double k, double d, double z) {
+    return 1. / (1. + exp(-k * z / d));
+}
+
+static int _td_cmp(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void _td_compress(tdigest_t *t) {
+    if (t->nbuf == 0)
+        return;
+    double *sc = t->scratch;
+    size_t m = 0;
+    for (size_t i = 0; i < t->ncent; ++i, ++m) {
+        sc[2 * m] = t->mean[i];
+        sc[2 * m + 1] = t->weight[i];
+    }
+    for (size_t i = 0; i < t->nbuf; ++i, ++m) {
+        sc[2 * m] = t->buf[2 * i];
+        sc[2 * m + 1] = t->buf[2 * i + 1];
+    }
+    qsort(sc, m, 2 * sizeof(double), _td_cmp);
+    double W = t->total, d = t->compression;
+    double z = 4. * log((W > d) ? W / d : 1.) + 24.;
+    double cm = sc[0], cw = sc[1], wsofar = 0.;
+    double limit = 0.; // the minimum stays a centroid of its own
+    size_t n = 0;
+    for (size_t i = 1; i < m; ++i) {
+        double x = sc[2 * i], w = sc[2 * i + 1];
+        if (wsofar + cw + w <= limit || n + 1 == t->ccap) {
+            cw += w;
+            cm += (x - cm) * w / cw;
+        } else {
+            t->mean[n] = cm;
+            t->weight[n++] = cw;
+            wsofar += cw;
+            limit = _td_kinv(_td_k(wsofar / W, d, z) + 1., d, z) * W;
+            cm = x;
+            cw = w;
+        }
+    }
+    t->mean[n] = cm;
+    t->weight[n++] = cw;
+    t->ncent = n;
+    t->nbuf = 0;
+}
+
+tdigest_t tdigest_init(double compression) {
+    if (!(compression >= 10.)) {
+        fprintf(stderr, "tdigest_init: compression must be at least 10\n");
+        exit(1);
+    }
+    tdigest_t t;
+    t.compression = compression;
+    t.ncent = t.nbuf = 0;
+    t.ccap = 2 * (size_t)ceil(compression) + 10;
+    t.bcap = 5 * (size_t)ceil(compression);
+    t.mean = chk_malloc(t.ccap * sizeof(double));
+    t.weight = chk_malloc(t.ccap * sizeof(double));
+    t.buf = chk_malloc(2 * t.bcap * sizeof(double));
+    t.scratch = chk_malloc(2 * (t.ccap + t.bcap) * sizeof(double));
+    t.total = 0.;
+    t.min = INFINITY;
+    t.max = -INFINITY;
+    return t;
+}
+
+static void _td_push(tdigest_t *t, double x, double w) {
+    if (t->nbuf == t->bcap)
+        _td_compress(t);
+    t->buf[2 * t->nbuf] = x;
+    t->buf[2 * t->nbuf + 1] = w;
+    t->nbuf++;
+    t->total += w;
+}
+
+/*missing values (NaN) are skipped*/
+void tdigest_add(tdigest_t *t, double x) {
+    if (x != x)
+        return;
+    _td_push(t, x, 1.);
+    if (x < t->min)
+        t->min = x;
+    if (x > t->max)
+        t->max = x;
+}
+
+typedef struct _td_job {
+    ARRV w;
+    tdigest_t *parts;
+    double **buf;
+} _td_job;
+
+static void _td_worker(void *arg, size_t start, size_t end, int tid) {
+    _td_job *job = (_td_job*)arg;
+    size_t len = view_length(job->w);
+    for (size_t b = start; b < end; ++b) {
+        size_t i0 = b * HIST_BLOCK;
+        size_t nb = (len - i0 < HIST_BLOCK) ? len - i0 : HIST_BLOCK;
+        view_gather_reals(job->w, i0, nb, job->buf[tid]);
+        for (size_t i = 0; i < nb; ++i)
+            tdigest_add(&job->parts[tid], job->buf[tid][i]);
+    }
+}
+
+/*per-thread digests of contiguous blocks, merged into t*/
+void tdigest_update_view(tdigest_t *t, ARRV w) {
+    if (!is_numeric_type(w.arr->type)) {
+        fprintf(stderr, "tdigest_update: unsupported type: %s\n", arrtype_str(w.arr->type));
+        exit(1);
+    }
+    size_t nblocks = (view_length(w) + HIST_BLOCK - 1) / HIST_BLOCK;
+    if (nblocks == 0)
+        return;
+    int nt = parallel_nthreads(nblocks);
+    _td_job job = {w, NULL, NULL};
+    job.parts = chk_malloc(nt * sizeof(tdigest_t));
+    job.buf = chk_malloc(nt * sizeof(double*));
+    for (int i = 0; i < nt; ++i) {
+        job.parts[i] = tdigest_init(t->compression);
+        job.buf[i] = chk_malloc(HIST_BLOCK * sizeof(double));
+    }
+    parallel_for(nblocks, nt, _td_worker, &job);
+    for (int i = 0; i < nt; ++i) {
+        tdigest_merge(t, &job.parts[i]);
+        free_tdigest(&job.parts[i]);
+        chk_free(job.buf[i]);
+    }
+    chk_free(job.parts);
+    chk_free(job.buf);
+}
+
+void tdigest_update(tdigest_t *t, ARRP x) {
+    tdigest_update_view(t, view(x));
+}
+
+/*fold other's centroids (and buffer) into t*/
+void tdigest_merge(tdigest_t *t, tdigest_t *other) {
+    _td_compress(other);
+    for (size_t i = 0; i < other->ncent; ++i)
+        _td_push(t, other->mean[i], other->weight[i]);
+    if (other->min < t->min)
+        t->min = other->min;
+    if (other->max > t->max)
+        t->max = other->max;
+}
+
+/*
+    Interpolates between centroid centers, and from the outer centers to
+    the exact min and max.
+*/
+double tdigest_quantile(tdigest_t *t, double q) {
+    _td_compress(t);
+    if (t->ncent == 0 || q != q)
+        return NAN;
+    if (q <= 0.)
+        return t->min;
+    if (q >= 1.)
+        return t->max;
+    size_t n = t->ncent;
+    const double *m = t->mean, *w = t->weight;
+    double target = q * t->total;
+    if (n == 1)
+        return t->min + q * (t->max - t->min);
+    if (target < w[0] / 2.)
+        return t->min + (m[0] - t->min) * target / (w[0] / 2.);
+    double left = 0.;
+    for (size_t i = 0; i + 1 < n; ++i) {
+        double ci = left + w[i] / 2., cn = left + w[i] + w[i + 1] / 2.;
+        if (target < cn)
+            return m[i] + (m[i + 1] - m[i]) * (target - ci) / (cn - ci);
+        left += w[i];
+    }
+    double cl = t->total - w[n - 1] / 2.;
+    return m[n - 1] + (t->max - m[n - 1]) * (target - cl) / (w[n - 1] / 2.);
+}
+
+void free_tdigest(tdigest_t *t) {
+    chk_free(t->mean);
+    chk_free(t->weight);
+    chk_free(t->buf);
+    chk_free(t->scratch);
+    t->ncent = t->nbuf = 0;
+}
+
+
+
+/*
+    QUANTILES
+
+    Floyd & Rivest (1975) SELECT: on long ranges, first recurse on a small
+    sample window expected to bracket the k-th value, so that the partition
+    around it leaves only a few elements on the wrong side. Indices are
+    signed so the partition sweep can run off either end.
+*/
+#define FR_CUTOFF 600
+
+static void _fr_select(double *x, ptrdiff_t left, ptrdiff_t right, ptrdiff_t k) {
+    double tmp;
+#define FR_SWAP(a, b) (tmp = x[a], x[a] = x[b], x[b] = tmp)
+    while (right > left) {
+        if (right - left > FR_CUTOFF) {
+            double n = (double)(right - left + 1), i = (double)(k - left + 1);
+            double z = log(n), s = 0.5 * exp(2. * z / 3.);
+            double sd = 0.5 * sqrt(z * s * (n - s) / n) * ((i < n / 2.) ? -1. : 1.);
+            double nl = k - i * s / n + sd, nr = k + (n - i) * s / n + sd;
+            _fr_select(x, (nl > left) ? (ptrdiff_t)nl : left,
+                       (nr < right) ? (ptrdiff_t)nr : right, k);
+        }
+        double t = x[k];
+        ptrdiff_t i = left, j = right;
+        FR_SWAP(left, k);
+        if (x[right] > t)
+            FR_SWAP(right, left);
+        while (i < j) {
+            FR_SWAP(i, j);
+            ++i;
+            --j;
+            while (x[i] < t)
+                ++i;
+            while (x[j] > t)
+                --j;
+        }
+        if (x[left] == t) {
+            FR_SWAP(left, j);
+        } else {
+            ++j;
+            FR_SWAP(j, right);
+        }
+        if (j <= k)
+            left = j + 1;
+        if (k <= j)
+            right = j - 1;
+    }
+#undef FR_SWAP
+}
+
+/*
+    Place each of the sorted ranks[a..b) in x[lo..hi]: select the middle
+    rank, then the ranks on either side within their own part.
+*/
+static void _multi_select(double *x, ptrdiff_t lo, ptrdiff_t hi,
+                          const size_t *ranks, size_t a, size_t b) {
+    while (a < b) {
+        size_t mid = a + (b - a) / 2;
+        ptrdiff_t k = (ptrdiff_t)ranks[mid];
+        _fr_select(x, lo, hi, k);
+        _multi_select(x, lo, k - 1, ranks, a, mid);
+        lo = k + 1;
+        a = mid + 1;
+    }
+}
+
+static int _cmp_size(const void *a, const void *b) {
+    size_t x = *(const size_t*)a, y = *(const size_t*)b;
+    return (x > y) - (x < y);
+}
+
+ARRP quantile_view(ARRV w, ARRP probs, int na_rm) {
+    if (!is_numeric_type(w.arr->type) || !is_numeric_type(arrtype(probs))) {
+        fprintf(stderr, "quantile: unsupported type\n");
+        exit(1);
+    }
+    size_t np = length(probs), len = view_length(w), n = 0;
+    ARRP out = alloc_array(REALS_ARR, dims(probs)[0], dims(probs)[1]);
+    double *q = real(out);
+    for (size_t i = 0; i < np; ++i) {
+        q[i] = as_real(probs, i / dims(probs)[1], i % dims(probs)[1]);
+        if (!(q[i] >= 0. && q[i] <= 1.)) {
+            fprintf(stderr, "quantile: probabilities must be in [0, 1]\n");
+            exit(1);
+        }
+    }
+    // scratch copy, compacting out missing values
+    double *x = chk_malloc((len ? len : 1) * sizeof(double));
+    view_gather_reals(w, 0, len, x);
+    int missing = 0;
+    for (size_t i = 0; i < len; ++i) {
+        if (x[i] == x[i])
+            x[n++] = x[i];
+        else
+            missing = 1;
+    }
+    if ((missing && !na_rm) || n == 0) {
+        for (size_t i = 0; i < np; ++i)
+            q[i] = NAN;
+        chk_free(x);
+        return out;
+    }
+    // order statistics floor(h) and floor(h) + 1 of h = (n - 1) p
+    size_t *ranks = chk_malloc((2 * np + 1) * sizeof(size_t));
+    size_t nr = 0;
+    for (size_t i = 0; i < np; ++i) {
+        size_t lo = (size_t)floor((n - 1) * q[i]);
+        ranks[nr++] = lo;
+        if (lo + 1 < n)
+            ranks[nr++] = lo + 1;
+    }
+    qsort(ranks, nr, sizeof(size_t), _cmp_size);
+    size_t nu = 0;
+    for (size_t i = 0; i < nr; ++i) {
+        if (nu == 0 || ranks[i] != ranks[nu - 1])
+            ranks[nu++] = ranks[i];
+    }
+    _multi_select(x, 0, (ptrdiff_t)n - 1, ranks, 0, nu);
+    for (size_t i = 0; i < np; ++i) {
+        double h = (n - 1) * q[i];
+        size_t lo = (size_t)floor(h);
+        q[i] = (lo + 1 < n) ? x[lo] + (h - lo) * (x[lo + 1] - x[lo]) : x[lo];
+    }
+    chk_free(ranks);
+    chk_free(x);
+    return out;
+}
+
+ARRP quantile(ARRP v, ARRP probs, int na_rm) {
+    return quantile_view(view(v), probs, na_rm);
+}
+
+double median_view(ARRV w, int na_rm) {
+    ARRP p = alloc_array(REALS_ARR, 1, 1);
+    real(p)[0] = 0.5;
+    ARRP q = quantile_view(w, p, na_rm);
+    double m = real(q)[0];
+    free_array(&p);
+    free_array(&q);
+    return m;
+}
+
+double median(ARRP v, int na_rm) {
+    return median_view(view(v), na_rm);
+}
+
+
+
+/*
+    ROLLING WINDOWS
+
+    Columns are spread over threads. Each thread gathers a column into its
+    buffer (in group order when grouped), runs the kernel over each
+    group's segment and scatters the results back, so the kernels only
+    ever see contiguous series. Missing values are not entered into the
+    running state; a count of those in the window decides the NaNs.
+*/
+typedef struct _roll_job {
+    ARRV w;
+    size_t k;
+    roll_op_t op;
+    const size_t *ord;      // rows in group order, NULL if not grouped
+    const size_t *seg;      // nseg + 1 segment starts in ord
+    size_t nseg;
+    double **in, **out;     // per thread, n
+    size_t **deque;         // per thread, n
+    double *res;            // n x p, row-major
+} _roll_job;
+
+/*Neumaier summation step*/
+static void _roll_add(double *s, double *c, double v) {
+    double t = *s + v;
+    *c += (fabs(*s) >= fabs(v)) ? (*s - t) + v : (v - t) + *s;
+    *s = t;
+}
+
+static void _roll_sums(const double *x, size_t n, size_t k, roll_op_t op, double *out) {
+    double s = 0., c = 0.;
+    size_t nan = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (x[i] == x[i])
+            _roll_add(&s, &c, x[i]);
+        else
+            ++nan;
+        if (i >= k) {
+            if (x[i - k] == x[i - k])
+                _roll_add(&s, &c, -x[i - k]);
+            else
+                --nan;
+        }
+        if (i + 1 < k || nan)
+            out[i] = NAN;
+        else
+            out[i] = (op == ROLL_MEAN) ? (s + c) / k : s + c;
+    }
+}
+
+/*Welford add / remove on the present values of the window*/
+static void _roll_var(const double *x, size_t n, size_t k, double *out) {
+    double mean = 0., m2 = 0.;
+    size_t cnt = 0, nan = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (x[i] == x[i]) {
+            double d = x[i] - mean;
+            mean += d / ++cnt;
+            m2 += d * (x[i] - mean);
+        } else {
+            ++nan;
+        }
+        if (i >= k) {
+            double xo = x[i - k];
+            if (xo != xo) {
+                --nan;
+            } else if (--cnt == 0) {
+                mean = m2 = 0.;
+            } else {
+                double d = xo - mean;
+                mean -= d / cnt;
+                m2 -= d * (xo - mean);
+            }
+        }
+        if (i + 1 < k || nan || k < 2)
+            out[i] = NAN;
+        else
+            out[i] = (m2 > 0.) ? m2 / (k - 1) : 0.;
+    }
+}
+
+/*
+    The deque holds indices of the window whose values are monotone
+    (increasing for the min): its front is the answer, and each index is
+    pushed and popped at most once.
+*/
+static void _roll_extreme(const double *x, size_t n, size_t k, int is_max,
+                          size_t *dq, double *out) {
+    size_t head = 0, tail = 0, nan = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (x[i] == x[i]) {
+            while (tail > head && (is_max ? x[dq[tail - 1]] <= x[i] : x[dq[tail - 1]] >= x[i]))
+                --tail;
+            dq[tail++] = i;
+        } else {
+            ++nan;
+        }
+        if (i >= k && x[i - k] != x[i - k])
+            --nan;
+        while (tail > head && dq[head] + k <= i)
+            ++head;
+        out[i] = (i + 1 < k || nan) ? NAN : x[dq[head]];
+    }
+}
+
+static void _roll_series(_roll_job *job, const double *x, size_t n, size_t *dq, double *out) {
+    switch (job->op) {
+    case ROLL_SUM:
+    case ROLL_MEAN:
+        _roll_sums(x, n, job->k, job->op, out);
+        break;
+    case ROLL_VAR:
+        _roll_var(x, n, job->k, out);
+        break;
+    default:
+        _roll_extreme(x, n, job->k, job->op == ROLL_MAX, dq, out);
+        break;
+    }
+}
+
+static void _roll_worker(void *arg, size_t start, size_t end, int tid) {
+    _roll_job *job = (_roll_job*)arg;
+    size_t n = job->w.dims[0], p = job->w.dims[1];
+    double *in = job->in[tid], *out = job->out[tid];
+    for (size_t j = start; j < end; ++j) {
+        view_gather_reals(transpose_view(job->w), j * n, n, out);
+        for (size_t r = 0; r < n; ++r)
+            in[r] = job->ord ? out[job->ord[r]] : out[r];
+        for (size_t g = 0; g < job->nseg; ++g) {
+            size_t a = job->seg[g], b = job->seg[g + 1];
+            _roll_series(job, in + a, b - a, job->deque[tid], out + a);
+        }
+        for (size_t r = 0; r < n; ++r)
+            job->res[(job->ord ? job->ord[r] : r) * p + j] = out[r];
+    }
+}
+
+static ARRP _roll_engine(ARRV w, size_t k, roll_op_t op, const size_t *ord,
+                         const size_t *seg, size_t nseg) {
+    if (!is_numeric_type(w.arr->type)) {
+        fprintf(stderr, "roll: unsupported type: %s\n", arrtype_str(w.arr->type));
+        exit(1);
+    }
+    if (k == 0) {
+        fprintf(stderr, "roll: window must hold at least one row\n");
+        exit(1);
+    }
+    size_t n = w.dims[0], p = w.dims[1];
+    ARRP res = alloc_array_layout(REALS_ARR, n, p, ROW_MAJOR);
+    int nt = parallel_nthreads(p);
+    _roll_job job = {w, k, op, ord, seg, nseg, NULL, NULL, NULL, real(res)};
+    job.in = chk_malloc(nt * sizeof(double*));
+    job.out = chk_malloc(nt * sizeof(double*));
+    job.deque = chk_malloc(nt * sizeof(size_t*));
+    for (int t = 0; t < nt; ++t) {
+        job.in[t] = chk_malloc(n * sizeof(double));
+        job.out[t] = chk_malloc(n * sizeof(double));
+        job.deque[t] = chk_malloc(n * sizeof(size_t));
+    }
+    parallel_for(p, nt, _roll_worker, &job);
+    for (int t = 0; t < nt; ++t) {
+        chk_free(job.in[t]);
+        chk_free(job.out[t]);
+        chk_free(job.deque[t]);
+    }
+    chk_free(job.in);
+    chk_free(job.out);
+    chk_free(job.deque);
+    return res;
+}
+
+/*
+    a 1 x n row vector is one series, not n series of length 1: it is
+    rolled as a column and the result reshaped back
+*/
+static int _roll_is_row(ARRV w) {
+    return w.dims[0] == 1 && w.dims[1] > 1;
+}
+
+static ARRP _roll_as_row(ARRP res) {
+    dims(res)[1] = dims(res)[0];
+    dims(res)[0] = 1;
+    return res;
+}
+
+ARRP roll_view(ARRV w, size_t k, roll_op_t op) {
+    if (_roll_is_row(w))
+        return _roll_as_row(roll_view(transpose_view(w), k, op));
+    size_t seg[2] = {0, w.dims[0]};
+    return _roll_engine(w, k, op, NULL, seg, 1);
+}
+
+typedef struct _roll_key {
+    double code;
+    size_t row;
+} _roll_key;
+
+static int _roll_key_cmp(const void *a, const void *b) {
+    const _roll_key *x = a, *y = b;
+    if (x->code != y->code)
+        return (x->code > y->code) - (x->code < y->code);
+    return (x->row > y->row) - (x->row < y->row);
+}
+
+/*rows ordered by (group, row), so each group is one segment in row order*/
+ARRP roll_grouped_view(ARRV w, size_t k, roll_op_t op, ARRP groups) {
+    if (_roll_is_row(w))
+        return _roll_as_row(roll_grouped_view(transpose_view(w), k, op, groups));
+    size_t n = w.dims[0];
+    if (!is_numeric_type(arrtype(groups)) || length(groups) != n) {
+        fprintf(stderr, "roll_grouped: groups must be numeric with one code per row\n");
+        exit(1);
+    }
+    _roll_key *keys = chk_malloc((n ? n : 1) * sizeof(_roll_key));
+    for (size_t r = 0; r < n; ++r) {
+        keys[r].code = as_real(groups, r / dims(groups)[1], r % dims(groups)[1]);
+        keys[r].row = r;
+        if (keys[r].code != keys[r].code) {
+            fprintf(stderr, "roll_grouped: missing group code\n");
+            exit(1);
+        }
+    }
+    qsort(keys, n, sizeof(_roll_key), _roll_key_cmp);
+    size_t *ord = chk_malloc((n ? n : 1) * sizeof(size_t));
+    size_t *seg = chk_malloc((n + 1) * sizeof(size_t));
+    size_t nseg = 0;
+    for (size_t r = 0; r < n; ++r) {
+        ord[r] = keys[r].row;
+        if (r == 0 || keys[r].code != keys[r - 1].code)
+            seg[nseg++] = r;
+    }
+    seg[nseg] = n;
+    chk_free(keys);
+    ARRP res = _roll_engine(w, k, op, ord, seg, nseg);
+    chk_free(ord);
+    chk_free(seg);
+    return res;
+}
+
+ARRP roll_grouped(ARRP x, size_t k, roll_op_t op, ARRP groups) {
+    return roll_grouped_view(view(x), k, op, groups);
+}
+
+ARRP roll_sum(ARRP x, size_t k)  { return roll_view(view(x), k, ROLL_SUM); }
+ARRP roll_mean(ARRP x, size_t k) { return roll_view(view(x), k, ROLL_MEAN); }
+ARRP roll_var(ARRP x, size_t k)  { return roll_view(view(x), k, ROLL_VAR); }
+ARRP roll_min(ARRP x, size_t k)  { return roll_view(view(x), k, ROLL_MIN); }
+ARRP roll_max(ARRP x, size_t k)  { return roll_view(view(x), k, ROLL_MAX); }
+
+
+
+/*
+    PRINCIPAL COMPONENTS
+*/
+
+pca_t prcomp(ARRP x, size_t k, int scale) {
+    if (arrtype(x) != REALS_ARR) {
+        fprintf(stderr, "prcomp: only REALS_ARR supported\n");
+        exit(1);
+    }
+    size_t n = dims(x)[0], p = dims(x)[1];
+    if (n < 2) {
+        fprintf(stderr, "prcomp: need at least 2 rows\n");
+        exit(1);
+    }
+    pca_t pc;
+    ARRP xc = as_layout(x, COL_MAJOR);
+    pc.center = col_means(x);
+    pc.scale = alloc_array(REALS_ARR, 1, p);
+    for (size_t j = 0; j < p; ++j) {
+        ARRV cj = col_view(xc, j);
+        set_add_num_view(cj, -real(pc.center)[j]);
+        double sd = 1.;
+        if (scale) {
+            double ss = 0.;
+            for (size_t i = 0; i < n; ++i)
+                ss += real(xc)[i + j * n] * real(xc)[i + j * n];
+            sd = sqrt(ss / (double)(n - 1));
+            if (sd == 0.) {
+                fprintf(stderr, "prcomp: cannot rescale constant column %zu\n", j + 1);
+                exit(1);
+            }
+            set_div_num_view(cj, sd);
+        }
+        real(pc.scale)[j] = sd;
+    }
+
+    svd_t s = (k == 0) ? svd(xc) : svd_rand(xc, k, 10, 2, global_seed);
+    free_array(&xc);
+    size_t nc = dims(s.d)[0];
+    pc.sdev = s.d;
+    pc.rotation = s.v;
+    pc.x = s.u;
+    for (size_t c = 0; c < nc; ++c) {
+        double dc = real(pc.sdev)[c];
+        set_mul_num_view(col_view(pc.x, c), dc);
+        real(pc.sdev)[c] = dc / sqrt((double)(n - 1));
+    }
+    return pc;
+}
+
+void free_pca(pca_t *pc) {
+    free_array(&pc->sdev);
+    free_array(&pc->rotation);
+    free_array(&pc->x);
+    free_array(&pc->center);
+    free_array(&pc->scale);
+}
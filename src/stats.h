@@ -0,0 +1,236 @@
+#ifndef __STATS_H
+#define __STATS_H
+
+#include <stdlib.h> // size_t
+#include "array.h"
+#include "rand/rng.h"
+#include "dataframe.h"
+
+
+/*
+    STREAMING MOMENTS
+    Running count, mean and central moment sums (Welford / Pebay updates).
+    A state can be updated chunk by chunk and two states can be merged, so
+    statistics over batches or parallel partitions need one pass and O(1)
+    memory.
+*/
+typedef struct moments_t {
+    size_t n;       // number of observations
+    double mean;
+    double m2;      // sum of (x - mean)^2
+    double m3;      // sum of (x - mean)^3
+    double m4;      // sum of (x - mean)^4
+} moments_t;
+
+moments_t moments_init(void);
+void moments_update(moments_t *m, ARRP v);
+void moments_update_view(moments_t *m, ARRV w);
+void moments_merge(moments_t *m, const moments_t *other);
+double moments_mean(const moments_t *m);
+double moments_var(const moments_t *m);
+double moments_sd(const moments_t *m);
+double moments_skew(const moments_t *m);
+double moments_kurt(const moments_t *m);
+
+
+/*
+    COVARIANCE / CORRELATION
+    Column-wise, for an n x p numeric matrix. Missing values are NaN:
+    USE_EVERYTHING lets them propagate, USE_PAIRWISE uses, for each pair of
+    columns, the rows where both are present (R's "pairwise.complete.obs").
+    cov_df / cor_df use the numeric columns of a data frame, in order, and
+    skip the string columns.
+*/
+typedef enum {
+    USE_EVERYTHING = 0,
+    USE_PAIRWISE
+} cov_use_t;
+
+ARRP cov(ARRP x, cov_use_t use);
+ARRP cor(ARRP x, cov_use_t use);
+ARRP cov_view(ARRV x, cov_use_t use);
+ARRP cor_view(ARRV x, cov_use_t use);
+ARRP cov_df(const data_frame *df, cov_use_t use);
+ARRP cor_df(const data_frame *df, cov_use_t use);
+
+
+/*
+    PRINCIPAL COMPONENTS
+    Like R's prcomp: columns are centered (and scaled to unit variance if
+    scale), then decomposed by SVD. k == 0 keeps every component through
+    the exact thin SVD; k > 0 keeps the top k through the randomized SVD,
+    which only ever multiplies x by thin matrices.
+*/
+typedef struct pca_t {
+    ARRP sdev;      // k x 1 standard deviations of the components
+    ARRP rotation;  // p x k loadings
+    ARRP x;         // n x k scores
+    ARRP center;    // 1 x p column means
+    ARRP scale;     // 1 x p column sds (all 1 if not scaled)
+} pca_t;
+
+pca_t prcomp(ARRP x, size_t k, int scale);
+void free_pca(pca_t *pc);
+
+
+/*
+    BOOTSTRAP
+    R replicates of a statistic over the rows of x resampled with
+    replacement, returned as an R x nstat array. The rows of replicate b
+    come from Philox stream (seed, b), so the result does not depend on
+    the number of threads. Each thread gathers its samples into one n x p
+    buffer reused for every replicate; stat gets a view of it and writes
+    nstat values to out. stat runs on worker threads: it may read views
+    (reduce_view, view_elt, ...) but must not allocate arrays.
+*/
+typedef void (*boot_stat_fn)(ARRV sample, double *out, void *arg);
+
+ARRP bootstrap(ARRP x, size_t R, size_t nstat, boot_stat_fn stat, void *arg,
+               uint32_t seed);
+ARRP bootstrap_view(ARRV x, size_t R, size_t nstat, boot_stat_fn stat, void *arg,
+                    uint32_t seed);
+
+
+/*
+    SAMPLING
+    Row numbers (0-based, LONGS_ARR size x 1) drawn from [0, n) with or
+    without replacement, in random order. Weighted draws take any numeric
+    vector of n non-negative weights: with replacement through Walker's
+    alias table (O(1) per draw), without replacement by Efraimidis-Spirakis
+    keys u^(1/w), where zero weights are never drawn.
+*/
+ARRP sample(size_t n, size_t size, int replace, uint32_t seed);
+ARRP sample_weighted(ARRP weights, size_t size, int replace, uint32_t seed);
+
+/*
+    Uniform sample of k rows from a stream of row chunks, in one pass and
+    O(k p) memory (Li's Algorithm L: the gap to the next kept row is drawn
+    directly, so skipped rows cost nothing but the read). After the
+    stream, the first min(seen, k) rows of `rows` are the sample and
+    `index` holds their positions in the stream.
+*/
+typedef struct reservoir_t {
+    size_t k;       // reservoir size
+    size_t p;       // number of columns
+    size_t seen;    // rows offered so far
+    size_t next;    // stream position of the next row to keep
+    double w;       // Algorithm L threshold
+    ARRP rows;      // k x p sampled rows
+    ARRP index;     // k x 1 stream positions (LONGS_ARR)
+    MTRand rng;
+} reservoir_t;
+
+reservoir_t reservoir_init(size_t k, size_t p, uint32_t seed);
+void reservoir_update_view(reservoir_t *r, ARRV chunk);
+void reservoir_update(reservoir_t *r, ARRP chunk);
+ARRV reservoir_view(const reservoir_t *r);
+void free_reservoir(reservoir_t *r);
+
+
+/*
+    HISTOGRAMS
+    Bin i is [breaks[i], breaks[i+1]), the last bin also holding its right
+    edge; values outside the breaks and missing values are only counted.
+    Updates bin the data in parallel into per-thread counts that are added
+    up at the end, and can be repeated chunk by chunk. hist_fixed makes
+    equal-width bins (found by arithmetic rather than search) and
+    hist_quantile bins holding about equal counts of x. hist_write saves
+    "left right count" lines for gnuplot/plot_hist.plg.
+*/
+typedef struct hist_t {
+    size_t nbin;
+    ARRP breaks;    // (nbin + 1) x 1 increasing bin edges
+    ARRP counts;    // nbin x 1 (LONGS_ARR)
+    size_t n;       // values in the bins
+    size_t below;   // values left of breaks[0]
+    size_t above;   // values right of breaks[nbin]
+    size_t na;      // missing values
+    int uniform;    // equal-width bins
+} hist_t;
+
+hist_t hist_init(ARRP breaks);
+hist_t hist_fixed(double lo, double hi, size_t nbin);
+hist_t hist_quantile(ARRP x, size_t nbin);
+void hist_update_view(hist_t *h, ARRV w);
+void hist_update(hist_t *h, ARRP x);
+void hist_merge(hist_t *h, const hist_t *other);
+void hist_write(const hist_t *h, const char *path);
+void free_hist(hist_t *h);
+
+
+/*
+    QUANTILE SKETCH
+    Merging t-digest (Dunning & Ertl, 2019): values are buffered and
+    periodically merged into at most ~compression centroids, kept small in
+    the tails so extreme quantiles stay accurate. Two digests merge, so
+    streamed chunks or per-thread partial digests combine into one.
+    Memory is fixed at init; updates never allocate.
+*/
+typedef struct tdigest_t {
+    double compression;
+    size_t ncent;       // merged centroids
+    size_t nbuf;        // buffered (value, weight) pairs
+    size_t ccap;        // centroid capacity
+    size_t bcap;        // buffer capacity
+    double *mean;       // centroid means, increasing
+    double *weight;     // centroid weights
+    double *buf;        // unmerged (value, weight) pairs
+    double *scratch;    // merge workspace, (ccap + bcap) pairs
+    double total;       // total weight
+    double min, max;
+} tdigest_t;
+
+tdigest_t tdigest_init(double compression);
+void tdigest_add(tdigest_t *t, double x);
+void tdigest_update_view(tdigest_t *t, ARRV w);
+void tdigest_update(tdigest_t *t, ARRP x);
+void tdigest_merge(tdigest_t *t, tdigest_t *other);
+double tdigest_quantile(tdigest_t *t, double q);
+void free_tdigest(tdigest_t *t);
+
+
+/*
+    QUANTILES
+    Exact sample quantiles (R's default, type 7: linear interpolation
+    between order statistics) without sorting. The values are copied to
+    scratch and the needed order statistics are found by Floyd-Rivest
+    selection, all in one recursive partitioning pass: O(n) for a few
+    probabilities. quantile returns an array shaped like probs. With
+    na_rm, missing values are dropped; otherwise any makes the result NaN.
+*/
+ARRP quantile(ARRP v, ARRP probs, int na_rm);
+ARRP quantile_view(ARRV w, ARRP probs, int na_rm);
+double median(ARRP v, int na_rm);
+double median_view(ARRV w, int na_rm);
+
+
+/*
+    ROLLING WINDOWS
+    Statistics of the trailing window of k rows, for each column of x; the
+    result is shaped like x with NaN in the first k - 1 rows. A 1 x n row
+    vector is rolled as one series. Each row
+    costs O(1) amortized: running sums (compensated) for the sum and mean,
+    sliding Welford updates for the variance, monotone deques for the min
+    and max. A missing value makes the windows holding it NaN.
+    roll_grouped restarts the windows for each value of groups (one code
+    per row; rows of a group need not be adjacent and keep their order).
+*/
+typedef enum {
+    ROLL_SUM = 0,
+    ROLL_MEAN,
+    ROLL_VAR,
+    ROLL_MIN,
+    ROLL_MAX
+} roll_op_t;
+
+ARRP roll_view(ARRV w, size_t k, roll_op_t op);
+ARRP roll_grouped_view(ARRV w, size_t k, roll_op_t op, ARRP groups);
+ARRP roll_grouped(ARRP x, size_t k, roll_op_t op, ARRP groups);
+ARRP roll_sum(ARRP x, size_t k);
+ARRP roll_mean(ARRP x, size_t k);
+ARRP roll_var(ARRP x, size_t k);
+ARRP roll_min(ARRP x, size_t k);
+ARRP roll_max(ARRP x, size_t k);
+
+
+#endif // __STATS_H
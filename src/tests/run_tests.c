@@ -10,9 +10,16 @@
 
 #include "global.h"
 #include "array.h"
+#include "stats.h"
+#include "linalg.h"
+#include "models.h"
+#include "sparse.h"
+#include "dataframe.h"
 #include "list.h"
 #include "memory.h"
 #include "rand/rng.h"
+#include "rand/philox.h"
+#include "rand/dist.h"
 
 
 void print_array(const ARRP m) {
@@ -139,6 +146,21 @@ int test_array_fillers() {
 }
 
 
+/*sample variance of the elements of x, for moment checks*/
+double _test_var(ARRP x) {
+    double m = mean(x), ss = 0;
+    for (size_t i = 0; i < length(x); ++i) {
+        double d = as_real(x, i / dims(x)[1], i % dims(x)[1]) - m;
+        ss += d * d;
+    }
+    return ss / (length(x) - 1);
+}
+
+/*1 when mean and variance of x are within tol (relative) of m and v*/
+int _test_moments(ARRP x, double m, double v, double tol) {
+    return fabs(mean(x) - m) < tol * fabs(m) && fabs(_test_var(x) - v) < tol * v;
+}
+
 int test_rand() {
     _test_title("RAND");
     int test = 0;
@@ -156,6 +178,100 @@ int test_rand() {
     test += check_arrp_equal(x1, x2, "set_rand_unif");
     free_array(&x1); free_array(&x2);
 
+    // bulk fills continue the scalar stream across state regenerations
+    x1 = alloc_array(REALS_ARR, 1, 2000);
+    x2 = alloc_array(REALS_ARR, 1, 2000);
+    r = seedRand(99);
+    for (int i=0; i < length(x1); ++i)
+        real(x1)[i] = genRand(&r);
+    r = seedRand(99);
+    real(x2)[0] = genRand(&r);
+    genRands(&r, real(x2) + 1, 700);
+    genRands(&r, real(x2) + 701, 1299);
+    test += check_arrp_equal(x1, x2, "genRands");
+    uint32_t l1[1000], l2[1000];
+    r = seedRand(7);
+    for (int i=0; i < 1000; ++i)
+        l1[i] = genRandLong(&r);
+    r = seedRand(7);
+    genRandLongs(&r, l2, 1000);
+    test += check_dbls_equal(memcmp(l1, l2, sizeof(l1)), 0, "genRandLongs");
+
+    // jump ahead, short (batch skips) and long (polynomial)
+    MTRand rs = seedRand(2024), rj;
+    for (int i=0; i < 1000; ++i)
+        genRandLong(&rs);
+    rj = seedRand(2024);
+    jumpRand(&rj, 1000);
+    test += (genRandLong(&rs) != genRandLong(&rj));
+    MTRand sp[3];
+    splitRand(&rs, 3, ((uint64_t)1 << 27) + 77, sp);
+    for (uint64_t i=0; i < ((uint64_t)1 << 27) + 77; ++i)
+        genRandLong(&rs);
+    test += check_dbls_equal(genRand(&sp[1]), genRand(&rs), "jumpRand 2^27");
+    x1 = alloc_array(REALS_ARR, 1, 3 * (1 << 18) + 5);
+    x2 = alloc_array(REALS_ARR, 1, 3 * (1 << 18) + 5);
+    r = seedRand(31);
+    genRands(&r, real(x1), length(x1));
+    set_num_threads(4);
+    set_rand_unif(x2, 31); // under RAND_UNIF_CHUNK: stays on one thread
+    set_num_threads(0);
+    test += check_arrp_equal(x1, x2, "set_rand_unif threads");
+    free_array(&x1); free_array(&x2);
+
+    // philox: threaded fill matches the sequential stream
+    x1 = alloc_array(REALS_ARR, 1001, 37);
+    x2 = alloc_array(REALS_ARR, 1001, 37);
+    set_num_threads(1);
+    set_rand_philox(x1, 42, 3);
+    set_num_threads(300); // capped at MAX_THREADS
+    test += (get_num_threads() != 256);
+    set_rand_philox(x2, 42, 3);
+    set_num_threads(0);
+    test += check_arrp_equal(x1, x2, "set_rand_philox threads");
+    uint32_t ctr[4] = {0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344};
+    uint32_t key[2] = {0xa4093822, 0x299f31d0}, blk[4];
+    philox4x32_10(ctr, key, blk); // Random123 known answer
+    test += (blk[0] != 0xd16cfe09 || blk[3] != 0x24126ea1);
+    PhiloxRand p = seedPhilox(42, 3);
+    philoxSeek(&p, 20001);
+    test += check_dbls_equal(philoxRand(&p), real(x1)[20001], "philoxSeek");
+    test += check_dbls_equal(fabs(mean(x1) - 0.5) < 0.005, 1, "philox mean");
+    free_array(&x1); free_array(&x2);
+    x1 = rand_unif(10, 1);
+    x2 = rand_unif(10, 1);
+    test += (reals_elt(x1, 0, 0) == reals_elt(x2, 0, 0));
+    free_array(&x1); free_array(&x2);
+
+    // non-uniform samplers: first two moments
+    x1 = alloc_array(REALS_ARR, 200000, 1);
+    x2 = alloc_array(INTS_ARR, 200000, 1);
+    set_rand_norm(x1, 2, 3, 11);
+    test += check_dbls_equal(_test_moments(x1, 2, 9, 0.02), 1, "set_rand_norm");
+    set_rand_exp(x1, 4, 12);
+    test += check_dbls_equal(_test_moments(x1, 0.25, 0.0625, 0.02), 1, "set_rand_exp");
+    set_rand_gamma(x1, 3.5, 2, 13);
+    test += check_dbls_equal(_test_moments(x1, 7, 14, 0.02), 1, "set_rand_gamma");
+    set_rand_gamma(x1, 0.4, 1, 14);
+    test += check_dbls_equal(_test_moments(x1, 0.4, 0.4, 0.03), 1, "set_rand_gamma shape < 1");
+    set_rand_binom(x2, 20, 0.7, 15); // inversion
+    test += check_dbls_equal(_test_moments(x2, 14, 4.2, 0.02), 1, "set_rand_binom small");
+    set_rand_binom(x2, 1000, 0.3, 16); // BTPE
+    test += check_dbls_equal(_test_moments(x2, 300, 210, 0.02), 1, "set_rand_binom BTPE");
+    // BTPE's final test against the exact pmf ratio, in and past the body
+    double lr_err = 0.;
+    for (int y = 200; y <= 420; y += 20) {
+        double exact = lgamma(301.) + lgamma(701.) - lgamma(y + 1.) - lgamma(1001. - y)
+                       + (y - 300) * log(0.3 / 0.7);
+        lr_err = fmax(lr_err, fabs(binomLogRatio(1000, 0.3, y) - exact));
+    }
+    test += (lr_err > 1e-10);
+    set_rand_pois(x2, 4, 17);
+    test += check_dbls_equal(_test_moments(x2, 4, 4, 0.02), 1, "set_rand_pois small");
+    set_rand_pois(x2, 250, 18); // PTRS
+    test += check_dbls_equal(_test_moments(x2, 250, 250, 0.02), 1, "set_rand_pois PTRS");
+    free_array(&x1); free_array(&x2);
+
     _test_summary(test);
     return test;
 }
@@ -189,7 +305,7 @@ int test_elt_functions() {
 int test_array_ops() {
     _test_title("ARRAY OPS");
     int test = 0;
-    ARRP x=empty(), y=empty(), z=empty();
+    ARRP x=empty(), y=empty(), z=empty(), w=empty();
     // add
     x = alloc_array(REALS_ARR, 1, 1); real(x)[0] = 3.0;
     set_add(x, x);
@@ -224,8 +340,29 @@ int test_array_ops() {
         test += check_dbls_equal(reals_elt(y, 0, 0), 1.0, "divide");
     free_array(&x); free_array(&y); free_array(&z);
 
+    // type promotion
+    x = alloc_array(INTS_ARR, 2, 2); set_fill_num(x, 1, 1); // 1, 2, 3, 4
+    z = alloc_array(REALS_ARR, 2, 2); set_fill_num(z, 0.5, 0);
+    y = add(x, z);
+        test += (arrtype(y) != REALS_ARR);
+        test += check_dbls_equal(reals_elt(y, 1, 1), 4.5, "add int + real");
+    free_array(&y);
+    y = mul(x, x);
+        test += (arrtype(y) != INTS_ARR);
+        test += check_dbls_equal(ints_elt(y, 1, 0), 9, "mul int * int");
+    free_array(&y);
+    w = add_num(x, 1);
+    y = divide(x, w); // 1 / 2, ...
+        test += (arrtype(y) != REALS_ARR);
+        test += check_dbls_equal(reals_elt(y, 0, 0), 0.5, "divide int / int");
+    free_array(&y); free_array(&w);
+    set_subtract(x, z);
+        test += (arrtype(x) != REALS_ARR);
+        test += check_dbls_equal(reals_elt(x, 0, 1), 1.5, "set_subtract int - real");
+    free_array(&x); free_array(&y); free_array(&z);
+
     _test_summary(test);
-    return 0;
+    return test;
 }
 
 
@@ -299,6 +436,1331 @@ int test_crossprod() {
 }
 
 
+int test_views() {
+    _test_title("VIEWS");
+    int test = 0;
+    ARRP x=empty(), y=empty(), z=empty();
+
+    x = alloc_array(REALS_ARR, 3, 4); set_fill_num(x, 0, 1); // 0, 1, ..., 11
+    // row view shares memory with x
+    set_mul_num_view(row_view(x, 1), 10.0);
+        test += check_dbls_equal(reals_elt(x, 1, 2), 60.0, "set_mul_num_view row");
+    // column view is strided
+    set_add_num_view(col_view(x, 3), 1.0);
+        test += check_dbls_equal(reals_elt(x, 0, 3), 4.0, "set_add_num_view col");
+        test += check_dbls_equal(reals_elt(x, 2, 3), 12.0, "set_add_num_view col");
+    // every other element of the first row
+    y = copy_view(slice(x, 0, 2, 2));
+    z = alloc_array(REALS_ARR, 1, 2); real(z)[0] = 0; real(z)[1] = 2;
+        test += check_arrp_equal(y, z, "copy_view slice");
+    free_array(&y); free_array(&z);
+
+    // binary ops on views of the same shape
+    y = add_view(col_view(x, 0), col_view(x, 1));
+    z = alloc_array(REALS_ARR, 3, 1);
+        real(z)[0] = 1; real(z)[1] = 90; real(z)[2] = 17;
+        test += check_arrp_equal(y, z, "add_view cols");
+    free_array(&y); free_array(&z);
+
+    // row/col/set_col round trip
+    y = col(x, 2);
+    set_col(x, 0, y);
+        test += check_dbls_equal(reals_elt(x, 1, 0), 60.0, "set_col");
+    free_array(&x); free_array(&y);
+
+    _test_summary(test);
+    return test;
+}
+
+
+int test_broadcast() {
+    _test_title("BROADCAST");
+    int test = 0;
+    ARRP x=empty(), r=empty(), c=empty(), y=empty(), z=empty();
+
+    x = alloc_array(REALS_ARR, 3, 4); set_fill_num(x, 0, 1); // 0, 1, ..., 11
+    r = alloc_array(REALS_ARR, 1, 4); set_fill_num(r, 1, 1); // 1, 2, 3, 4
+    c = alloc_array(REALS_ARR, 3, 1); set_fill_num(c, 10, 10); // 10, 20, 30
+
+    // row vector against each row
+    y = add(x, r);
+    z = alloc_array(REALS_ARR, 3, 4);
+    for (size_t i = 0; i < 12; ++i) {
+        real(z)[i] = i + (i % 4) + 1;
+    }
+        test += check_arrp_equal(y, z, "add row vector");
+    free_array(&y);
+    // column vector against each column, as the lhs
+    y = subtract(c, x);
+    for (size_t i = 0; i < 12; ++i) {
+        real(z)[i] = 10. * (i / 4 + 1) - i;
+    }
+        test += check_arrp_equal(y, z, "subtract column vector lhs");
+    free_array(&y);
+    // column times row is the outer product
+    y = mul(c, r);
+    for (size_t i = 0; i < 12; ++i) {
+        real(z)[i] = 10. * (i / 4 + 1) * (i % 4 + 1);
+    }
+        test += check_arrp_equal(y, z, "mul outer");
+        test += (dims(y)[0] != 3 || dims(y)[1] != 4);
+    free_array(&y);
+    // in place, on a column-major lhs
+    y = as_layout(x, COL_MAJOR);
+    set_divide(y, r);
+    for (size_t i = 0; i < 12; ++i) {
+        real(z)[i] = (double)i / (i % 4 + 1);
+    }
+        test += check_arrp_equal(y, z, "set_divide row vector col-major");
+    free_array(&y);
+    // views: a column of x against a row of x
+    y = add_view(col_view(x, 0), row_view(x, 2));
+        test += check_dbls_equal(reals_elt(y, 1, 3), 4. + 11., "add_view col + row");
+    set_mul_view(view(x), broadcast_view(view(r), 3, 4));
+        test += check_dbls_equal(reals_elt(x, 2, 3), 11. * 4., "set_mul_view broadcast_view");
+    free_array(&y); free_array(&z);
+    free_array(&x); free_array(&r); free_array(&c);
+
+    // an rhs aliasing the output is read before it is overwritten
+    x = alloc_array(REALS_ARR, 3, 2); set_fill_num(x, 1, 1); // 1, 2, ..., 6
+    set_subtract_view(view(x), row_view(x, 0));
+    z = alloc_array(REALS_ARR, 3, 2);
+    double zv[] = {0, 0, 2, 2, 4, 4};
+    for (size_t i = 0; i < 6; ++i) {
+        real(z)[i] = zv[i];
+    }
+        test += check_arrp_equal(x, z, "set_subtract_view aliased row");
+    free_array(&x); free_array(&z);
+    x = alloc_array(REALS_ARR, 2, 2); set_fill_num(x, 1, 1); // 1, 2, 3, 4
+    set_add(x, x);
+    set_add_view(view(x), transpose_view(view(x)));
+        test += check_dbls_equal(reals_elt(x, 0, 1), 4. + 6., "set_add_view aliased transpose");
+        test += check_dbls_equal(reals_elt(x, 1, 0), 6. + 4., "set_add_view aliased transpose lower");
+    free_array(&x);
+
+    _test_summary(test);
+    return test;
+}
+
+int test_types() {
+    _test_title("ELEMENT TYPES");
+    int test = 0;
+    ARRP x=empty(), y=empty(), z=empty(), w=empty();
+
+    // float32: fill, reductions (accumulated in double), arithmetic
+    x = alloc_array_layout(FLOATS_ARR, 100, 3, COL_MAJOR); set_fill_num(x, 0, 0.5);
+        test += check_dbls_equal(sum(x), 0.5 * 299 * 300 / 2, "floats sum");
+    y = col_sums(x);
+        test += check_dbls_equal(reals_elt(y, 0, 2), 0.5 * (2 * 100 + 3 * 99 * 100 / 2), "floats col_sums");
+    free_array(&y);
+    y = add(x, x);
+        test += (arrtype(y) != FLOATS_ARR);
+        test += check_dbls_equal(floats_elt(y, 99, 2), 2 * 0.5 * 299, "floats add");
+    free_array(&y);
+    z = alloc_array(REALS_ARR, 1, 3); set_fill_num(z, 1, 1);
+    set_subtract_view(view(x), view(z)); // stays single
+        test += (arrtype(x) != FLOATS_ARR);
+        test += check_dbls_equal(floats_elt(x, 0, 1), 0.5 - 2, "floats set_subtract_view");
+    free_array(&z);
+    z = alloc_array(INTS_ARR, 1, 3);
+    y = mul(x, z); // float * int is double
+        test += (arrtype(y) != REALS_ARR);
+    free_array(&y); free_array(&z);
+
+    // float32 products match the double ones
+    y = copyarr(x); cast_reals(y);
+    z = crossprod(x, x);
+    w = crossprod(y, y);
+        test += (arrtype(z) != FLOATS_ARR);
+        test += check_dbls_equal(floats_elt(z, 1, 2) / reals_elt(w, 1, 2), 1, "floats crossprod");
+    free_array(&z);
+    set_transpose(y);
+    z = matmul(y, x); // mixed: done in double
+        test += (arrtype(z) != REALS_ARR);
+        test += check_dbls_equal(reals_elt(z, 2, 0), reals_elt(w, 2, 0), "matmul reals x floats");
+    free_array(&x); free_array(&y); free_array(&z); free_array(&w);
+
+    // int64: exact beyond 2^53
+    x = alloc_array(LONGS_ARR, 2, 1);
+    set_longs_elt(x, 0, 0, ((int64_t)1 << 53) + 1);
+    set_longs_elt(x, 1, 0, 7);
+    set_add_num(x, 2);
+        test += (longs_elt(x, 0, 0) != ((int64_t)1 << 53) + 3);
+    z = mul_num(x, 3);
+        test += (longs_elt(z, 0, 0) != 3 * (((int64_t)1 << 53) + 3));
+    free_array(&z);
+    z = mul_num(x, 0.5); // not integral: done in double
+        test += (longs_elt(z, 1, 0) != 4);
+    free_array(&z);
+    y = alloc_array(INTS_ARR, 2, 1); set_fill_num(y, 1, 1);
+    z = subtract(x, y);
+        test += (arrtype(z) != LONGS_ARR);
+        test += (longs_elt(z, 0, 0) != ((int64_t)1 << 53) + 2);
+        test += check_dbls_equal(max(z), (double)(((int64_t)1 << 53) + 2), "longs max");
+    free_array(&z);
+    cast_longs(y);
+    z = divide(x, y);
+        test += check_dbls_equal(reals_elt(z, 1, 0), 4.5, "longs divide");
+    free_array(&x); free_array(&y); free_array(&z);
+
+    // logicals
+    x = alloc_array(REALS_ARR, 2, 3); set_fill_num(x, -1, 0.5); // -1, -0.5, ..., 1.5
+    y = copyarr(x); cast_bools(y);
+        test += check_dbls_equal(sum(y), 5, "bools sum");
+        test += (bools_elt(y, 0, 2) != 0);
+    z = add(y, y);
+        test += (arrtype(z) != INTS_ARR);
+        test += check_dbls_equal(ints_elt(z, 1, 0), 2, "bools add");
+    free_array(&z);
+    z = add_num(y, 2);
+        test += (arrtype(z) != INTS_ARR);
+        test += check_dbls_equal(sum(z), 17, "bools add_num");
+    free_array(&z);
+    z = mul_num_view(row_view(y, 1), 3);
+        test += (arrtype(z) != INTS_ARR);
+        test += check_dbls_equal(sum(z), 9, "bools mul_num_view");
+    free_array(&z);
+    z = arrp_pow2(y);
+        test += (arrtype(z) != INTS_ARR);
+        test += check_dbls_equal(sum(z), 5, "bools pow2");
+    free_array(&z);
+    z = mul(x, y);
+        test += check_dbls_equal(sum(z), -1 - 0.5 + 0.5 + 1 + 1.5, "reals * bools");
+    free_array(&x); free_array(&y); free_array(&z);
+
+    _test_summary(test);
+    return test;
+}
+
+int test_na() {
+    _test_title("MISSING VALUES");
+    int test = 0;
+    ARRP x=empty(), y=empty(), z=empty();
+
+    // missing values propagate through arithmetic and broadcasting
+    x = alloc_array(REALS_ARR, 3, 4); set_fill_num(x, 1, 1);
+        test += has_na(x);
+    set_na(x, 1, 2);
+        test += (na_count(x) != 1);
+        test += !is_na(x, 1, 2);
+        test += is_na(x, 1, 1);
+        test += !isnan(sum(x));
+    y = add(x, x);
+        test += (na_count(y) != 1);
+        test += !is_na(y, 1, 2);
+    free_array(&y);
+    z = alloc_array(REALS_ARR, 3, 1); set_fill_num(z, 1, 0);
+    y = mul(z, x); // 3x1 * 3x4
+        test += (na_count(y) != 1);
+        test += !is_na(y, 1, 2);
+    free_array(&y);
+    y = row_sums(x);
+        test += check_dbls_equal(reals_elt(y, 0, 0), 1 + 2 + 3 + 4, "row_sums");
+        test += !isnan(reals_elt(y, 1, 0));
+    free_array(&y);
+    set_reals_elt(x, 1, 2, 7); // writing an element makes it present
+        test += has_na(x);
+        test += check_dbls_equal(sum(x), 78, "sum after overwrite");
+    free_array(&x); free_array(&z);
+
+    // na_rm reductions, across bitmap words and from an unaligned view
+    x = alloc_array(REALS_ARR, 1, 200); set_fill_num(x, 0, 1);
+    for (size_t j = 3; j < 200; j += 7) {
+        set_na(x, 0, j);
+    }
+    double s = 0; size_t n = 0;
+    for (size_t j = 5; j < 190; ++j) {
+        if ((j - 3) % 7) { s += j; ++n; }
+    }
+    ARRV w = subview(view(x), 0, 5, 1, 185);
+        test += check_dbls_equal(reduce_view_na_rm(w, SUM_OP), s, "sum_na_rm view");
+        test += check_dbls_equal(reduce_view_na_rm(w, MEAN_OP), s / n, "mean_na_rm view");
+        test += check_dbls_equal(reduce_view_na_rm(w, MAX_OP), 189, "max_na_rm view");
+        test += !isnan(sum_view(w));
+        test += check_dbls_equal(sum_na_rm(x), 199 * 200 / 2 - (3 + 199) * 29 / 2, "sum_na_rm");
+    y = na_mask(x);
+        test += check_dbls_equal(sum(y), 29, "na_mask");
+    free_array(&y);
+    y = copyarr(x); set_transpose(y);
+        test += (na_count(y) != 29);
+        test += !is_na(y, 10, 0);
+        test += check_dbls_equal(mean_na_rm(y), mean_na_rm(x), "mean_na_rm transposed");
+    free_array(&x); free_array(&y);
+
+    // products: NA * 0 is NA, so a row (lhs) or column (rhs) with an NA
+    x = alloc_array(INTS_ARR, 2, 2); set_fill_num(x, 1, 1);
+    set_na(x, 0, 1);
+    z = alloc_array(REALS_ARR, 2, 1); set_fill_num(z, 1, 0);
+    y = matmul(x, z);
+        test += !is_na(y, 0, 0) || is_na(y, 1, 0);
+        test += check_dbls_equal(reals_elt(y, 1, 0), 7, "matmul present row");
+    free_array(&y);
+    y = crossprod(x, x); // column 1 of x has the NA
+        test += (na_count(y) != 3) || is_na(y, 0, 0);
+    free_array(&y);
+    y = tcrossprod(z, z);
+        test += has_na(y);
+    free_array(&y); free_array(&x); free_array(&z);
+
+    // a mixed word after a full block: non-additive ops combine once
+    x = alloc_array(REALS_ARR, 1, 130); set_fill_num(x, 1.01, 0);
+    set_na(x, 0, 100);
+        test += check_dbls_equal(reduce_view_na_rm(view(x), PROD_OP), pow(1.01, 129), "prod_na_rm");
+    free_array(&x);
+
+    // strings
+    x = alloc_array(STRINGS_ARR, 2, 1);
+    set_strings_elt(x, 0, 0, "a");
+    set_na(x, 1, 0);
+        test += !is_na(x, 1, 0);
+        test += (strcmp(strings_elt(x, 1, 0), "NA") != 0);
+    free_array(&x);
+
+    _test_summary(test);
+    return test;
+}
+
+int test_layout() {
+    _test_title("LAYOUT");
+    int test = 0;
+    ARRP x=empty(), y=empty(), z=empty(), z_tru=empty();
+
+    // same logical matrix in both layouts
+    x = alloc_array(REALS_ARR, 3, 2); set_fill_num(x, 1, 1); // 1, 2, ..., 6
+    y = alloc_array_layout(REALS_ARR, 3, 2, COL_MAJOR); set_fill_num(y, 1, 1);
+        test += check_dbls_equal(reals_elt(y, 2, 0), 5.0, "col-major reals_elt");
+        test += check_dbls_equal(real_col_ptr(y, 1)[2], 6.0, "real_col_ptr");
+        test += check_arrp_equal(x, y, "col-major equals row-major");
+
+    // mixed layouts in matmul / crossprod
+    z = crossprod(y, x); // 2 x 2
+    z_tru = alloc_array(REALS_ARR, 2, 2);
+        real(z_tru)[0] = 35; real(z_tru)[1] = 44;
+        real(z_tru)[2] = 44; real(z_tru)[3] = 56;
+        test += check_arrp_equal(z, z_tru, "crossprod col-major");
+        test += (arrlayout(z) != COL_MAJOR);
+    free_array(&z);
+    z = transpose(x);
+    set_matmul(z, y);
+        test += check_arrp_equal(z, z_tru, "matmul mixed layouts");
+    free_array(&z);
+
+    // conversion round trip
+    set_layout(y, ROW_MAJOR);
+        test += check_dbls_equal(real(y)[1], 2.0, "set_layout");
+    z = as_layout(y, COL_MAJOR);
+        test += check_dbls_equal(real(z)[1], 3.0, "as_layout");
+    set_transpose(z); // 2 x 3, still col-major
+        test += check_dbls_equal(reals_elt(z, 1, 2), 6.0, "set_transpose col-major");
+    free_array(&x); free_array(&y); free_array(&z); free_array(&z_tru);
+
+    _test_summary(test);
+    return test;
+}
+
+
+int test_reductions() {
+    _test_title("REDUCTIONS");
+    int test = 0;
+    ARRP x=empty(), y=empty(), z=empty();
+
+    x = alloc_array(INTS_ARR, 3, 4); set_fill_num(x, 1, 1); // 1, 2, ..., 12
+        test += check_dbls_equal(sum(x), 78.0, "sum ints");
+        test += check_dbls_equal(mean(x), 6.5, "mean ints");
+        test += check_dbls_equal(min(x), 1.0, "min ints");
+        test += check_dbls_equal(max(x), 12.0, "max ints");
+        test += check_dbls_equal(prod_view(row_view(x, 0)), 24.0, "prod_view row");
+        test += check_dbls_equal(sum_view(col_view(x, 1)), 2 + 6 + 10, "sum_view col");
+    y = row_sums(x);
+    z = alloc_array(REALS_ARR, 3, 1);
+        real(z)[0] = 10; real(z)[1] = 26; real(z)[2] = 42;
+        test += check_arrp_equal(y, z, "row_sums");
+    free_array(&y); free_array(&z);
+    y = col_reduce(x, MAX_OP);
+    z = alloc_array(REALS_ARR, 1, 4); set_fill_num(z, 9, 1);
+        test += check_arrp_equal(y, z, "col_reduce max");
+    free_array(&x); free_array(&y); free_array(&z);
+
+    // column means are the same whatever the layout
+    x = alloc_array(REALS_ARR, 200, 3); set_fill_num(x, 0, 0.5);
+    z = as_layout(x, COL_MAJOR);
+    y = col_means(x);
+        test += check_dbls_equal(real(y)[2], 150.25, "col_means row-major");
+    free_array(&y);
+    y = col_means(z);
+        test += check_dbls_equal(real(y)[2], 150.25, "col_means col-major");
+    free_array(&x); free_array(&y); free_array(&z);
+
+    // pairwise summation keeps the error small
+    x = alloc_array(REALS_ARR, 1, 1000000); set_fill_num(x, 0.1, 0);
+        test += check_dbls_equal(sum(x), 100000.0, "sum of 1e6 x 0.1");
+    free_array(&x);
+
+    _test_summary(test);
+    return test;
+}
+
+
+int test_moments() {
+    _test_title("MOMENTS");
+    int test = 0;
+    ARRP x=empty();
+
+    // 1, 2, ..., 1000, squared: skewed
+    x = alloc_array(REALS_ARR, 1, 1000); set_fill_num(x, 1, 1); set_arrp_pow2(x);
+    double mu = mean(x), s2 = 0, s3 = 0, s4 = 0;
+    for (size_t i = 0; i < length(x); ++i) {
+        double d = real(x)[i] - mu;
+        s2 += d*d; s3 += d*d*d; s4 += d*d*d*d;
+    }
+    double n = length(x);
+    moments_t m = moments_init();
+    moments_update(&m, x);
+        test += check_dbls_equal(moments_mean(&m), mu, "moments_mean");
+        test += check_dbls_equal(moments_var(&m) / (s2 / (n - 1)), 1.0, "moments_var");
+        test += check_dbls_equal(moments_skew(&m), sqrt(n) * s3 / pow(s2, 1.5), "moments_skew");
+        test += check_dbls_equal(moments_kurt(&m), n * s4 / (s2*s2) - 3, "moments_kurt");
+
+    // merging partial states equals one pass over everything
+    moments_t a = moments_init(), b = moments_init();
+    moments_update_view(&a, slice(x, 0, 300, 1));
+    moments_update_view(&b, slice(x, 300, 700, 1));
+    moments_merge(&a, &b);
+        test += check_dbls_equal(moments_mean(&a), moments_mean(&m), "moments_merge mean");
+        test += check_dbls_equal(moments_var(&a) / moments_var(&m), 1.0, "moments_merge var");
+        test += check_dbls_equal(moments_skew(&a), moments_skew(&m), "moments_merge skew");
+        test += check_dbls_equal(moments_kurt(&a), moments_kurt(&m), "moments_merge kurt");
+    free_array(&x);
+
+    _test_summary(test);
+    return test;
+}
+
+
+/*bootstrap statistic: column means of the sample*/
+void _boot_col_means(ARRV sample, double *out, void *arg) {
+    for (size_t j = 0; j < sample.dims[1]; ++j)
+        out[j] = mean_view(subview(sample, 0, j, sample.dims[0], 1));
+}
+
+int test_bootstrap() {
+    _test_title("BOOTSTRAP");
+    int test = 0;
+    ARRP x=empty(), b1=empty(), b2=empty(), xi=empty();
+
+    x = alloc_array(REALS_ARR, 400, 2); set_rand_norm(x, 5, 2, 8);
+    set_num_threads(1);
+    b1 = bootstrap(x, 2000, 2, _boot_col_means, NULL, 99);
+    set_num_threads(3);
+    b2 = bootstrap(x, 2000, 2, _boot_col_means, NULL, 99);
+    set_num_threads(0);
+        test += check_arrp_equal(b1, b2, "bootstrap threads");
+    // replicate means center on the sample mean with sd ~ s / sqrt(n)
+    moments_t m = moments_init();
+    moments_update_view(&m, col_view(b1, 0));
+        test += check_dbls_equal(fabs(moments_mean(&m) - mean_view(col_view(x, 0))) < 0.02, 1, "bootstrap mean");
+    moments_t mx = moments_init();
+    moments_update_view(&mx, col_view(x, 0));
+        test += check_dbls_equal(fabs(moments_sd(&m) / (moments_sd(&mx) / sqrt(400)) - 1) < 0.08, 1, "bootstrap se");
+    free_array(&b2);
+    // any numeric view: integer copy of the transposed data
+    xi = copyarr(x); set_transpose(xi); cast_ints(xi);
+    b2 = bootstrap_view(transpose_view(view(xi)), 10, 2, _boot_col_means, NULL, 99);
+        test += check_dbls_equal(dims(b2)[0] * dims(b2)[1], 20, "bootstrap view dims");
+    free_array(&b2);
+    // an integer NA reaches stat as NaN, in the replicates that draw it
+    set_na(xi, 0, 7);
+    b2 = bootstrap_view(transpose_view(view(xi)), 50, 2, _boot_col_means, NULL, 99);
+    int nan0 = 0, nan1 = 0;
+    for (size_t b = 0; b < 50; ++b) {
+        nan0 += isnan(reals_elt(b2, b, 0));
+        nan1 += isnan(reals_elt(b2, b, 1));
+    }
+        test += (nan0 == 0 || nan0 == 50 || nan1 != 0);
+    free_array(&x); free_array(&b1); free_array(&b2); free_array(&xi);
+
+    _test_summary(test);
+    return test;
+}
+
+int test_sample() {
+    _test_title("SAMPLING");
+    int test = 0;
+    ARRP s=empty(), w=empty(), x=empty();
+    size_t counts[50] = {0};
+
+    // without replacement: a permutation when size == n
+    s = sample(50, 50, 0, 3);
+    for (size_t i = 0; i < 50; ++i) {
+        counts[longs_elt(s, i, 0)]++;
+    }
+    for (size_t i = 0; i < 50; ++i) {
+        test += (counts[i] != 1);
+    }
+        test += check_dbls_equal(sum(s), 49 * 50 / 2, "sample permutation");
+    free_array(&s);
+
+    // uniform and weighted with replacement
+    s = sample(4, 40000, 1, 4);
+    w = alloc_array(INTS_ARR, 4, 1); set_fill_num(w, 1, 1); // weights 1..4
+    x = sample_weighted(w, 40000, 1, 5);
+    size_t cu[4] = {0}, cw[4] = {0};
+    for (size_t i = 0; i < 40000; ++i) {
+        cu[longs_elt(s, i, 0)]++;
+        cw[longs_elt(x, i, 0)]++;
+    }
+    int ok = 1;
+    for (size_t k = 0; k < 4; ++k) {
+        ok &= fabs(cu[k] / 40000. - 0.25) < 0.01;
+        ok &= fabs(cw[k] / 40000. - (k + 1) / 10.) < 0.01;
+    }
+        test += check_dbls_equal(ok, 1, "sample / sample_weighted frequencies");
+    free_array(&s); free_array(&x);
+
+    // weighted without replacement: zero weights never drawn, heavy ones first
+    set_ints_elt(w, 0, 0, 0);
+    set_ints_elt(w, 3, 0, 1000);
+    s = sample_weighted(w, 3, 0, 6);
+        test += (longs_elt(s, 0, 0) != 3);
+        test += check_dbls_equal(sum(s), 1 + 2 + 3, "sample_weighted no replacement");
+    free_array(&s);
+    size_t first2 = 0;
+    set_ints_elt(w, 3, 0, 2); // weights 0, 2, 3, 2
+    for (uint32_t seed = 0; seed < 2000; ++seed) {
+        s = sample_weighted(w, 1, 0, seed);
+        first2 += (longs_elt(s, 0, 0) == 2);
+        free_array(&s);
+    }
+        test += check_dbls_equal(fabs(first2 / 2000. - 3. / 7) < 0.04, 1, "sample_weighted first draw");
+    free_array(&w);
+
+    // reservoir over chunks: rows (i, 2i) of a 10000-row stream
+    reservoir_t r = reservoir_init(100, 2, 7);
+    x = alloc_array(REALS_ARR, 333, 2);
+    for (size_t row = 0; row < 10000; row += 333) {
+        size_t m = (10000 - row < 333) ? 10000 - row : 333;
+        for (size_t i = 0; i < m; ++i) {
+            set_reals_elt(x, i, 0, row + i);
+            set_reals_elt(x, i, 1, 2. * (row + i));
+        }
+        reservoir_update_view(&r, subview(view(x), 0, 0, m, 2));
+    }
+    ARRV rv = reservoir_view(&r);
+    ok = (r.seen == 10000 && rv.dims[0] == 100);
+    for (size_t i = 0; i < 100; ++i) {
+        ok &= (view_elt(rv, i, 1) == 2 * view_elt(rv, i, 0));
+        ok &= (longs_elt(r.index, i, 0) == (int64_t)view_elt(rv, i, 0));
+    }
+        test += check_dbls_equal(ok, 1, "reservoir rows");
+        test += check_dbls_equal(fabs(mean_view(col_view(r.rows, 0)) - 5000) < 1000, 1, "reservoir mean");
+    free_reservoir(&r); free_array(&x);
+    // every stream position kept with probability k / n
+    size_t kept[20] = {0};
+    x = alloc_array(REALS_ARR, 7, 1); set_fill_num(x, 0, 0);
+    for (uint32_t seed = 0; seed < 800; ++seed) {
+        r = reservoir_init(5, 1, seed);
+        for (size_t row = 0; row < 20; row += 7) {
+            size_t m = (20 - row < 7) ? 20 - row : 7;
+            reservoir_update_view(&r, subview(view(x), 0, 0, m, 1));
+        }
+        for (size_t i = 0; i < 5; ++i) {
+            kept[longs_elt(r.index, i, 0)]++;
+        }
+        free_reservoir(&r);
+    }
+    ok = 1;
+    for (size_t i = 0; i < 20; ++i) {
+        ok &= fabs(kept[i] / 800. - 0.25) < 0.06;
+    }
+        test += check_dbls_equal(ok, 1, "reservoir inclusion");
+    free_array(&x);
+    // an integer NA is kept as NA, not as 0
+    x = alloc_array(INTS_ARR, 3, 2); set_fill_num(x, 1, 1);
+    set_na(x, 1, 1);
+    r = reservoir_init(4, 2, 1);
+    reservoir_update(&r, x);
+        test += !is_na(r.rows, 1, 1) || !isnan(reals_elt(r.rows, 1, 1));
+        test += check_dbls_equal(reals_elt(r.rows, 1, 0), 3, "reservoir NA row");
+    free_reservoir(&r); free_array(&x);
+
+    _test_summary(test);
+    return test;
+}
+
+int test_hist() {
+    _test_title("HISTOGRAM / T-DIGEST");
+    int test = 0;
+    ARRP x=empty(), b=empty(), y=empty();
+
+    // 0, 0.001, ..., 0.999 plus the right edge, one below, one above, one NA
+    x = alloc_array(REALS_ARR, 1004, 1); set_fill_num(x, 0, 0.001);
+    set_reals_elt(x, 1000, 0, 1.);
+    set_reals_elt(x, 1001, 0, -0.5);
+    set_reals_elt(x, 1002, 0, 2.);
+    set_na(x, 1003, 0);
+    set_num_threads(3);
+    hist_t h = hist_fixed(0, 1, 10);
+    hist_update(&h, x);
+    set_num_threads(0);
+        test += check_dbls_equal(longs_elt(h.counts, 3, 0), 100, "hist_fixed");
+        test += check_dbls_equal(longs_elt(h.counts, 9, 0), 101, "hist_fixed closed right edge");
+        test += (h.n != 1001 || h.below != 1 || h.above != 1 || h.na != 1);
+    hist_t h2 = hist_fixed(0, 1, 10);
+    hist_update_view(&h2, subview(view(x), 0, 0, 500, 1));
+    hist_update_view(&h2, subview(view(x), 500, 0, 504, 1));
+        test += check_arrp_equal(h.counts, h2.counts, "hist chunked");
+    hist_merge(&h2, &h);
+        test += check_dbls_equal(longs_elt(h2.counts, 0, 0), 200, "hist_merge");
+    free_hist(&h); free_hist(&h2);
+    b = alloc_array(REALS_ARR, 4, 1);
+    set_reals_elt(b, 0, 0, 0); set_reals_elt(b, 1, 0, 0.1);
+    set_reals_elt(b, 2, 0, 0.5); set_reals_elt(b, 3, 0, 1);
+    h = hist_init(b);
+    hist_update(&h, x);
+        test += (longs_elt(h.counts, 0, 0) != 100 || longs_elt(h.counts, 1, 0) != 400 ||
+                 longs_elt(h.counts, 2, 0) != 501);
+    free_hist(&h); free_array(&b); free_array(&x);
+
+    // quantile bins and the digest on normal data
+    x = alloc_array(REALS_ARR, 100000, 1); set_rand_norm(x, 0, 1, 21);
+    h = hist_quantile(x, 4);
+    int ok = 1;
+    for (size_t k = 0; k < 4; ++k) {
+        ok &= fabs(longs_elt(h.counts, k, 0) - 25000.) < 250;
+    }
+        test += check_dbls_equal(ok, 1, "hist_quantile");
+        test += check_dbls_equal(fabs(reals_elt(h.breaks, 2, 0)) < 0.01, 1, "hist_quantile median break");
+    free_hist(&h);
+    tdigest_t t = tdigest_init(100), t2 = tdigest_init(100);
+    tdigest_update_view(&t, subview(view(x), 0, 0, 50000, 1));
+    tdigest_update_view(&t2, subview(view(x), 50000, 0, 50000, 1));
+    tdigest_merge(&t, &t2);
+        test += check_dbls_equal(t.total, 100000, "tdigest_merge count");
+        test += check_dbls_equal(fabs(tdigest_quantile(&t, 0.5)) < 0.02, 1, "tdigest median");
+        test += check_dbls_equal(fabs(tdigest_quantile(&t, 0.99) - 2.326) < 0.03, 1, "tdigest q99");
+        test += check_dbls_equal(tdigest_quantile(&t, 1), max(x), "tdigest max");
+    free_tdigest(&t); free_tdigest(&t2);
+    y = alloc_array(INTS_ARR, 5, 1); set_fill_num(y, 1, 1);
+    set_na(y, 4, 0);
+    t = tdigest_init(100);
+    tdigest_update(&t, y); // 1..4 and NA
+        test += check_dbls_equal(t.total, 4, "tdigest skips NA");
+        test += check_dbls_equal(tdigest_quantile(&t, 0.5), 2.5, "tdigest small median");
+    free_tdigest(&t); free_array(&x); free_array(&y);
+
+    _test_summary(test);
+    return test;
+}
+
+int test_quantile() {
+    _test_title("QUANTILES");
+    int test = 0;
+    ARRP x=empty(), p=empty(), q=empty();
+
+    // 10, 9, ..., 1 as a transposed view; type 7 interpolation
+    x = alloc_array(INTS_ARR, 1, 10); set_fill_num(x, 10, -1);
+    p = alloc_array(REALS_ARR, 1, 4);
+    set_reals_elt(p, 0, 0, 0); set_reals_elt(p, 0, 1, 0.25);
+    set_reals_elt(p, 0, 2, 0.9); set_reals_elt(p, 0, 3, 1);
+    q = quantile_view(transpose_view(view(x)), p, 0);
+        test += check_dbls_equal(reals_elt(q, 0, 0), 1, "quantile 0");
+        test += check_dbls_equal(reals_elt(q, 0, 1), 3.25, "quantile 0.25");
+        test += check_dbls_equal(reals_elt(q, 0, 2), 9.1, "quantile 0.9");
+        test += check_dbls_equal(reals_elt(q, 0, 3), 10, "quantile 1");
+        test += check_dbls_equal(median(x, 0), 5.5, "median");
+    free_array(&q);
+    set_na(x, 0, 0); // drops the 10
+        test += !isnan(median(x, 0));
+        test += check_dbls_equal(median(x, 1), 5, "median na_rm");
+    free_array(&x); free_array(&p);
+
+    // long input (Floyd-Rivest sampling): exactly h values lie below x_(h)
+    x = alloc_array(REALS_ARR, 5001, 1); set_rand_norm(x, 0, 1, 17);
+    p = alloc_array(REALS_ARR, 3, 1);
+    set_reals_elt(p, 0, 0, 0.3); set_reals_elt(p, 1, 0, 0.5); set_reals_elt(p, 2, 0, 0.999);
+    q = quantile(x, p, 0);
+    size_t below[3] = {0};
+    for (size_t i = 0; i < 5001; ++i) {
+        for (size_t k = 0; k < 3; ++k) {
+            below[k] += (reals_elt(x, i, 0) < reals_elt(q, k, 0));
+        }
+    }
+        test += (below[0] != 1500 || below[1] != 2500 || below[2] != 4995);
+        test += check_dbls_equal(median(x, 0), reals_elt(q, 1, 0), "median long");
+    free_array(&x); free_array(&p); free_array(&q);
+
+    _test_summary(test);
+    return test;
+}
+
+static double _roll_naive(ARRP x, size_t i, size_t j, size_t k, roll_op_t op) {
+    double s = 0., ss = 0., lo = INFINITY, hi = -INFINITY;
+    for (size_t r = i + 1 - k; r <= i; ++r) {
+        double v = reals_elt(x, r, j);
+        s += v; ss += v * v;
+        lo = fmin(lo, v); hi = fmax(hi, v);
+    }
+    switch (op) {
+    case ROLL_SUM:  return s;
+    case ROLL_MEAN: return s / k;
+    case ROLL_VAR:  return (ss - s * s / k) / (k - 1);
+    case ROLL_MIN:  return lo;
+    default:        return hi;
+    }
+}
+
+int test_roll() {
+    _test_title("ROLLING WINDOWS");
+    int test = 0;
+    ARRP x=empty(), r=empty(), g=empty();
+
+    // 300 x 3 against the direct window computation
+    x = alloc_array(REALS_ARR, 300, 3); set_rand_norm(x, 2, 1, 5);
+    for (roll_op_t op = ROLL_SUM; op <= ROLL_MAX; ++op) {
+        r = roll_view(view(x), 7, op);
+        int bad = !isnan(reals_elt(r, 5, 1));
+        for (size_t i = 6; i < 300; ++i) {
+            for (size_t j = 0; j < 3; ++j) {
+                bad += fabs(reals_elt(r, i, j) - _roll_naive(x, i, j, 7, op)) > 1e-9;
+            }
+        }
+            test += (bad != 0);
+        free_array(&r);
+    }
+
+    // a missing value makes the k windows holding it NaN
+    set_na(x, 100, 0);
+    r = roll_max(x, 4);
+        test += !isnan(reals_elt(r, 100, 0)) || !isnan(reals_elt(r, 103, 0));
+        test += isnan(reals_elt(r, 99, 0)) || isnan(reals_elt(r, 104, 0));
+        test += check_dbls_equal(reals_elt(r, 104, 0), _roll_naive(x, 104, 0, 4, ROLL_MAX), "roll max after NA");
+    free_array(&r);
+    r = roll_var(x, 4);
+        test += check_dbls_equal(reals_elt(r, 110, 0), _roll_naive(x, 110, 0, 4, ROLL_VAR), "roll var after NA");
+    free_array(&r); free_array(&x);
+
+    // interleaved groups: 1..10 split by parity
+    x = alloc_array(REALS_ARR, 10, 1); set_fill_num(x, 1, 1);
+    g = alloc_array(INTS_ARR, 10, 1);
+    for (size_t i = 0; i < 10; ++i) {
+        integer(g)[i] = i % 2;
+    }
+    r = roll_grouped(x, 2, ROLL_SUM, g);
+        test += !isnan(reals_elt(r, 0, 0)) || !isnan(reals_elt(r, 1, 0));
+        test += check_dbls_equal(reals_elt(r, 2, 0), 4, "roll grouped odd");
+        test += check_dbls_equal(reals_elt(r, 9, 0), 18, "roll grouped even");
+    free_array(&r);
+    r = roll_mean(x, 11);
+        test += !isnan(reals_elt(r, 9, 0));
+    free_array(&r); free_array(&x);
+
+    // a row vector is one series
+    x = alloc_row_array(REALS_ARR, 5); set_fill_num(x, 1, 1);
+    r = roll_sum(x, 2);
+        test += (dims(r)[0] != 1 || dims(r)[1] != 5) || !isnan(reals_elt(r, 0, 0));
+        test += check_dbls_equal(reals_elt(r, 0, 4), 9, "roll row vector");
+    free_array(&r);
+    free_array(&g);
+    g = alloc_row_array(INTS_ARR, 5);
+    for (size_t i = 0; i < 5; ++i) {
+        integer(g)[i] = i % 2;
+    }
+    r = roll_grouped(x, 2, ROLL_MAX, g); // 5 and 3 in group 0
+        test += check_dbls_equal(reals_elt(r, 0, 4), 5, "roll grouped row vector");
+        test += !isnan(reals_elt(r, 0, 1));
+    free_array(&r); free_array(&x); free_array(&g);
+
+    _test_summary(test);
+    return test;
+}
+
+int test_cov() {
+    _test_title("COV / COR");
+    int test = 0;
+    ARRP x=empty(), c=empty(), r=empty(), xc=empty(), c_tru=empty();
+
+    // 1000 x 3 with correlated columns
+    x = alloc_array(REALS_ARR, 1000, 3); set_rand_unif(x, 42);
+    for (size_t i = 0; i < 1000; ++i) {
+        double u = reals_elt(x, i, 0);
+        set_reals_elt(x, i, 1, 2 * u + 0.5 * reals_elt(x, i, 1) + 10);
+    }
+    c = cov(x, USE_EVERYTHING);
+    // reference: centered crossprod / (n - 1)
+    xc = copyarr(x);
+    for (size_t j = 0; j < 3; ++j)
+        set_add_num_view(col_view(xc, j), -mean_view(col_view(x, j)));
+    c_tru = crossprod(xc, xc); set_div_num(c_tru, 999);
+        test += check_arrp_equal(c, c_tru, "cov");
+    r = cor(x, USE_EVERYTHING);
+        test += check_dbls_equal(reals_elt(r, 0, 1),
+            reals_elt(c_tru, 0, 1) / sqrt(reals_elt(c_tru, 0, 0) * reals_elt(c_tru, 1, 1)), "cor");
+        test += check_dbls_equal(reals_elt(r, 2, 2), 1.0, "cor diagonal");
+    free_array(&c); free_array(&r);
+
+    // a missing value only drops that row from the pairs it touches
+    set_reals_elt(x, 5, 2, NAN);
+    c = cov(x, USE_EVERYTHING);
+        test += !isnan(reals_elt(c, 0, 2));
+    r = cov(x, USE_PAIRWISE);
+        test += check_dbls_equal(reals_elt(r, 0, 1), reals_elt(c_tru, 0, 1), "cov pairwise complete pair");
+        test += isnan(reals_elt(r, 0, 2));
+    free_array(&x); free_array(&c); free_array(&r); free_array(&xc); free_array(&c_tru);
+
+    // several output tiles, and split rows when tiles are fewer than threads
+    x = alloc_array(REALS_ARR, 300, 150); set_rand_norm(x, 1, 2, 8);
+    set_reals_elt(x, 7, 140, NAN); set_reals_elt(x, 9, 10, NAN);
+    double cjk = 0., sj = 0., sk = 0., sjj = 0., skk = 0., njk = 0.;
+    for (size_t i = 0; i < 300; ++i) {
+        double a = reals_elt(x, i, 10), b = reals_elt(x, i, 140);
+        if (isnan(a) || isnan(b)) continue;
+        sj += a; sk += b; sjj += a * a; skk += b * b; cjk += a * b; ++njk;
+    }
+    double cov_tru = (cjk - sj * sk / njk) / (njk - 1);
+    double cor_tru = cov_tru / sqrt((sjj - sj * sj / njk) / (njk - 1) * (skk - sk * sk / njk) / (njk - 1));
+    for (int nt = 1; nt <= 8; nt += 7) {
+        set_num_threads(nt);
+        c = cov(x, USE_PAIRWISE);
+        r = cor(x, USE_PAIRWISE);
+            test += check_dbls_equal(reals_elt(c, 140, 10), cov_tru, "cov pairwise across tiles");
+            test += check_dbls_equal(reals_elt(r, 10, 140), cor_tru, "cor pairwise across tiles");
+        free_array(&c); free_array(&r);
+        xc = copyarr(x);
+        set_reals_elt(xc, 7, 140, 0); set_reals_elt(xc, 9, 10, 0);
+        ARRV cols = subview(view(xc), 0, 60, 300, 10); // one tile
+        c = cov_view(cols, USE_EVERYTHING);
+        c_tru = cov_view(cols, USE_PAIRWISE);
+            test += check_arrp_equal(c, c_tru, "cov one tile");
+        free_array(&c); free_array(&c_tru);
+        r = cor(xc, USE_EVERYTHING);
+        c_tru = cor(xc, USE_PAIRWISE);
+            test += check_arrp_equal(r, c_tru, "cor complete");
+        free_array(&r); free_array(&c_tru); free_array(&xc);
+    }
+    set_num_threads(0);
+    free_array(&x);
+
+    // narrow data: a single small tile split into row segments
+    x = alloc_array(REALS_ARR, 1000, 3); set_rand_norm(x, 0, 1, 9);
+    set_reals_elt(x, 600, 1, NAN);
+    for (int pw = 0; pw < 2; ++pw) {
+        cov_use_t use = pw ? USE_PAIRWISE : USE_EVERYTHING;
+        set_num_threads(1);
+        c_tru = cor(x, use);
+        set_num_threads(8);
+        c = cor(x, use);
+            test += check_arrp_equal(c, c_tru, "cor narrow split rows");
+        free_array(&c); free_array(&c_tru);
+    }
+    set_num_threads(0);
+    free_array(&x);
+
+    // integer columns, as read_sqlite_df loads them
+    x = alloc_array(LONGS_ARR, 4, 2);
+    int64_t xl[] = {1, 10, 2, 30, 4, 20, 8, 50};
+    for (size_t i = 0; i < 8; ++i) {
+        int64(x)[i] = xl[i];
+    }
+    c = cov(x, USE_EVERYTHING);
+        test += check_dbls_equal(reals_elt(c, 0, 0), 28.75 / 3, "cov longs variance");
+        test += check_dbls_equal(reals_elt(c, 0, 1), 137.5 / 3, "cov longs");
+    free_array(&c);
+
+    // the same columns in a data frame, around a string column
+    data_frame df = df_init(4);
+    ARRP a = alloc_array(LONGS_ARR, 4, 1), s = alloc_array(STRINGS_ARR, 4, 1),
+         b = alloc_array(REALS_ARR, 4, 1);
+    for (size_t i = 0; i < 4; ++i) {
+        int64(a)[i] = int64(x)[2*i];
+        set_strings_elt(s, i, 0, "s");
+        real(b)[i] = (double)int64(x)[2*i + 1];
+    }
+    df_add_col(&df, "a", a); df_add_col(&df, "s", s); df_add_col(&df, "b", b);
+    c = cov_df(&df, USE_EVERYTHING);
+        test += (dims(c)[0] != 2 || dims(c)[1] != 2);
+        test += check_dbls_equal(reals_elt(c, 1, 0), 137.5 / 3, "cov_df");
+    free_array(&c);
+    set_na(a, 3, 0);
+    c = cor_df(&df, USE_PAIRWISE);
+        test += check_dbls_equal(reals_elt(c, 0, 1), 3 / sqrt(84.), "cor_df pairwise na");
+    free_array(&x); free_array(&c); free_df(&df);
+
+    _test_summary(test);
+    return test;
+}
+
+
+int test_lm_fit() {
+    _test_title("CHOL / LM_FIT");
+    int test = 0;
+    ARRP x=empty(), y=empty(), xtx=empty(), r=empty(), rtr=empty(), inv=empty(), eye=empty();
+
+    // 200 x 70 spans more than one Cholesky block
+    x = alloc_array(REALS_ARR, 200, 70); set_rand_unif(x, 7);
+    xtx = crossprod(x, x);
+    r = chol(xtx);
+    rtr = crossprod(r, r);
+        test += check_arrp_equal(rtr, xtx, "chol: R'R = X'X");
+        test += check_dbls_equal(reals_elt(r, 69, 3), 0.0, "chol: lower triangle zeroed");
+    inv = chol2inv(r);
+    eye = matmul(inv, xtx);
+        test += check_dbls_equal(reals_elt(eye, 10, 10), 1.0, "chol2inv diagonal");
+        test += check_dbls_equal(reals_elt(eye, 10, 11), 0.0, "chol2inv off diagonal");
+    free_array(&xtx); free_array(&r); free_array(&rtr); free_array(&inv); free_array(&eye);
+
+    // exact fit recovers the coefficients
+    ARRP beta = alloc_array(REALS_ARR, 70, 1); set_fill_num(beta, -3, 0.1);
+    y = matmul(x, beta);
+    lm_t fit = lm_fit(x, y);
+        test += check_arrp_equal(fit.coef, beta, "lm_fit exact coefficients");
+        test += check_dbls_equal(fit.sigma, 0.0, "lm_fit exact sigma");
+    free_lm(&fit); free_array(&x); free_array(&y); free_array(&beta);
+
+    // y = (1,3,2,5,4) on x = 1..5: b = (0.6, 0.8), sigma^2 = 1.2
+    x = alloc_array(REALS_ARR, 5, 2); y = alloc_array(REALS_ARR, 1, 5);
+    double yv[] = {1, 3, 2, 5, 4};
+    for (size_t i = 0; i < 5; ++i) {
+        set_reals_elt(x, i, 0, 1.);
+        set_reals_elt(x, i, 1, (double)i + 1);
+        real(y)[i] = yv[i];
+    }
+    fit = lm_fit(x, y);
+        test += check_dbls_equal(real(fit.coef)[0], 0.6, "lm_fit intercept");
+        test += check_dbls_equal(real(fit.coef)[1], 0.8, "lm_fit slope");
+        test += check_dbls_equal(fit.sigma, sqrt(1.2), "lm_fit sigma");
+        test += check_dbls_equal(real(fit.se)[0], sqrt(1.2 * 1.1), "lm_fit se intercept");
+        test += check_dbls_equal(real(fit.se)[1], sqrt(1.2 / 10), "lm_fit se slope");
+        test += (fit.df != 3);
+    free_lm(&fit); free_array(&x); free_array(&y);
+
+    _test_summary(test);
+    return test;
+}
+
+
+int test_qr() {
+    _test_title("QR");
+    int test = 0;
+    ARRP x=empty(), q=empty(), r=empty(), qr_=empty(), qtq=empty(), eye=empty();
+
+    // 150 x 70 spans several panels; QR reproduces x and Q is orthonormal
+    for (int lay = 0; lay < 2; ++lay) {
+        x = alloc_array_layout(REALS_ARR, 150, 70, lay ? COL_MAJOR : ROW_MAJOR);
+        set_rand_unif(x, 11);
+        qr_t f = qr(x);
+        q = qr_Q(&f); r = qr_R(&f);
+        qr_ = matmul(q, r);
+            test += check_arrp_equal(qr_, x, "qr: QR = x");
+        eye = alloc_array(REALS_ARR, 70, 70);
+        for (size_t i = 0; i < 70; ++i)
+            set_reals_elt(eye, i, i, 1.);
+        qtq = crossprod(q, q);
+            test += check_arrp_equal(qtq, eye, "qr: Q'Q = I");
+            test += check_dbls_equal(reals_elt(r, 40, 3), 0.0, "qr: R upper triangular");
+        free_qr(&f);
+        free_array(&x); free_array(&q); free_array(&r); free_array(&qr_);
+        free_array(&qtq); free_array(&eye);
+    }
+
+    // wide matrix
+    x = alloc_array(REALS_ARR, 20, 45); set_rand_unif(x, 5);
+    qr_t f = qr(x);
+    q = qr_Q(&f); r = qr_R(&f);
+    qr_ = matmul(q, r);
+        test += check_arrp_equal(qr_, x, "qr: QR = x (wide)");
+    free_qr(&f); free_array(&x); free_array(&q); free_array(&r); free_array(&qr_);
+
+    // degree 9 polynomial on [0, 1]: X'X is too ill-conditioned for the
+    // normal equations to recover the coefficients, QR still does
+    size_t n = 60, p = 10;
+    x = alloc_array(REALS_ARR, n, p);
+    ARRP beta = alloc_array(REALS_ARR, p, 1); set_fill_num(beta, 1, 1);
+    for (size_t i = 0; i < n; ++i) {
+        double t = (double)i / (n - 1), tk = 1.;
+        for (size_t k = 0; k < p; ++k, tk *= t)
+            set_reals_elt(x, i, k, tk);
+    }
+    ARRP y = matmul(x, beta);
+    lm_t fit = lm_fit_qr(x, y);
+        test += check_arrp_equal(fit.coef, beta, "lm_fit_qr: ill-conditioned polynomial");
+    free_lm(&fit); free_array(&x); free_array(&y); free_array(&beta);
+
+    // same answer as lm_fit on a well-conditioned problem
+    x = alloc_array(REALS_ARR, 5, 2); y = alloc_array(REALS_ARR, 1, 5);
+    double yv[] = {1, 3, 2, 5, 4};
+    for (size_t i = 0; i < 5; ++i) {
+        set_reals_elt(x, i, 0, 1.);
+        set_reals_elt(x, i, 1, (double)i + 1);
+        real(y)[i] = yv[i];
+    }
+    fit = lm_fit_qr(x, y);
+        test += check_dbls_equal(real(fit.coef)[0], 0.6, "lm_fit_qr intercept");
+        test += check_dbls_equal(real(fit.coef)[1], 0.8, "lm_fit_qr slope");
+        test += check_dbls_equal(real(fit.se)[0], sqrt(1.2 * 1.1), "lm_fit_qr se intercept");
+        test += check_dbls_equal(real(fit.se)[1], sqrt(1.2 / 10), "lm_fit_qr se slope");
+    free_lm(&fit); free_array(&x); free_array(&y);
+
+    _test_summary(test);
+    return test;
+}
+
+
+int test_lm_accum() {
+    _test_title("LM_ACCUM");
+    int test = 0;
+    ARRP x=empty(), y=empty();
+
+    x = alloc_array(REALS_ARR, 500, 12); set_rand_unif(x, 21);
+    y = alloc_array(REALS_ARR, 500, 1); set_rand_unif(y, 22);
+    lm_t full = lm_fit(x, y);
+
+    // uneven batches
+    size_t cuts[] = {0, 37, 300, 481, 500};
+    lm_accum_t acc = lm_accum_init(12);
+    for (size_t b = 0; b + 1 < sizeof(cuts) / sizeof(cuts[0]); ++b) {
+        size_t nr = cuts[b + 1] - cuts[b];
+        lm_accum_update_view(&acc, subview(view(x), cuts[b], 0, nr, 12),
+                             subview(view(y), cuts[b], 0, nr, 1));
+    }
+    lm_t fit = lm_accum_fit(&acc);
+        test += check_arrp_equal(fit.coef, full.coef, "lm_accum coefficients");
+        test += check_arrp_equal(fit.se, full.se, "lm_accum standard errors");
+        test += check_dbls_equal(fit.sigma, full.sigma, "lm_accum sigma");
+        test += (fit.df != full.df);
+    free_lm(&fit);
+
+    // two half scans merged
+    lm_accum_t a = lm_accum_init(12), b = lm_accum_init(12);
+    lm_accum_update_view(&a, subview(view(x), 0, 0, 250, 12), subview(view(y), 0, 0, 250, 1));
+    lm_accum_update_view(&b, subview(view(x), 250, 0, 250, 12), subview(view(y), 250, 0, 250, 1));
+    lm_accum_merge(&a, &b);
+    fit = lm_accum_fit(&a);
+        test += check_arrp_equal(fit.coef, full.coef, "lm_accum_merge coefficients");
+    free_lm(&fit); free_lm(&full);
+    free_lm_accum(&acc); free_lm_accum(&a); free_lm_accum(&b);
+    free_array(&x); free_array(&y);
+
+    _test_summary(test);
+    return test;
+}
+
+
+/*u diag(d) v'*/
+static ARRP _svd_reconstruct(svd_t *s) {
+    ARRP ud = copyarr(s->u);
+    for (size_t c = 0; c < dims(s->d)[0]; ++c)
+        set_mul_num_view(col_view(ud, c), real(s->d)[c]);
+    ARRP out = tcrossprod(ud, s->v);
+    free_array(&ud);
+    return out;
+}
+
+static ARRP _eye(size_t n) {
+    ARRP e = alloc_array(REALS_ARR, n, n);
+    for (size_t i = 0; i < n; ++i)
+        set_reals_elt(e, i, i, 1.);
+    return e;
+}
+
+int test_eigen_svd() {
+    _test_title("EIGEN / SVD");
+    int test = 0;
+    ARRP x=empty(), a=empty(), av=empty(), vd=empty(), vtv=empty(), eye=empty(), rec=empty();
+
+    // 2 x 2 by hand
+    a = alloc_array(REALS_ARR, 2, 2); set_fill_num(a, 2, 0);
+    set_reals_elt(a, 0, 1, 1.); set_reals_elt(a, 1, 0, 1.);
+    eigen_t e = eigen_sym(a);
+        test += check_dbls_equal(real(e.values)[0], 3.0, "eigen_sym 2x2 largest");
+        test += check_dbls_equal(real(e.values)[1], 1.0, "eigen_sym 2x2 smallest");
+        test += check_dbls_equal(fabs(reals_elt(e.vectors, 0, 0)), sqrt(0.5), "eigen_sym 2x2 vector");
+    free_eigen(&e); free_array(&a);
+
+    // A V = V diag(values), V'V = I, values decreasing
+    x = alloc_array(REALS_ARR, 50, 30); set_rand_unif(x, 31);
+    a = crossprod(x, x);
+    e = eigen_sym(a);
+    av = matmul(a, e.vectors);
+    vd = copyarr(e.vectors);
+    for (size_t c = 0; c < 30; ++c) {
+        set_mul_num_view(col_view(vd, c), real(e.values)[c]);
+    }
+        test += check_arrp_equal(av, vd, "eigen_sym: AV = VD");
+    vtv = crossprod(e.vectors, e.vectors); eye = _eye(30);
+        test += check_arrp_equal(vtv, eye, "eigen_sym: V'V = I");
+    int sorted = 1;
+    for (size_t i = 0; i + 1 < 30; ++i) {
+        sorted &= real(e.values)[i] >= real(e.values)[i + 1];
+    }
+        test += !sorted;
+    free_eigen(&e);
+    free_array(&a); free_array(&av); free_array(&vd); free_array(&vtv); free_array(&eye);
+
+    // thin SVD, tall and wide
+    svd_t s = svd(x);
+    rec = _svd_reconstruct(&s);
+        test += check_arrp_equal(rec, x, "svd: U D V' = x");
+    vtv = crossprod(s.u, s.u); eye = _eye(30);
+        test += check_arrp_equal(vtv, eye, "svd: U'U = I");
+    free_array(&rec); free_array(&vtv); free_array(&eye);
+    // squared singular values are the eigenvalues of x'x
+    a = crossprod(x, x);
+    e = eigen_sym(a);
+        test += check_dbls_equal(real(s.d)[0] * real(s.d)[0] / real(e.values)[0], 1.0, "svd: d^2 = eigen(x'x)");
+        test += check_dbls_equal(real(s.d)[29] * real(s.d)[29] / real(e.values)[29], 1.0, "svd: smallest d^2");
+    free_eigen(&e); free_array(&a); free_svd(&s);
+    set_transpose(x);
+    s = svd(x);
+    rec = _svd_reconstruct(&s);
+        test += check_arrp_equal(rec, x, "svd: U D V' = x (wide)");
+    free_array(&rec); free_svd(&s); free_array(&x);
+
+    // randomized SVD recovers a rank-5 matrix exactly
+    ARRP l = alloc_array(REALS_ARR, 200, 5), r = alloc_array(REALS_ARR, 5, 100);
+    set_rand_unif(l, 1); set_rand_unif(r, 2);
+    x = matmul(l, r);
+    s = svd(x);
+    svd_t sr = svd_rand(x, 5, 5, 1, 3);
+    double maxdiff = 0.;
+    for (size_t i = 0; i < 5; ++i) {
+        maxdiff = fmax(maxdiff, fabs(real(sr.d)[i] - real(s.d)[i]));
+    }
+        test += check_dbls_equal(maxdiff, 0.0, "svd_rand: singular values of a rank-5 matrix");
+    rec = _svd_reconstruct(&sr);
+        test += check_arrp_equal(rec, x, "svd_rand: U D V' = x");
+    free_array(&rec); free_svd(&s); free_svd(&sr);
+    free_array(&l); free_array(&r); free_array(&x);
+
+    // prcomp: sdev^2 are the eigenvalues of cov(x)
+    x = alloc_array(REALS_ARR, 100, 6); set_rand_unif(x, 41);
+    for (size_t i = 0; i < 100; ++i)
+        set_reals_elt(x, i, 1, reals_elt(x, i, 0) + 0.1 * reals_elt(x, i, 1));
+    pca_t pc = prcomp(x, 0, 0);
+    a = cov(x, USE_EVERYTHING);
+    e = eigen_sym(a);
+        test += check_dbls_equal(real(pc.sdev)[0] * real(pc.sdev)[0], real(e.values)[0], "prcomp: sdev^2 = eigen(cov)");
+        test += check_dbls_equal(real(pc.sdev)[5] * real(pc.sdev)[5], real(e.values)[5], "prcomp: smallest sdev^2");
+    pca_t pr = prcomp(x, 2, 0);
+        test += check_dbls_equal(real(pr.sdev)[0], real(pc.sdev)[0], "prcomp (randomized) first sdev");
+        test += check_dbls_equal(fabs(reals_elt(pr.rotation, 0, 0)), fabs(reals_elt(pc.rotation, 0, 0)), "prcomp (randomized) loading");
+    free_pca(&pc); free_pca(&pr); free_eigen(&e); free_array(&a); free_array(&x);
+
+    _test_summary(test);
+    return test;
+}
+
+
+int test_glm() {
+    _test_title("GLM_FIT");
+    int test = 0;
+    ARRP x=empty(), y=empty();
+
+    // one binary covariate: the MLE reproduces the group means
+    size_t n = 40;
+    x = alloc_array(REALS_ARR, n, 2); y = alloc_array(REALS_ARR, n, 1);
+    double s0 = 0, s1 = 0;
+    for (size_t i = 0; i < n; ++i) {
+        set_reals_elt(x, i, 0, 1.);
+        set_reals_elt(x, i, 1, (double)(i >= n / 2));
+        real(y)[i] = (double)((i * 7) % 5);  // counts 0..4
+        if (i < n / 2) s0 += real(y)[i]; else s1 += real(y)[i];
+    }
+    glm_t fit = glm_fit(x, y, POISSON_FAMILY);
+        test += check_dbls_equal(real(fit.coef)[0], log(s0 / (n / 2)), "poisson: intercept = log(mean0)");
+        test += check_dbls_equal(real(fit.coef)[1], log(s1 / s0), "poisson: slope = log(mean1 / mean0)");
+        test += check_dbls_equal(real(fit.se)[1], sqrt(1 / s0 + 1 / s1), "poisson: slope se");
+        test += !fit.converged;
+    free_glm(&fit);
+
+    // 0/1 response: p0 = 6/20, p1 = 13/20
+    for (size_t i = 0; i < n; ++i)
+        real(y)[i] = (i < n / 2) ? (double)(i < 6) : (double)(i - n / 2 < 13);
+    double p0 = 6. / 20, p1 = 13. / 20;
+    fit = glm_fit(x, y, BINOMIAL_FAMILY);
+        test += check_dbls_equal(real(fit.coef)[0], log(p0 / (1 - p0)), "binomial: intercept = logit(p0)");
+        test += check_dbls_equal(real(fit.coef)[1], log(p1 / (1 - p1)) - log(p0 / (1 - p0)), "binomial: slope = log odds ratio");
+        test += check_dbls_equal(real(fit.se)[0], sqrt(1 / (20 * p0 * (1 - p0))), "binomial: intercept se");
+    free_glm(&fit);
+
+    // gaussian is ordinary least squares; one workspace serves repeated fits
+    set_rand_unif(y, 3);
+    glm_work_t work = glm_work_alloc(n, 2);
+    glm_t g1 = glm_fit_work(x, y, GAUSSIAN_FAMILY, &work);
+    glm_t g2 = glm_fit_work(x, y, GAUSSIAN_FAMILY, &work);
+    lm_t l = lm_fit(x, y);
+        test += check_arrp_equal(g1.coef, l.coef, "gaussian: coefficients = lm_fit");
+        test += check_arrp_equal(g1.se, l.se, "gaussian: se = lm_fit");
+        test += check_arrp_equal(g2.coef, g1.coef, "glm_fit_work: reused workspace");
+    free_glm(&g1); free_glm(&g2); free_lm(&l); free_glm_work(&work);
+    free_array(&x); free_array(&y);
+
+    _test_summary(test);
+    return test;
+}
+
+
+int test_sparse() {
+    _test_title("SPARSE");
+    int test = 0;
+    ARRP d=empty(), s=empty(), sc=empty(), back=empty(), b=empty(), p1=empty(), p2=empty();
+
+    // 30 x 20, about 80% zeros
+    d = alloc_array(REALS_ARR, 30, 20); set_rand_unif(d, 51);
+    size_t nz = 0;
+    for (size_t i = 0; i < length(d); ++i) {
+        real(d)[i] = (real(d)[i] < 0.8) ? 0. : real(d)[i];
+        nz += real(d)[i] != 0.;
+    }
+    s = as_sparse(d, CSR_ARR);
+    sc = as_sparse(s, CSC_ARR);
+        test += (nnz(s) != nz) + (nnz(sc) != nz);
+    back = as_dense(sc);
+        test += check_arrp_equal(back, d, "as_dense(as_sparse(x)) = x");
+        test += check_dbls_equal(sparse_elt(s, 7, 3), reals_elt(d, 7, 3), "sparse_elt (CSR)");
+        test += check_dbls_equal(sparse_elt(sc, 29, 19), reals_elt(d, 29, 19), "sparse_elt (CSC)");
+    free_array(&back);
+
+    // products against their dense equivalents, for both storages
+    b = alloc_array_layout(REALS_ARR, 20, 7, COL_MAJOR); set_rand_unif(b, 52);
+    p2 = matmul(d, b);
+    p1 = matmul(s, b);
+        test += check_arrp_equal(p1, p2, "matmul(CSR, dense)");
+    free_array(&p1);
+    p1 = matmul(sc, b);
+        test += check_arrp_equal(p1, p2, "matmul(CSC, dense)");
+    free_array(&p1); free_array(&p2); free_array(&b);
+
+    b = alloc_array(REALS_ARR, 5, 30); set_rand_unif(b, 53);
+    p2 = matmul(b, d);
+    p1 = matmul(b, s);
+        test += check_arrp_equal(p1, p2, "matmul(dense, CSR)");
+    free_array(&p1);
+    p1 = matmul(b, sc);
+        test += check_arrp_equal(p1, p2, "matmul(dense, CSC)");
+    free_array(&p1); free_array(&p2); free_array(&b);
+
+    p2 = crossprod(d, d);
+    p1 = crossprod(s, s);
+        test += check_arrp_equal(p1, p2, "crossprod(CSR)");
+    free_array(&p1);
+    p1 = crossprod(sc, sc);
+        test += check_arrp_equal(p1, p2, "crossprod(CSC)");
+    free_array(&p1); free_array(&p2);
+    p2 = tcrossprod(d, d);
+    p1 = tcrossprod(s, s);
+        test += check_arrp_equal(p1, p2, "tcrossprod(CSR)");
+    free_array(&p1); free_array(&p2);
+
+    b = alloc_array(REALS_ARR, 30, 4); set_rand_unif(b, 54);
+    p2 = crossprod(d, b);
+    p1 = crossprod(sc, b);
+        test += check_arrp_equal(p1, p2, "crossprod(CSC, dense)");
+    free_array(&p1); free_array(&p2);
+    p2 = crossprod(b, d);
+    p1 = crossprod(b, s);
+        test += check_arrp_equal(p1, p2, "crossprod(dense, CSR)");
+    free_array(&p1); free_array(&p2); free_array(&b);
+    free_array(&s); free_array(&sc); free_array(&d);
+
+    // triplets in any order, duplicates summed
+    size_t rows[] = {2, 0, 2, 1, 2};
+    size_t cols[] = {3, 1, 0, 1, 3};
+    double vals[] = {1., 2., 3., 4., 5.};
+    s = sparse_from_triplets(CSC_ARR, 3, 4, 5, rows, cols, vals);
+        test += (nnz(s) != 4);
+        test += check_dbls_equal(sparse_elt(s, 2, 3), 6., "sparse_from_triplets: duplicates summed");
+        test += check_dbls_equal(sparse_elt(s, 1, 1), 4., "sparse_from_triplets");
+        test += check_dbls_equal(sparse_elt(s, 1, 3), 0., "sparse_from_triplets: structural zero");
+    free_array(&s);
+
+    _test_summary(test);
+    return test;
+}
+
+
+int test_model_matrix() {
+    _test_title("MODEL_MATRIX");
+    int test = 0;
+
+    // x numeric, g strings (levels a < b < c), k integer codes {3, 1}
+    size_t n = 6;
+    const char *g[] = {"b", "a", "c", "b", "c", "a"};
+    data_frame df = df_init(n);
+    ARRP x = alloc_array(REALS_ARR, n, 1), gs = alloc_array(STRINGS_ARR, n, 1),
+         k = alloc_array(INTS_ARR, 1, n), y = alloc_array(LONGS_ARR, n, 1);
+    for (size_t i = 0; i < n; ++i) {
+        real(x)[i] = (double)i + 1;
+        set_strings_elt(gs, i, 0, g[i]);
+        integer(k)[i] = (i % 2) ? 1 : 3;
+        int64(y)[i] = 10 * (int64_t)i;
+    }
+    df_add_col(&df, "x", x); df_add_col(&df, "g", gs); df_add_col(&df, "k", k);
+    df_add_col(&df, "y", y);
+
+    model_matrix_t mm = model_matrix(&df, "y ~ x + g + factor(k) + x:g", MM_DENSE);
+    const char *names[] = {"(Intercept)", "x", "gb", "gc", "factor(k)3", "x:gb", "x:gc"};
+    int names_ok = dims(mm.x)[1] == 7;
+    for (size_t j = 0; names_ok && j < 7; ++j) {
+        names_ok = strcmp(strings_elt(mm.colnames, 0, j), names[j]) == 0;
+    }
+        test += !names_ok;
+    // row 2: x = 3, g = c, k = 3
+    double row2[] = {1, 3, 0, 1, 1, 0, 3};
+    ARRP r2 = alloc_array(REALS_ARR, 1, 7);
+    for (size_t j = 0; j < 7; ++j)
+        real(r2)[j] = row2[j];
+    ARRP got = row(mm.x, 2);
+        test += check_arrp_equal(got, r2, "model_matrix: dummies and interaction");
+    free_array(&got); free_array(&r2);
+
+    // the same design written straight to CSR
+    model_matrix_t ms = model_matrix(&df, "x + g + factor(k) + x:g", MM_SPARSE);
+        test += (arrtype(ms.x) != CSR_ARR);
+    ARRP dense = as_dense(ms.x);
+        test += check_arrp_equal(dense, mm.x, "model_matrix: sparse = dense");
+    free_array(&dense);
+    free_model_matrix(&mm); free_model_matrix(&ms);
+
+    // no intercept: the first factor keeps all its levels
+    mm = model_matrix(&df, "g - 1", MM_DENSE);
+        test += (dims(mm.x)[1] != 3);
+        test += check_dbls_equal(reals_elt(mm.x, 1, 0), 1.0, "model_matrix: full coding without intercept");
+    free_model_matrix(&mm);
+
+    // rows with a missing value in a used column are dropped, response too
+    set_na(x, 4, 0); // x is not in the formula below
+    set_na(y, 1, 0); set_na(gs, 2, 0); set_na(k, 5, 0);
+    mm = model_matrix(&df, "y ~ g + factor(k)", MM_DENSE);
+    // rows 0, 3, 4 remain: level a is gone and b is the baseline
+        test += (dims(mm.x)[0] != 3) + (dims(mm.x)[1] != 3);
+        test += (longs_elt(mm.rows, 1, 0) != 3);
+        test += check_dbls_equal(reals_elt(mm.y, 2, 0), 40, "model_matrix: response kept rows");
+        test += (strcmp(strings_elt(mm.colnames, 0, 1), "gc") != 0);
+        test += check_dbls_equal(reals_elt(mm.x, 2, 1), 1, "model_matrix: NA rows dropped");
+    free_model_matrix(&mm);
+    mm = model_matrix(&df, "x", MM_DENSE); // unused columns don't drop rows
+        test += (dims(mm.x)[0] != 5) + (mm.y.node != NULL);
+    free_model_matrix(&mm);
+    free_df(&df);
+
+    // 200 levels: auto picks sparse output
+    n = 2000;
+    df = df_init(n);
+    ARRP id = alloc_array(INTS_ARR, n, 1);
+    for (size_t i = 0; i < n; ++i)
+        integer(id)[i] = (int)((i * 37) % 200);
+    df_add_col(&df, "id", id);
+    mm = model_matrix(&df, "factor(id)", MM_AUTO);
+        test += (arrtype(mm.x) != CSR_ARR) + (dims(mm.x)[1] != 200) + (nnz(mm.x) != 2 * n - 10);
+        test += check_dbls_equal(sparse_elt(mm.x, 1, 37), 1.0, "model_matrix: auto sparse");
+    free_model_matrix(&mm);
+    free_df(&df);
+
+    _test_summary(test);
+    return test;
+}
+
+
 
 
 int run_tests(void) {
@@ -313,6 +1775,26 @@ int run_tests(void) {
     failed += test_matmul();
     failed += test_transpose();
     failed += test_crossprod();
+    failed += test_views();
+    failed += test_broadcast();
+    failed += test_types();
+    failed += test_na();
+    failed += test_layout();
+    failed += test_reductions();
+    failed += test_moments();
+    failed += test_cov();
+    failed += test_bootstrap();
+    failed += test_sample();
+    failed += test_hist();
+    failed += test_quantile();
+    failed += test_roll();
+    failed += test_lm_fit();
+    failed += test_qr();
+    failed += test_lm_accum();
+    failed += test_eigen_svd();
+    failed += test_glm();
+    failed += test_sparse();
+    failed += test_model_matrix();
 
     printf("\n%s %d %s failed\n",
             failed == 0 ? "   " : "!!!",